@@ -0,0 +1,215 @@
+// This file is part of the WillDaisey/WDUL (Windows Desktop Utility Library) project.
+// View this project on github: https://github.com/WillDaisey/wdul/
+
+#include "include/wdul/async_io.hpp"
+#include "include/wdul/memory.hpp"
+#include "include/wdul/error.hpp"
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+namespace wdul
+{
+	// The state of a request in flight. The OVERLAPPED structure must remain valid until the completion is dequeued.
+	struct async_io_engine::request_node
+	{
+		OVERLAPPED overlapped;
+		async_io_request request;
+
+		// Set if the request failed immediately, in which case a completion was posted to the port manually.
+		bool failed_immediately;
+		std::uint32_t error;
+
+		// Links nodes allocated by a call to submit, before they are issued.
+		request_node* next;
+	};
+
+	async_io_engine::async_io_engine(std::uint32_t const ConcurrentThreads) :
+		mInFlight(0)
+	{
+		mPort.attach(CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, ConcurrentThreads));
+		if (!mPort)
+		{
+			throw_last_error();
+		}
+	}
+
+	async_io_engine::~async_io_engine()
+	{
+		// The kernel writes to the OVERLAPPED structure of each request in flight, so the requests must complete before their
+		// storage is freed.
+		OVERLAPPED_ENTRY entries[64];
+		while (in_flight() != 0)
+		{
+			ULONG count;
+			auto const dequeued = GetQueuedCompletionStatusEx(mPort.get(), entries, static_cast<ULONG>(std::size(entries)), &count,
+				INFINITE, FALSE);
+			if (!dequeued)
+			{
+				WDUL_ASSERT_MSG(false, "GetQueuedCompletionStatusEx failed");
+				break;
+			}
+			for (ULONG i = 0; i != count; ++i)
+			{
+				async_io_completion completion;
+				if (auto const callback = complete(entries[i], completion))
+				{
+					callback(completion);
+				}
+			}
+		}
+	}
+
+	void async_io_engine::attach(_In_ HANDLE const File)
+	{
+		if (!CreateIoCompletionPort(File, mPort.get(), 0, 0))
+		{
+			throw_last_error();
+		}
+
+		// Completions are only ever dequeued from the port, so the system need not also signal the file handle. If this fails, the
+		// handle is signalled needlessly, but the file has already been associated with the port, so the failure is not thrown.
+		WDUL_DEBUG_RAISE_LAST_ERROR_WHEN(SetFileCompletionNotificationModes(File, FILE_SKIP_SET_EVENT_ON_HANDLE), == FALSE);
+	}
+
+	void async_io_engine::submit(std::span<async_io_request const> const Requests, _Out_opt_ std::size_t* const Submitted)
+	{
+		if (Submitted)
+		{
+			*Submitted = 0;
+		}
+
+		// Allocate storage for every request first, so that an allocation failure leaves no request submitted.
+		request_node* head = nullptr;
+		request_node** tail = &head;
+		try
+		{
+			for (std::size_t i = 0; i != Requests.size(); ++i)
+			{
+				auto const node = static_cast<request_node*>(pool_alloc_traits::allocate(sizeof(request_node)));
+				*tail = node;
+				node->next = nullptr;
+				tail = &node->next;
+			}
+		}
+		catch (...)
+		{
+			while (head)
+			{
+				pool_alloc_traits::deallocate_unchecked(std::exchange(head, head->next));
+			}
+			throw;
+		}
+
+		mInFlight.fetch_add(Requests.size(), std::memory_order_relaxed);
+
+		for (std::size_t i = 0; i != Requests.size(); ++i)
+		{
+			auto const& request = Requests[i];
+			auto const node = std::exchange(head, head->next);
+			node->overlapped = {};
+			node->overlapped.Offset = static_cast<DWORD>(request.offset);
+			node->overlapped.OffsetHigh = static_cast<DWORD>(request.offset >> 32);
+			node->request = request;
+			node->failed_immediately = false;
+			node->error = ERROR_SUCCESS;
+
+			auto const issued = request.operation == async_io_operation::read ?
+				ReadFile(request.file, request.buffer, request.size, nullptr, &node->overlapped) :
+				WriteFile(request.file, request.buffer, request.size, nullptr, &node->overlapped);
+			if (!issued && GetLastError() != ERROR_IO_PENDING)
+			{
+				// The request failed immediately, so the system will not queue a completion. Queue one manually, so that the
+				// request is completed in the same way as every other.
+				node->failed_immediately = true;
+				node->error = GetLastError();
+				if (!PostQueuedCompletionStatus(mPort.get(), 0, 0, &node->overlapped))
+				{
+					auto const error = GetLastError();
+
+					// Neither this request nor the remaining requests were submitted. The requests before this one were, so their
+					// completions will still be dequeued.
+					pool_alloc_traits::deallocate_unchecked(node);
+					std::size_t notIssued = 1;
+					while (head)
+					{
+						pool_alloc_traits::deallocate_unchecked(std::exchange(head, head->next));
+						++notIssued;
+					}
+					mInFlight.fetch_sub(notIssued, std::memory_order_release);
+					throw_win32(error);
+				}
+			}
+
+			if (Submitted)
+			{
+				*Submitted = i + 1;
+			}
+		}
+	}
+
+	async_io_callback async_io_engine::complete(OVERLAPPED_ENTRY const& Entry, async_io_completion& Completion) noexcept
+	{
+		auto const node = CONTAINING_RECORD(Entry.lpOverlapped, request_node, overlapped);
+		Completion.request = node->request;
+		Completion.bytes_transferred = Entry.dwNumberOfBytesTransferred;
+		if (node->failed_immediately)
+		{
+			Completion.error = node->error;
+		}
+		else
+		{
+			// The status of the request is kept in the OVERLAPPED structure as an NTSTATUS; GetOverlappedResult converts it to a
+			// Win32 error code. The request has completed, so the function does not wait.
+			DWORD bytes;
+			Completion.error = GetOverlappedResult(node->request.file, &node->overlapped, &bytes, FALSE) ?
+				ERROR_SUCCESS : GetLastError();
+		}
+		pool_alloc_traits::deallocate_unchecked(node);
+		mInFlight.fetch_sub(1, std::memory_order_release);
+		return Completion.request.callback;
+	}
+
+	std::size_t async_io_engine::wait(std::span<async_io_completion> const Completions, std::uint32_t const Milliseconds)
+	{
+		OVERLAPPED_ENTRY entries[64];
+		auto const maxCount = static_cast<ULONG>((std::min)(Completions.size(), std::size(entries)));
+		if (maxCount == 0)
+		{
+			return 0;
+		}
+
+		ULONG count;
+		if (!GetQueuedCompletionStatusEx(mPort.get(), entries, maxCount, &count, Milliseconds, FALSE))
+		{
+			if (GetLastError() == WAIT_TIMEOUT)
+			{
+				return 0;
+			}
+			throw_last_error();
+		}
+
+		for (ULONG i = 0; i != count; ++i)
+		{
+			if (auto const callback = complete(entries[i], Completions[i]))
+			{
+				callback(Completions[i]);
+			}
+		}
+		return count;
+	}
+
+	std::size_t async_io_engine::dispatch(std::uint32_t const Milliseconds)
+	{
+		async_io_completion completions[64];
+		return wait(completions, Milliseconds);
+	}
+
+	void async_io_engine::drain()
+	{
+		while (in_flight() != 0)
+		{
+			dispatch();
+		}
+	}
+}
@@ -0,0 +1,381 @@
+// This file is part of the WillDaisey/WDUL (Windows Desktop Utility Library) project.
+// View this project on github: https://github.com/WillDaisey/wdul/
+
+// Measures the throughput and latency of allocate, reallocate, reallocate_zeroed and deallocate for each set of allocator
+// traits, for several block size distributions and thread counts.
+//
+// Each thread repeatedly allocates a batch of blocks, reallocates every block to a new size, reallocates every block back to
+// its original size with reallocate_zeroed, and deallocates the blocks in a random order. Each of the four steps is timed
+// separately. Block sizes are generated before each batch, so the timed loops only call the allocator.
+//
+// The reset_loop case measures a monotonic arena which is reset after every batch, and checks that its chunks are reused.
+
+#include "bench.hpp"
+#include "../include/wdul/memory.hpp"
+#include "../include/wdul/arena.hpp"
+#include "../include/wdul/counting_allocator.hpp"
+#include <exception>
+#include <latch>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+namespace wdul::bench::impl
+{
+	enum class size_distribution
+	{
+		// Uniformly distributed between 8 bytes and 256 bytes.
+		small,
+
+		// Log-uniformly distributed between 256 bytes and 16 KiB.
+		medium,
+
+		// Log-uniformly distributed between 64 KiB and 1 MiB.
+		large,
+
+		// 80% small, 15% medium and 5% large.
+		mixed,
+	};
+
+	inline constexpr size_distribution size_distributions[] = {
+		size_distribution::small, size_distribution::medium, size_distribution::large, size_distribution::mixed };
+
+	[[nodiscard]] constexpr char const* to_string(size_distribution const Distribution) noexcept
+	{
+		switch (Distribution)
+		{
+		case size_distribution::small: return "small";
+		case size_distribution::medium: return "medium";
+		case size_distribution::large: return "large";
+		default: return "mixed";
+		}
+	}
+
+	// Returns a size in [2^MinLog2, 2^MaxLog2) whose logarithm is uniformly distributed.
+	[[nodiscard]] std::size_t draw_log_uniform_size(random& Random, unsigned const MinLog2, unsigned const MaxLog2) noexcept
+	{
+		auto const log2 = static_cast<unsigned>(Random.between(MinLog2, MaxLog2 - 1));
+		auto const base = std::size_t(1) << log2;
+		return base + static_cast<std::size_t>(Random() % base);
+	}
+
+	[[nodiscard]] std::size_t draw_size(size_distribution const Distribution, random& Random) noexcept
+	{
+		switch (Distribution)
+		{
+		case size_distribution::small:
+			return static_cast<std::size_t>(Random.between(8, 256));
+		case size_distribution::medium:
+			return draw_log_uniform_size(Random, 8, 14);
+		case size_distribution::large:
+			return draw_log_uniform_size(Random, 16, 20);
+		default:
+			{
+				auto const pick = Random() % 100;
+				return draw_size(pick < 80 ? size_distribution::small : pick < 95 ? size_distribution::medium : size_distribution::large,
+					Random);
+			}
+		}
+	}
+
+	struct bench_counting_tag
+	{
+		static constexpr char const name[] = "bench";
+	};
+
+	struct arena_chunk_tag
+	{
+		static constexpr char const name[] = "arena chunks";
+	};
+
+	// Called after each batch has been deallocated, outside of the timed region.
+	template <allocate_traits AllocT>
+	void end_batch() noexcept
+	{
+		if constexpr (std::is_same_v<AllocT, arena_alloc_traits>)
+		{
+			// An arena only reclaims the most recently allocated block, so the batch, which is deallocated in a random order, would
+			// otherwise never be reclaimed.
+			arena_alloc_traits::arena().reset();
+		}
+	}
+
+	struct allocator_thread_results
+	{
+		latency_recorder allocate;
+		latency_recorder reallocate;
+		latency_recorder reallocate_zeroed;
+		latency_recorder deallocate;
+	};
+
+	inline constexpr std::size_t allocator_batch_size = 64;
+
+	template <allocate_traits AllocT>
+	void run_allocator_thread(size_distribution const Distribution, std::size_t const Operations, std::uint64_t const Seed,
+		allocator_thread_results& Results)
+	{
+		constexpr auto batchSize = allocator_batch_size;
+		auto const batches = (Operations + batchSize - 1) / batchSize;
+		Results.allocate.reserve(batches);
+		Results.reallocate.reserve(batches);
+		Results.reallocate_zeroed.reserve(batches);
+		Results.deallocate.reserve(batches);
+
+		random rng(Seed);
+		void* blocks[batchSize];
+		std::size_t sizes[batchSize];
+		std::size_t newSizes[batchSize];
+		std::size_t order[batchSize];
+
+		for (std::size_t b = 0; b != batches; ++b)
+		{
+			for (std::size_t i = 0; i != batchSize; ++i)
+			{
+				sizes[i] = draw_size(Distribution, rng);
+				newSizes[i] = draw_size(Distribution, rng);
+				order[i] = i;
+			}
+			for (std::size_t i = batchSize - 1; i != 0; --i)
+			{
+				std::swap(order[i], order[rng() % (i + 1)]);
+			}
+
+			auto start = get_performance_counts();
+			for (std::size_t i = 0; i != batchSize; ++i)
+			{
+				blocks[i] = AllocT::allocate(sizes[i]);
+			}
+			auto end = get_performance_counts();
+			Results.allocate.record(end - start, batchSize);
+
+			// A failed allocation ends the benchmark, so the blocks which were allocated are not deallocated.
+			for (auto const p : blocks)
+			{
+				if (!p)
+				{
+					throw std::bad_alloc();
+				}
+			}
+
+			bool failed = false;
+			start = get_performance_counts();
+			for (std::size_t i = 0; i != batchSize; ++i)
+			{
+				auto const p = AllocT::reallocate(blocks[i], newSizes[i]);
+				failed |= !p;
+				blocks[i] = p ? p : blocks[i];
+			}
+			end = get_performance_counts();
+			Results.reallocate.record(end - start, batchSize);
+
+			start = get_performance_counts();
+			for (std::size_t i = 0; i != batchSize; ++i)
+			{
+				auto const p = AllocT::reallocate_zeroed(blocks[i], sizes[i]);
+				failed |= !p;
+				blocks[i] = p ? p : blocks[i];
+			}
+			end = get_performance_counts();
+			Results.reallocate_zeroed.record(end - start, batchSize);
+
+			start = get_performance_counts();
+			for (auto const i : order)
+			{
+				AllocT::deallocate(blocks[i]);
+			}
+			end = get_performance_counts();
+			Results.deallocate.record(end - start, batchSize);
+
+			end_batch<AllocT>();
+			if (failed)
+			{
+				throw std::bad_alloc();
+			}
+		}
+	}
+
+	template <allocate_traits AllocT>
+	void run_allocator_case(options const& Options, std::string_view const TraitsName, size_distribution const Distribution,
+		unsigned const ThreadCount)
+	{
+		std::string variant(TraitsName);
+		variant += '/';
+		variant += to_string(Distribution);
+
+		static constexpr char const* operationNames[] = { "allocate", "reallocate", "reallocate_zeroed", "deallocate" };
+		bool any = false;
+		bool selectedOperations[4];
+		for (std::size_t i = 0; i != 4; ++i)
+		{
+			selectedOperations[i] = selected(Options, "allocator/" + std::string(operationNames[i]) + '/' + variant);
+			any |= selectedOperations[i];
+		}
+		if (!any)
+		{
+			return;
+		}
+
+		std::vector<allocator_thread_results> results(ThreadCount);
+		std::vector<std::exception_ptr> errors(ThreadCount);
+		std::latch ready(ThreadCount);
+		std::vector<std::thread> threads;
+		threads.reserve(ThreadCount);
+		for (unsigned t = 0; t != ThreadCount; ++t)
+		{
+			threads.emplace_back([&, t]()
+				{
+					bool arrived = false;
+					try
+					{
+						// Warm up the allocator's caches and the thread's state, such as its arena or pool cache, before timing.
+						allocator_thread_results warmup;
+						run_allocator_thread<AllocT>(Distribution, (std::max)(Options.operations / 16, allocator_batch_size), t + 1000, warmup);
+						arrived = true;
+						ready.arrive_and_wait();
+						run_allocator_thread<AllocT>(Distribution, Options.operations, t + 1, results[t]);
+					}
+					catch (...)
+					{
+						errors[t] = std::current_exception();
+						if (!arrived)
+						{
+							ready.count_down();
+						}
+					}
+				});
+		}
+		for (auto& t : threads)
+		{
+			t.join();
+		}
+		for (auto const& e : errors)
+		{
+			if (e)
+			{
+				std::rethrow_exception(e);
+			}
+		}
+
+		latency_recorder allocator_thread_results::* const recorders[] = {
+			&allocator_thread_results::allocate, &allocator_thread_results::reallocate,
+			&allocator_thread_results::reallocate_zeroed, &allocator_thread_results::deallocate };
+		for (std::size_t i = 0; i != 4; ++i)
+		{
+			if (!selectedOperations[i])
+			{
+				continue;
+			}
+			result r{};
+			r.suite = "allocator";
+			r.name = operationNames[i];
+			r.variant = variant;
+			r.threads = ThreadCount;
+			latency_recorder merged;
+			for (auto& threadResults : results)
+			{
+				auto const& recorder = threadResults.*recorders[i];
+				if (recorder.total_counts() > 0)
+				{
+					r.operations_per_sec += static_cast<double>(recorder.operations()) / (counts_to_ns(recorder.total_counts()) * 1e-9);
+				}
+				merged.merge(recorder);
+			}
+			merged.summarise(r);
+			write_result(Options, r);
+		}
+	}
+
+	template <allocate_traits AllocT>
+	void run_allocator_traits(options const& Options, std::string_view const TraitsName)
+	{
+		for (auto const distribution : size_distributions)
+		{
+			for (auto const threadCount : Options.threads)
+			{
+				run_allocator_case<AllocT>(Options, TraitsName, distribution, threadCount);
+			}
+		}
+	}
+
+	// Allocates a batch of blocks from an arena and resets the arena, over and over, as a per-frame arena would be used. Only
+	// allocate is timed.
+	//
+	// Every 16th block is large, and the small blocks between them fit in one chunk of the default size, so a batch moves to
+	// another chunk at most twice for each large block. Chunks are counted through counting_alloc_traits; if the arena retains
+	// more chunks than a batch can use, the chunks kept by reset are not being reused, and the case throws.
+	void run_arena_reset_loop(options const& Options)
+	{
+		if (!selected(Options, "allocator/reset_loop/monotonic_arena/mixed"))
+		{
+			return;
+		}
+
+		using chunk_traits = counting_alloc_traits<malloc_traits, arena_chunk_tag>;
+		constexpr auto batchSize = allocator_batch_size;
+		constexpr std::size_t largeInterval = 16;
+		constexpr auto maxChunks = 2 * (batchSize / largeInterval) + 1;
+		auto const batches = (Options.operations + batchSize - 1) / batchSize;
+		auto const before = chunk_traits::stats();
+
+		latency_recorder recorder;
+		recorder.reserve(batches);
+		{
+			basic_monotonic_arena<chunk_traits> arena;
+			random rng(1);
+			std::size_t sizes[batchSize];
+			for (std::size_t b = 0; b != batches; ++b)
+			{
+				for (std::size_t i = 0; i != batchSize; ++i)
+				{
+					sizes[i] = draw_size(i % largeInterval == largeInterval - 1 ? size_distribution::large : size_distribution::small, rng);
+				}
+
+				auto const start = get_performance_counts();
+				for (auto const size : sizes)
+				{
+					(void)arena.allocate(size);
+				}
+				auto const end = get_performance_counts();
+				recorder.record(end - start, batchSize);
+				arena.reset();
+			}
+
+			auto const after = chunk_traits::stats();
+			auto const chunks = (after.allocations - before.allocations) - (after.deallocations - before.deallocations);
+			if (chunks > maxChunks)
+			{
+				throw std::runtime_error("allocator/reset_loop: monotonic_arena retained " + std::to_string(chunks) + " chunks");
+			}
+		}
+
+		result r{};
+		r.suite = "allocator";
+		r.name = "reset_loop";
+		r.variant = "monotonic_arena/mixed";
+		r.threads = 1;
+		if (recorder.total_counts() > 0)
+		{
+			r.operations_per_sec = static_cast<double>(recorder.operations()) / (counts_to_ns(recorder.total_counts()) * 1e-9);
+		}
+		recorder.summarise(r);
+		write_result(Options, r);
+	}
+}
+
+namespace wdul::bench
+{
+	void run_allocator_suite(options const& Options)
+	{
+		impl::run_allocator_traits<malloc_traits>(Options, "malloc_traits");
+		impl::run_allocator_traits<local_alloc_traits>(Options, "local_alloc_traits");
+		impl::run_allocator_traits<heap_alloc_traits>(Options, "heap_alloc_traits");
+		impl::run_allocator_traits<pool_alloc_traits>(Options, "pool_alloc_traits");
+		impl::run_allocator_traits<arena_alloc_traits>(Options, "arena_alloc_traits");
+		impl::run_allocator_traits<counting_alloc_traits<malloc_traits, impl::bench_counting_tag>>(Options,
+			"counting_alloc_traits<malloc_traits>");
+		impl::run_allocator_traits<counting_alloc_traits<pool_alloc_traits, impl::bench_counting_tag>>(Options,
+			"counting_alloc_traits<pool_alloc_traits>");
+		impl::run_arena_reset_loop(Options);
+	}
+}
@@ -0,0 +1,143 @@
+// This file is part of the WillDaisey/WDUL (Windows Desktop Utility Library) project.
+// View this project on github: https://github.com/WillDaisey/wdul/
+
+#pragma once
+#include "../include/wdul/time.hpp"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace wdul::bench
+{
+	enum class output_format
+	{
+		csv,
+		json,
+	};
+
+	struct options
+	{
+		// The number of operations each thread performs for each case.
+		std::size_t operations = 50'000;
+
+		// The thread counts to run each multithreaded case with.
+		std::vector<unsigned> threads;
+
+		// Only cases whose name contains this string are run.
+		std::string filter;
+
+		output_format format = output_format::csv;
+	};
+
+	// One row of benchmark output.
+	struct result
+	{
+		std::string_view suite;
+		std::string name;
+		std::string variant;
+		unsigned threads;
+		std::uint64_t operations;
+
+		// The number of bytes processed by the operations, or zero if throughput in bytes is not meaningful for the case.
+		std::uint64_t bytes;
+
+		// The sum of each thread's time spent performing the operations.
+		double seconds;
+
+		// Operations per second, summed over every thread.
+		double operations_per_sec;
+
+		// Latency percentiles in nanoseconds. Zero if the case does not measure latency.
+		double p50_ns;
+		double p90_ns;
+		double p99_ns;
+		double p999_ns;
+		double max_ns;
+	};
+
+	// Converts a performance counter interval to nanoseconds.
+	[[nodiscard]] inline double counts_to_ns(std::int64_t const Counts) noexcept
+	{
+		static double const nsPerCount = 1e9 / static_cast<double>(get_performance_counts_per_sec());
+		return static_cast<double>(Counts) * nsPerCount;
+	}
+
+	/// <summary>
+	/// Collects latency samples, each measured in performance counts, and computes percentiles over them.
+	/// <para>
+	/// The performance counter is too coarse to time a single allocation on most systems, so callers time a batch of operations
+	/// and record the mean time of one operation in the batch.
+	/// </para>
+	/// </summary>
+	class latency_recorder
+	{
+	public:
+		void reserve(std::size_t const Count)
+		{
+			mSamples.reserve(Count);
+		}
+
+		// Records a batch of OperationCount operations which took Counts performance counts in total.
+		void record(std::int64_t const Counts, std::size_t const OperationCount)
+		{
+			mSamples.push_back(counts_to_ns(Counts) / static_cast<double>(OperationCount));
+			mTotalCounts += Counts;
+			mOperations += OperationCount;
+		}
+
+		// Appends the samples of Other to this recorder.
+		void merge(latency_recorder const& Other);
+
+		// Fills the operation count, time and latency fields of Result. The samples are sorted.
+		void summarise(result& Result);
+
+		[[nodiscard]] std::uint64_t operations() const noexcept { return mOperations; }
+		[[nodiscard]] std::int64_t total_counts() const noexcept { return mTotalCounts; }
+
+	private:
+		std::vector<double> mSamples;
+		std::int64_t mTotalCounts = 0;
+		std::uint64_t mOperations = 0;
+	};
+
+	// A small, fast pseudo-random number generator (xorshift64*), so that results are reproducible and generating inputs does
+	// not dominate the measurements.
+	class random
+	{
+	public:
+		explicit random(std::uint64_t const Seed) noexcept :
+			mState(Seed ? Seed : 0x9E3779B97F4A7C15)
+		{
+		}
+
+		std::uint64_t operator()() noexcept
+		{
+			mState ^= mState >> 12;
+			mState ^= mState << 25;
+			mState ^= mState >> 27;
+			return mState * 0x2545F4914F6CDD1D;
+		}
+
+		// Returns a number in [Min, Max].
+		std::uint64_t between(std::uint64_t const Min, std::uint64_t const Max) noexcept
+		{
+			return Min + (*this)() % (Max - Min + 1);
+		}
+
+	private:
+		std::uint64_t mState;
+	};
+
+	// Returns true if the case named Name should run.
+	[[nodiscard]] bool selected(options const& Options, std::string_view const Name);
+
+	void write_header(options const& Options);
+	void write_result(options const& Options, result const& Result);
+	void write_footer(options const& Options);
+
+	// Suites. Each runs every selected case and writes one result per case.
+	void run_allocator_suite(options const& Options);
+	void run_parse_suite(options const& Options);
+	void run_io_suite(options const& Options);
+}
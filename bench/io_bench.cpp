@@ -0,0 +1,141 @@
+// This file is part of the WillDaisey/WDUL (Windows Desktop Utility Library) project.
+// View this project on github: https://github.com/WillDaisey/wdul/
+
+// Measures the throughput of fwritev_at and freadv_at, and checks that the bytes read back match those written.
+//
+// Each operation writes a random sequence of buffers to a temporary file with fwritev_at, then reads the same region back with
+// freadv_at, into a sequence of buffers split at different points. Buffers range from empty to 40 KB, so runs of small buffers
+// transferred through the bounce buffer, large buffers transferred directly, and empty buffers at either end of a run are all
+// exercised. The file is small enough to stay in the system file cache, so the results measure the calls rather than the
+// storage device.
+
+#include "bench.hpp"
+#include "../include/wdul/fs.hpp"
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+namespace wdul::bench::impl
+{
+	inline constexpr wchar_t io_filename[] = L"wdul_bench_io.tmp";
+
+	// The largest number of buffers written by one call.
+	inline constexpr std::size_t io_max_buffers = 12;
+
+	// The largest size of a buffer.
+	inline constexpr std::size_t io_max_buffer_size = 40'000;
+
+	// Returns a buffer size: empty one time in eight, up to io_max_buffer_size bytes one time in four, and otherwise up to 3 KB,
+	// so that several buffers usually fit in the bounce buffer together.
+	[[nodiscard]] std::size_t draw_io_buffer_size(random& Random) noexcept
+	{
+		auto const pick = Random() % 8;
+		if (pick == 0)
+		{
+			return 0;
+		}
+		return static_cast<std::size_t>(pick < 3 ? Random.between(1, io_max_buffer_size) : Random.between(1, 3'000));
+	}
+
+	void run_vectored_case(options const& Options)
+	{
+		auto const writeSelected = selected(Options, "io/fwritev_at/mixed");
+		auto const readSelected = selected(Options, "io/freadv_at/mixed");
+		if (!writeSelected && !readSelected)
+		{
+			return;
+		}
+
+		auto const file = fopen(io_filename, file_open_mode::create_always, FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE,
+			generic_access::read | generic_access::write, file_share_mode::none);
+
+		std::vector<std::uint8_t> source(io_max_buffers * io_max_buffer_size);
+		std::vector<std::uint8_t> target(source.size());
+		std::vector<file_write_buffer> writeBuffers;
+		std::vector<file_read_buffer> readBuffers;
+		latency_recorder writes;
+		latency_recorder reads;
+		writes.reserve(Options.operations);
+		reads.reserve(Options.operations);
+		std::uint64_t bytes = 0;
+		random rng(1);
+
+		for (std::size_t operation = 0; operation != Options.operations; ++operation)
+		{
+			writeBuffers.clear();
+			std::size_t total = 0;
+			auto const count = rng.between(1, io_max_buffers);
+			for (std::uint64_t i = 0; i != count; ++i)
+			{
+				auto const size = draw_io_buffer_size(rng);
+				writeBuffers.push_back({ .data = source.data() + total, .size = size });
+				total += size;
+			}
+			for (std::size_t i = 0; i < total; i += sizeof(std::uint64_t))
+			{
+				auto const value = rng();
+				std::memcpy(source.data() + i, &value, (std::min)(sizeof(value), total - i));
+			}
+
+			// Split the same bytes at different points, sometimes with empty buffers after the last byte.
+			readBuffers.clear();
+			for (std::size_t read = 0; read < total;)
+			{
+				auto const size = (std::min)(draw_io_buffer_size(rng), total - read);
+				readBuffers.push_back({ .data = target.data() + read, .size = size });
+				read += size;
+			}
+			for (auto i = rng() % 3; i != 0; --i)
+			{
+				readBuffers.push_back({ .data = target.data() + total, .size = 0 });
+			}
+			std::memset(target.data(), 0, total);
+
+			auto const offset = rng.between(0, 4096);
+			auto start = get_performance_counts();
+			fwritev_at(file.get(), offset, writeBuffers);
+			auto end = get_performance_counts();
+			writes.record(end - start, 1);
+
+			start = get_performance_counts();
+			auto const bytesRead = freadv_at(file.get(), offset, readBuffers);
+			end = get_performance_counts();
+			reads.record(end - start, 1);
+
+			if (bytesRead != total || std::memcmp(source.data(), target.data(), total) != 0)
+			{
+				throw std::runtime_error("io/freadv_at: the bytes read differ from the bytes written");
+			}
+			bytes += total;
+		}
+
+		auto const writeResult = [&](char const* const Name, latency_recorder& Recorder)
+		{
+			result r{};
+			r.suite = "io";
+			r.name = Name;
+			r.variant = "mixed";
+			r.threads = 1;
+			r.bytes = bytes;
+			Recorder.summarise(r);
+			r.operations_per_sec = r.seconds > 0 ? static_cast<double>(r.operations) / r.seconds : 0.0;
+			write_result(Options, r);
+		};
+		if (writeSelected)
+		{
+			writeResult("fwritev_at", writes);
+		}
+		if (readSelected)
+		{
+			writeResult("freadv_at", reads);
+		}
+	}
+}
+
+namespace wdul::bench
+{
+	void run_io_suite(options const& Options)
+	{
+		impl::run_vectored_case(Options);
+	}
+}
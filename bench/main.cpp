@@ -0,0 +1,230 @@
+// This file is part of the WillDaisey/WDUL (Windows Desktop Utility Library) project.
+// View this project on github: https://github.com/WillDaisey/wdul/
+
+// Usage: wdul_bench [--suite <name>] [--filter <text>] [--threads <n,n,...>] [--operations <n>] [--format csv|json]
+//
+// Writes one row per case to the standard output, as CSV (the default) or as a JSON array, so that results can be compared
+// between builds. Case names have the form "suite/operation/variant"; --filter selects the cases whose name contains the
+// given text.
+
+#include "bench.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <thread>
+
+namespace wdul::bench::impl
+{
+	// True until the first result has been written.
+	bool first_row = true;
+
+	[[nodiscard]] bool parse_unsigned(char const* const Text, std::size_t& Value) noexcept
+	{
+		auto const end = Text + std::strlen(Text);
+		auto const r = std::from_chars(Text, end, Value);
+		return r.ec == std::errc() && r.ptr == end;
+	}
+
+	[[nodiscard]] bool parse_thread_counts(std::string_view Text, std::vector<unsigned>& Threads)
+	{
+		Threads.clear();
+		while (!Text.empty())
+		{
+			auto const comma = Text.find(',');
+			auto const item = Text.substr(0, comma);
+			unsigned value;
+			auto const r = std::from_chars(item.data(), item.data() + item.size(), value);
+			if (r.ec != std::errc() || r.ptr != item.data() + item.size() || value == 0)
+			{
+				return false;
+			}
+			Threads.push_back(value);
+			Text.remove_prefix(comma == std::string_view::npos ? Text.size() : comma + 1);
+		}
+		return !Threads.empty();
+	}
+
+	void print_usage()
+	{
+		std::fputs("usage: wdul_bench [--suite <name>] [--filter <text>] [--threads <n,n,...>] [--operations <n>] "
+			"[--format csv|json]\nsuites: allocator, parse, io\n", stderr);
+	}
+}
+
+namespace wdul::bench
+{
+	void latency_recorder::merge(latency_recorder const& Other)
+	{
+		mSamples.insert(mSamples.end(), Other.mSamples.begin(), Other.mSamples.end());
+		mTotalCounts += Other.mTotalCounts;
+		mOperations += Other.mOperations;
+	}
+
+	void latency_recorder::summarise(result& Result)
+	{
+		Result.operations = mOperations;
+		Result.seconds = counts_to_ns(mTotalCounts) * 1e-9;
+		if (mSamples.empty())
+		{
+			Result.p50_ns = Result.p90_ns = Result.p99_ns = Result.p999_ns = Result.max_ns = 0;
+			return;
+		}
+		std::sort(mSamples.begin(), mSamples.end());
+		auto const percentile = [this](double const P)
+		{
+			return mSamples[static_cast<std::size_t>(P * static_cast<double>(mSamples.size() - 1) + 0.5)];
+		};
+		Result.p50_ns = percentile(0.5);
+		Result.p90_ns = percentile(0.9);
+		Result.p99_ns = percentile(0.99);
+		Result.p999_ns = percentile(0.999);
+		Result.max_ns = mSamples.back();
+	}
+
+	[[nodiscard]] bool selected(options const& Options, std::string_view const Name)
+	{
+		return Options.filter.empty() || Name.find(Options.filter) != std::string_view::npos;
+	}
+
+	void write_header(options const& Options)
+	{
+		if (Options.format == output_format::csv)
+		{
+			std::puts("suite,name,variant,threads,operations,bytes,seconds,operations_per_sec,mb_per_sec,p50_ns,p90_ns,p99_ns,p999_ns,max_ns");
+		}
+		else
+		{
+			std::puts("[");
+		}
+	}
+
+	void write_result(options const& Options, result const& Result)
+	{
+		// Bytes per second is computed from the mean time per thread, so that it reports the aggregate rate of every thread.
+		auto const mbPerSec = Result.seconds > 0 ?
+			static_cast<double>(Result.bytes) / (Result.seconds / Result.threads) / 1e6 : 0.0;
+
+		if (Options.format == output_format::csv)
+		{
+			std::printf("%.*s,%s,%s,%u,%llu,%llu,%.6f,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f\n",
+				static_cast<int>(Result.suite.size()), Result.suite.data(), Result.name.c_str(), Result.variant.c_str(),
+				Result.threads, static_cast<unsigned long long>(Result.operations), static_cast<unsigned long long>(Result.bytes),
+				Result.seconds, Result.operations_per_sec, mbPerSec,
+				Result.p50_ns, Result.p90_ns, Result.p99_ns, Result.p999_ns, Result.max_ns);
+		}
+		else
+		{
+			std::printf("%s  {\"suite\": \"%.*s\", \"name\": \"%s\", \"variant\": \"%s\", \"threads\": %u, \"operations\": %llu, "
+				"\"bytes\": %llu, \"seconds\": %.6f, \"operations_per_sec\": %.1f, \"mb_per_sec\": %.1f, "
+				"\"p50_ns\": %.1f, \"p90_ns\": %.1f, \"p99_ns\": %.1f, \"p999_ns\": %.1f, \"max_ns\": %.1f}",
+				impl::first_row ? "" : ",\n",
+				static_cast<int>(Result.suite.size()), Result.suite.data(), Result.name.c_str(), Result.variant.c_str(),
+				Result.threads, static_cast<unsigned long long>(Result.operations), static_cast<unsigned long long>(Result.bytes),
+				Result.seconds, Result.operations_per_sec, mbPerSec,
+				Result.p50_ns, Result.p90_ns, Result.p99_ns, Result.p999_ns, Result.max_ns);
+		}
+		impl::first_row = false;
+		std::fflush(stdout);
+	}
+
+	void write_footer(options const& Options)
+	{
+		if (Options.format == output_format::json)
+		{
+			std::puts(impl::first_row ? "]" : "\n]");
+		}
+	}
+}
+
+int main(int const Argc, char** const Argv)
+{
+	using namespace wdul::bench;
+
+	options opts;
+	std::string_view suite;
+	for (int i = 1; i < Argc; ++i)
+	{
+		std::string_view const arg = Argv[i];
+		if (i + 1 == Argc)
+		{
+			impl::print_usage();
+			return 2;
+		}
+		char const* const value = Argv[++i];
+		if (arg == "--suite")
+		{
+			suite = value;
+		}
+		else if (arg == "--filter")
+		{
+			opts.filter = value;
+		}
+		else if (arg == "--threads")
+		{
+			if (!impl::parse_thread_counts(value, opts.threads))
+			{
+				impl::print_usage();
+				return 2;
+			}
+		}
+		else if (arg == "--operations")
+		{
+			if (!impl::parse_unsigned(value, opts.operations) || opts.operations == 0)
+			{
+				impl::print_usage();
+				return 2;
+			}
+		}
+		else if (arg == "--format" && (std::strcmp(value, "csv") == 0 || std::strcmp(value, "json") == 0))
+		{
+			opts.format = std::strcmp(value, "csv") == 0 ? output_format::csv : output_format::json;
+		}
+		else
+		{
+			impl::print_usage();
+			return 2;
+		}
+	}
+
+	if (opts.threads.empty())
+	{
+		auto const hardware = (std::max)(std::thread::hardware_concurrency(), 1u);
+		for (unsigned n = 1; n < hardware; n *= 2)
+		{
+			opts.threads.push_back(n);
+		}
+		opts.threads.push_back(hardware);
+	}
+
+	if (!suite.empty() && suite != "allocator" && suite != "parse" && suite != "io")
+	{
+		impl::print_usage();
+		return 2;
+	}
+
+	try
+	{
+		write_header(opts);
+		if (suite.empty() || suite == "allocator")
+		{
+			run_allocator_suite(opts);
+		}
+		if (suite.empty() || suite == "parse")
+		{
+			run_parse_suite(opts);
+		}
+		if (suite.empty() || suite == "io")
+		{
+			run_io_suite(opts);
+		}
+		write_footer(opts);
+	}
+	catch (std::exception const& e)
+	{
+		std::fprintf(stderr, "wdul_bench: %s\n", e.what());
+		return 1;
+	}
+	return 0;
+}
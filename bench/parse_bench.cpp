@@ -0,0 +1,216 @@
+// This file is part of the WillDaisey/WDUL (Windows Desktop Utility Library) project.
+// View this project on github: https://github.com/WillDaisey/wdul/
+
+// Measures the throughput of find_delimiter and delimiter_matcher, in the way freadline uses them, for single character (LF)
+// and two character (CR+LF) delimiters, and of delimiter_set_matcher for lines with mixed line endings. find_delimiter is
+// measured with each set of instructions supported by the processor.
+//
+// A buffer of random text is split into lines by calling find_delimiter repeatedly, each call starting after the previous
+// match, until the buffer is exhausted. The buffer is small enough to stay in the cache, so the results measure the scan
+// rather than memory bandwidth.
+
+#include "bench.hpp"
+#include "../include/wdul/parse.hpp"
+
+namespace wdul::bench::impl
+{
+	using wdul::impl::find_delimiter_isa;
+
+	inline constexpr std::size_t parse_buffer_size = std::size_t(1) << 20;
+
+	enum class line_length
+	{
+		// Uniformly distributed between 0 and 80 characters, excluding the delimiter.
+		short_lines,
+
+		// Uniformly distributed between 1 KiB and 8 KiB.
+		long_lines,
+	};
+
+	[[nodiscard]] constexpr char const* to_string(line_length const Length) noexcept
+	{
+		return Length == line_length::short_lines ? "short" : "long";
+	}
+
+	[[nodiscard]] constexpr char const* to_string(find_delimiter_isa const Isa) noexcept
+	{
+		switch (Isa)
+		{
+		case find_delimiter_isa::scalar: return "scalar";
+		case find_delimiter_isa::sse2: return "sse2";
+		default: return "avx2";
+		}
+	}
+
+	// Fills Text with lines of printable characters, each terminated by one of Delims, chosen at random. The final line may be
+	// cut short.
+	void generate_lines(std::u8string& Text, std::span<std::u8string_view const> const Delims, line_length const Length,
+		std::uint64_t const Seed)
+	{
+		random rng(Seed);
+		Text.clear();
+		Text.reserve(parse_buffer_size);
+		while (Text.size() < parse_buffer_size)
+		{
+			auto const n = Length == line_length::short_lines ? rng.between(0, 80) : rng.between(1 << 10, 8 << 10);
+			for (std::uint64_t i = 0; i != n; ++i)
+			{
+				Text.push_back(static_cast<char8_t>(rng.between(u8' ', u8'~')));
+			}
+			Text.append(Delims[Delims.size() == 1 ? 0 : rng() % Delims.size()]);
+		}
+		Text.resize(parse_buffer_size);
+	}
+
+	// Times Split, which splits Text into lines and returns the number of lines found, and writes the result.
+	template <class SplitT>
+	void run_split_case(options const& Options, std::string_view const Name, std::string Variant, std::u8string const& Text,
+		SplitT&& Split)
+	{
+		// Warm up the cache with the buffer before timing.
+		Split();
+
+		// Each operation is one line. Whole passes are timed, until at least the requested number of lines have been found.
+		latency_recorder recorder;
+		std::uint64_t bytes = 0;
+		while (recorder.operations() < Options.operations)
+		{
+			auto const start = get_performance_counts();
+			auto const lines = Split();
+			auto const end = get_performance_counts();
+			recorder.record(end - start, lines);
+			bytes += Text.size();
+		}
+
+		result r{};
+		r.suite = "parse";
+		r.name = Name;
+		r.variant = std::move(Variant);
+		r.threads = 1;
+		r.bytes = bytes;
+		recorder.summarise(r);
+		r.operations_per_sec = r.seconds > 0 ? static_cast<double>(r.operations) / r.seconds : 0.0;
+		write_result(Options, r);
+	}
+
+	void run_find_delimiter_case(options const& Options, std::u8string_view const Delim, std::string_view const DelimName,
+		line_length const Length, find_delimiter_isa const Isa)
+	{
+		std::string variant(to_string(Isa));
+		variant += '/';
+		variant += DelimName;
+		variant += '/';
+		variant += to_string(Length);
+		if (!selected(Options, "parse/find_delimiter/" + variant))
+		{
+			return;
+		}
+
+		std::u8string text;
+		generate_lines(text, { &Delim, 1 }, Length, 1);
+		range<char8_t const> const delim{ .first = Delim.data(), .last = Delim.data() + Delim.size() };
+
+		run_split_case(Options, "find_delimiter", std::move(variant), text, [&]() noexcept
+			{
+				std::size_t lines = 0;
+				range<char8_t const> remaining{ .first = text.data(), .last = text.data() + text.size() };
+				while (remaining.first != remaining.last)
+				{
+					auto const match = wdul::impl::find_delimiter(remaining, delim, Isa);
+					if (static_cast<std::size_t>(match.last - match.first) != Delim.size())
+					{
+						break;
+					}
+					remaining.first = match.last;
+					++lines;
+				}
+				return lines;
+			});
+	}
+
+	void run_delimiter_matcher_case(options const& Options, std::u8string_view const Delim, std::string_view const DelimName,
+		line_length const Length)
+	{
+		std::string variant(DelimName);
+		variant += '/';
+		variant += to_string(Length);
+		if (!selected(Options, "parse/delimiter_matcher/" + variant))
+		{
+			return;
+		}
+
+		std::u8string text;
+		generate_lines(text, { &Delim, 1 }, Length, 1);
+		delimiter_matcher matcher({ .first = Delim.data(), .last = Delim.data() + Delim.size() });
+
+		run_split_case(Options, "delimiter_matcher", std::move(variant), text, [&]() noexcept
+			{
+				std::size_t lines = 0;
+				matcher.reset();
+				range<char8_t const> remaining{ .first = text.data(), .last = text.data() + text.size() };
+				while (auto const matchLast = matcher.feed(remaining))
+				{
+					remaining.first = matchLast;
+					++lines;
+				}
+				return lines;
+			});
+	}
+
+	void run_delimiter_set_case(options const& Options, line_length const Length)
+	{
+		std::string variant("any_newline/");
+		variant += to_string(Length);
+		if (!selected(Options, "parse/delimiter_set_matcher/" + variant))
+		{
+			return;
+		}
+
+		// Lines end with CR+LF, LF or CR at random.
+		std::u8string_view const delims[] = { u8"\r\n", u8"\n", u8"\r" };
+		std::u8string text;
+		generate_lines(text, delims, Length, 1);
+		delimiter_set_matcher matcher(newline_delimiters());
+
+		run_split_case(Options, "delimiter_set_matcher", std::move(variant), text, [&]() noexcept
+			{
+				std::size_t lines = 0;
+				matcher.reset();
+				delimiter_set_match match;
+				while (matcher.feed({ .first = text.data() + matcher.position(), .last = text.data() + text.size() }, match))
+				{
+					++lines;
+				}
+				return lines;
+			});
+	}
+}
+
+namespace wdul::bench
+{
+	void run_parse_suite(options const& Options)
+	{
+		using wdul::impl::find_delimiter_isa;
+
+		auto const best = wdul::impl::find_delimiter_best_isa();
+		for (auto const isa : { find_delimiter_isa::scalar, find_delimiter_isa::sse2, find_delimiter_isa::avx2 })
+		{
+			if (isa > best)
+			{
+				break;
+			}
+			for (auto const length : { impl::line_length::short_lines, impl::line_length::long_lines })
+			{
+				impl::run_find_delimiter_case(Options, u8"\n", "lf", length, isa);
+				impl::run_find_delimiter_case(Options, u8"\r\n", "crlf", length, isa);
+			}
+		}
+
+		for (auto const length : { impl::line_length::short_lines, impl::line_length::long_lines })
+		{
+			impl::run_delimiter_matcher_case(Options, u8"\n", "lf", length);
+			impl::run_delimiter_matcher_case(Options, u8"\r\n", "crlf", length);
+			impl::run_delimiter_set_case(Options, length);
+		}
+	}
+}
@@ -0,0 +1,440 @@
+// This file is part of the WillDaisey/WDUL (Windows Desktop Utility Library) project.
+// View this project on github: https://github.com/WillDaisey/wdul/
+
+#include "include/wdul/buffered_file.hpp"
+#include "include/wdul/thread.hpp"
+#include "include/wdul/virtual_memory.hpp"
+#include <algorithm>
+#include <exception>
+#include <limits>
+#include <thread>
+
+namespace wdul
+{
+	buffered_file_reader::buffered_file_reader(file_handle File, std::size_t const BufferSize) :
+		buffered_file_reader()
+	{
+		WDUL_ASSERT(BufferSize != 0);
+		mBuffer = byte_array(BufferSize);
+		mData = mBuffer.data();
+		mBufferPos = fgetpos(File.get());
+		mFileSource = file_source(std::move(File), static_cast<std::uint64_t>(mBufferPos));
+		mSource = &mFileSource;
+	}
+
+	[[nodiscard]] fopen_code buffered_file_reader::open(_In_z_ wchar_t const* const Filename, std::size_t const BufferSize)
+	{
+		WDUL_ASSERT(BufferSize != 0);
+		close();
+		if (mBuffer.size() != BufferSize)
+		{
+			mBuffer = byte_array(BufferSize);
+		}
+		mData = mBuffer.data();
+		auto const code = mFileSource.open(Filename);
+		if (code == fopen_code::success)
+		{
+			mSource = &mFileSource;
+		}
+		return code;
+	}
+
+	void buffered_file_reader::share(_In_ HANDLE const File, std::int64_t const Position, std::size_t const BufferSize)
+	{
+		WDUL_ASSERT(File != nullptr && File != INVALID_HANDLE_VALUE);
+		WDUL_ASSERT(Position >= 0);
+		WDUL_ASSERT(BufferSize != 0);
+		close();
+		if (mBuffer.size() != BufferSize)
+		{
+			mBuffer = byte_array(BufferSize);
+		}
+		mData = mBuffer.data();
+		mFileSource.share(File, static_cast<std::uint64_t>(Position));
+		mSource = &mFileSource;
+		mBufferPos = Position;
+	}
+
+	void buffered_file_reader::attach(byte_source& Source, std::size_t const BufferSize)
+	{
+		WDUL_ASSERT(BufferSize != 0);
+		close();
+		if (mBuffer.size() != BufferSize)
+		{
+			mBuffer = byte_array(BufferSize);
+		}
+		mData = mBuffer.data();
+		mSource = &Source;
+		mBufferPos = static_cast<std::int64_t>(Source.position());
+	}
+
+	void buffered_file_reader::close() noexcept
+	{
+		mFileSource.close();
+		mSource = nullptr;
+		mData = mBuffer.data();
+		mCursor = 0;
+		mEnd = 0;
+		mBufferPos = 0;
+	}
+
+	void buffered_file_reader::seek(std::int64_t const Position)
+	{
+		WDUL_ASSERT(Position >= 0);
+		if (Position >= mBufferPos && Position <= mBufferPos + static_cast<std::int64_t>(mEnd))
+		{
+			mCursor = static_cast<std::size_t>(Position - mBufferPos);
+			return;
+		}
+		mSource->seek(static_cast<std::uint64_t>(Position));
+		mBufferPos = Position;
+		mData = mBuffer.data();
+		mCursor = 0;
+		mEnd = 0;
+	}
+
+	std::size_t buffered_file_reader::read(_Out_writes_bytes_to_(Size, return) void* const Buffer, std::size_t const Size)
+	{
+		auto out = static_cast<std::uint8_t*>(Buffer);
+		auto remaining = Size;
+		while (remaining != 0)
+		{
+			if (mCursor == mEnd)
+			{
+				if (remaining >= mBuffer.size() && !mSource->borrowable())
+				{
+					// Large reads bypass the buffer.
+					auto const bytesRead = mSource->read({ out, remaining });
+					if (bytesRead == 0)
+					{
+						break;
+					}
+					mBufferPos += static_cast<std::int64_t>(mEnd + bytesRead);
+					mData = mBuffer.data();
+					mCursor = 0;
+					mEnd = 0;
+					out += bytesRead;
+					remaining -= bytesRead;
+					continue;
+				}
+				if (refill() == 0)
+				{
+					break;
+				}
+			}
+			auto const count = (std::min)(remaining, mEnd - mCursor);
+			std::memcpy(out, mData + mCursor, count);
+			mCursor += count;
+			out += count;
+			remaining -= count;
+		}
+		return Size - remaining;
+	}
+
+	std::size_t buffered_file_reader::refill()
+	{
+		WDUL_ASSERT(is_open());
+		if (mCursor == mEnd && mSource->borrowable())
+		{
+			mBufferPos += static_cast<std::int64_t>(mEnd);
+			auto const bytes = mSource->borrow((std::numeric_limits<std::size_t>::max)());
+			mData = bytes.empty() ? mBuffer.data() : bytes.data();
+			mCursor = 0;
+			mEnd = bytes.size();
+			return mEnd;
+		}
+
+		if (mCursor != 0 || mData != mBuffer.data())
+		{
+			// The unconsumed bytes may be borrowed, in which case they are copied, since the source may reuse them once it is
+			// read again.
+			if (mEnd != mCursor)
+			{
+				std::memmove(mBuffer.data(), mData + mCursor, mEnd - mCursor);
+			}
+			mData = mBuffer.data();
+			mBufferPos += static_cast<std::int64_t>(mCursor);
+			mEnd -= mCursor;
+			mCursor = 0;
+		}
+		auto const free = mBuffer.size() - mEnd;
+		if (free == 0)
+		{
+			return 0;
+		}
+		auto const bytesRead = mSource->read({ mBuffer.data() + mEnd, free });
+		mEnd += bytesRead;
+		return bytesRead;
+	}
+
+	namespace impl
+	{
+		// Writes Size bytes from Data to the file at Offset.
+		void write_all_at(_In_ HANDLE const File, std::uint64_t Offset, _In_reads_bytes_(Size) void const* const Data, std::size_t Size)
+		{
+			auto in = static_cast<std::uint8_t const*>(Data);
+			while (Size != 0)
+			{
+				auto const bytesWritten = fwrite_at(File, Offset, static_cast<std::uint32_t>((std::min)(Size, std::size_t(1) << 30)), in);
+				if (bytesWritten == 0)
+				{
+					throw_win32(ERROR_WRITE_FAULT);
+				}
+				Offset += bytesWritten;
+				in += bytesWritten;
+				Size -= bytesWritten;
+			}
+		}
+
+		class write_behind
+		{
+		public:
+			write_behind(_In_ HANDLE const File, std::size_t const BufferSize) :
+				mFile(File),
+				mBuffer(BufferSize),
+				mOffset(0),
+				mSize(0),
+				mStop(false),
+				mReady(create_event(event_access_mask(standard_access::synchronize, event_access::modify_state))),
+				mIdle(create_event(event_access_mask(standard_access::synchronize, event_access::modify_state),
+					event_create_flags::manual_reset | event_create_flags::initial_set)),
+				mThread([this]() { run(); })
+			{
+			}
+
+			~write_behind()
+			{
+				WDUL_DEBUG_RAISE_LAST_ERROR_WHEN(WaitForSingleObjectEx(mIdle.get(), INFINITE, false), == WAIT_FAILED);
+				mStop = true;
+				WDUL_DEBUG_RAISE_LAST_ERROR_WHEN(SetEvent(mReady.get()), == 0);
+				mThread.join();
+			}
+
+			// Waits for the previous block to be written, then exchanges Buffer for the spare buffer, and has the background
+			// thread write the first Size bytes of it at Offset.
+			void submit(buffered_file_writer::buffer_type& Buffer, std::uint64_t const Offset, std::size_t const Size)
+			{
+				wait();
+				Buffer.swap(mBuffer);
+				mOffset = Offset;
+				mSize = Size;
+				check_bool(ResetEvent(mIdle.get()));
+				signal_event(mReady.get());
+			}
+
+			// Waits for the previous block to be written, and rethrows the exception thrown by writing it, if any.
+			void wait()
+			{
+				wait_event(mIdle.get());
+				if (mError)
+				{
+					std::rethrow_exception(std::exchange(mError, nullptr));
+				}
+			}
+
+		private:
+			void run() noexcept
+			{
+				for (;;)
+				{
+					WDUL_DEBUG_RAISE_LAST_ERROR_WHEN(WaitForSingleObjectEx(mReady.get(), INFINITE, false), == WAIT_FAILED);
+					if (mStop)
+					{
+						return;
+					}
+					try
+					{
+						write_all_at(mFile, mOffset, mBuffer.data(), mSize);
+					}
+					catch (...)
+					{
+						mError = std::current_exception();
+					}
+					WDUL_DEBUG_RAISE_LAST_ERROR_WHEN(SetEvent(mIdle.get()), == 0);
+				}
+			}
+
+			HANDLE mFile;
+
+			// The buffer written by the background thread.
+			buffered_file_writer::buffer_type mBuffer;
+			std::uint64_t mOffset;
+			std::size_t mSize;
+			bool mStop;
+
+			// The exception thrown by the last write, if any.
+			std::exception_ptr mError;
+
+			// Signaled when a block has been submitted, or the thread should stop.
+			event_handle mReady;
+
+			// Signaled while no block is being written.
+			event_handle mIdle;
+
+			// Constructed last, since the thread accesses the other members.
+			std::thread mThread;
+		};
+	}
+
+	buffered_file_writer::buffered_file_writer() noexcept :
+		mSize(0),
+		mLimit(0),
+		mBlockPos(0)
+	{
+	}
+
+	buffered_file_writer::buffered_file_writer(file_handle File, std::size_t const BufferSize, bool const WriteBehind) :
+		buffered_file_writer()
+	{
+		auto const position = fgetpos(File.get());
+		mFile = std::move(File);
+		start(static_cast<std::uint64_t>(position), BufferSize, WriteBehind);
+	}
+
+	buffered_file_writer::buffered_file_writer(buffered_file_writer&& Other) noexcept :
+		mFile(std::move(Other.mFile)),
+		mBuffer(std::move(Other.mBuffer)),
+		mSize(std::exchange(Other.mSize, 0)),
+		mLimit(std::exchange(Other.mLimit, 0)),
+		mBlockPos(std::exchange(Other.mBlockPos, 0)),
+		mWriteBehind(std::move(Other.mWriteBehind))
+	{
+	}
+
+	buffered_file_writer& buffered_file_writer::operator=(buffered_file_writer&& Other) noexcept
+	{
+		buffered_file_writer(std::move(Other)).swap(*this);
+		return *this;
+	}
+
+	buffered_file_writer::~buffered_file_writer()
+	{
+		if (is_open())
+		{
+			try
+			{
+				close();
+			}
+			catch (...)
+			{
+			}
+		}
+	}
+
+	[[nodiscard]] fopen_code buffered_file_writer::open(_In_z_ wchar_t const* const Filename, file_open_mode const Mode,
+		std::size_t const BufferSize, bool const WriteBehind)
+	{
+		close();
+		file_handle f;
+		auto const code = fopen(f.put(), Filename, Mode, FILE_ATTRIBUTE_NORMAL, generic_access::write, file_share_mode::read);
+		if (code != fopen_code::success)
+		{
+			return code;
+		}
+		auto const size = fgetsize(f.get());
+		mFile = std::move(f);
+		start(static_cast<std::uint64_t>(size), BufferSize, WriteBehind);
+		return fopen_code::success;
+	}
+
+	void buffered_file_writer::start(std::uint64_t const Position, std::size_t const BufferSize, bool const WriteBehind)
+	{
+		WDUL_ASSERT(BufferSize != 0);
+		auto const bufferSize = impl::round_up_size(BufferSize, buffer_alignment);
+		if (mBuffer.size() != bufferSize)
+		{
+			mBuffer = buffer_type(bufferSize);
+		}
+		mSize = 0;
+		mBlockPos = Position;
+		mLimit = bufferSize - static_cast<std::size_t>(Position % bufferSize);
+		if (WriteBehind)
+		{
+			mWriteBehind = std::make_unique<impl::write_behind>(mFile.get(), bufferSize);
+		}
+	}
+
+	void buffered_file_writer::close()
+	{
+		if (!is_open())
+		{
+			return;
+		}
+
+		// The file is closed even if the buffered bytes cannot be written.
+		auto closer = finally_always([this]() noexcept
+			{
+				mWriteBehind.reset();
+				WDUL_DEBUG_RAISE_LAST_ERROR_WHEN(mFile.try_close(), == false);
+				mSize = 0;
+				mLimit = 0;
+				mBlockPos = 0;
+			});
+		flush();
+	}
+
+	void buffered_file_writer::write(_In_reads_bytes_(Size) void const* const Data, std::size_t const Size)
+	{
+		WDUL_ASSERT(is_open());
+		auto in = static_cast<std::uint8_t const*>(Data);
+		auto remaining = Size;
+		while (remaining != 0)
+		{
+			if (mSize == 0 && mLimit == mBuffer.size() && remaining >= mLimit)
+			{
+				// Whole blocks bypass the buffer. The block written in the background, if any, doesn't overlap them.
+				auto const direct = remaining - remaining % mBuffer.size();
+				impl::write_all_at(mFile.get(), mBlockPos, in, direct);
+				mBlockPos += direct;
+				in += direct;
+				remaining -= direct;
+				continue;
+			}
+			auto const count = (std::min)(remaining, mLimit - mSize);
+			std::memcpy(mBuffer.data() + mSize, in, count);
+			mSize += count;
+			in += count;
+			remaining -= count;
+			if (mSize == mLimit)
+			{
+				write_block();
+			}
+		}
+	}
+
+	void buffered_file_writer::flush()
+	{
+		WDUL_ASSERT(is_open());
+		if (mSize != 0)
+		{
+			write_block();
+		}
+		if (mWriteBehind)
+		{
+			mWriteBehind->wait();
+		}
+	}
+
+	void buffered_file_writer::sync()
+	{
+		flush();
+		fsync(mFile.get());
+	}
+
+	void buffered_file_writer::write_block()
+	{
+		if (mWriteBehind)
+		{
+			mWriteBehind->submit(mBuffer, mBlockPos, mSize);
+		}
+		else
+		{
+			impl::write_all_at(mFile.get(), mBlockPos, mBuffer.data(), mSize);
+		}
+		mBlockPos += mSize;
+		mSize = 0;
+
+		// A partial block, written by flush, is followed by a block which ends at the next multiple of the buffer size.
+		mLimit = mBuffer.size() - static_cast<std::size_t>(mBlockPos % mBuffer.size());
+	}
+}
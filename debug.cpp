@@ -2,6 +2,7 @@
 // View this project on github: https://github.com/WillDaisey/wdul/
 
 #include "include/wdul/debug.hpp"
+#include <memory_resource>
 #include <string>
 #include <unordered_map>
 #include <stdexcept>
@@ -193,7 +194,12 @@ namespace wdul::debug
 	public:
 		void receive(message_output const& Msg) override
 		{
-			std::string str(Msg.facility_name, Msg.facility_name_length);
+			// Most messages fit in the stack buffer; longer messages fall back to the default memory resource.
+			char buffer[512];
+			std::pmr::monotonic_buffer_resource resource(buffer, sizeof(buffer), std::pmr::get_default_resource());
+			std::pmr::string str(&resource);
+			str.reserve(sizeof(buffer) - 1);
+			str.append(Msg.facility_name, Msg.facility_name_length);
 			str += " ";
 			switch (Msg.desc.severity)
 			{
@@ -243,6 +249,7 @@ namespace wdul::debug
 			this->set_category_name(mWdulFacility, categories::strings, "strings");
 			this->set_category_name(mWdulFacility, categories::window, "window");
 			this->set_category_name(mWdulFacility, categories::mf, "mf");
+			this->set_category_name(mWdulFacility, categories::memory, "memory");
 		}
 
 		[[nodiscard]] facility register_facility(
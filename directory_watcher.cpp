@@ -0,0 +1,286 @@
+// This file is part of the WillDaisey/WDUL (Windows Desktop Utility Library) project.
+// View this project on github: https://github.com/WillDaisey/wdul/
+
+#include "include/wdul/directory_watcher.hpp"
+#include "include/wdul/error.hpp"
+#include "include/wdul/virtual_memory.hpp"
+#include <algorithm>
+#include <utility>
+
+namespace wdul
+{
+	[[nodiscard]] fopen_code directory_watcher::open(_In_z_ wchar_t const* const Directory, directory_watch_options const& Options)
+	{
+		if (is_open())
+		{
+			throw hresult_invalid_state();
+		}
+
+		// Sharing delete access allows files in the tree, and the directory itself, to be renamed and deleted while it is watched.
+		file_handle directory(CreateFileW(Directory, FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+			nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr));
+		if (!directory)
+		{
+			auto const lastError = GetLastError();
+			switch (lastError)
+			{
+			case ERROR_FILE_NOT_FOUND:
+			case ERROR_PATH_NOT_FOUND:
+				return fopen_code::not_found;
+
+			case ERROR_ACCESS_DENIED:
+				return fopen_code::access_denied;
+
+			default:
+				throw_win32(lastError);
+			}
+		}
+
+		auto event = create_event(event_access_mask(standard_access::synchronize, event_access::modify_state),
+			event_create_flags::manual_reset);
+
+		// The notifications are DWORD-aligned, so the buffer size must be a multiple of a DWORD.
+		byte_array buffer(impl::round_up_size(Options.buffer_size, sizeof(DWORD)));
+		std::wstring directoryPath(Directory);
+
+		mDirectory = std::move(directory);
+		mEvent = std::move(event);
+		mBuffer = std::move(buffer);
+		mDirectoryPath = std::move(directoryPath);
+		mOptions = Options;
+		mPending.clear();
+		mRescan = false;
+
+		auto closer = finally([&]() { close(); });
+		issue();
+		closer.revoke();
+		return fopen_code::success;
+	}
+
+	void directory_watcher::close() noexcept
+	{
+		if (!is_open())
+		{
+			return;
+		}
+
+		// The system writes to the buffer and the OVERLAPPED structure until the read completes, so it must be cancelled and
+		// waited for before they are freed.
+		if (mOverlapped.hEvent)
+		{
+			DWORD bytes;
+			if (CancelIoEx(mDirectory.get(), &mOverlapped) || GetLastError() != ERROR_NOT_FOUND)
+			{
+				GetOverlappedResult(mDirectory.get(), &mOverlapped, &bytes, TRUE);
+			}
+			mOverlapped = {};
+		}
+
+		WDUL_DEBUG_RAISE_LAST_ERROR_WHEN(mDirectory.try_close(), == false);
+		WDUL_DEBUG_RAISE_LAST_ERROR_WHEN(mEvent.try_close(), == false);
+		mBuffer = byte_array();
+		mPending.clear();
+		mRescan = false;
+	}
+
+	std::size_t directory_watcher::wait(std::vector<file_change>& Changes, std::uint32_t const Milliseconds)
+	{
+		if (!is_open())
+		{
+			throw hresult_invalid_state();
+		}
+
+		Changes.clear();
+		auto const start = GetTickCount64();
+		while (true)
+		{
+			collect();
+
+			auto const now = GetTickCount64();
+			auto waitMilliseconds = timeout();
+			if (waitMilliseconds == 0)
+			{
+				break;
+			}
+
+			if (Milliseconds != INFINITE)
+			{
+				auto const elapsed = now - start;
+				if (elapsed >= Milliseconds)
+				{
+					return 0;
+				}
+				waitMilliseconds = (std::min)(waitMilliseconds, static_cast<std::uint32_t>(Milliseconds - elapsed));
+			}
+
+			wait_event(mEvent.get(), waitMilliseconds);
+		}
+
+		if (mRescan)
+		{
+			// Every file may have changed, so the individual changes are redundant.
+			Changes.push_back({ std::wstring(), file_change_action::rescan });
+		}
+		else
+		{
+			Changes.reserve(mPending.size());
+			while (!mPending.empty())
+			{
+				auto node = mPending.extract(mPending.begin());
+				Changes.push_back({ std::move(node.key()), node.mapped() });
+			}
+		}
+		mPending.clear();
+		mRescan = false;
+		return Changes.size();
+	}
+
+	[[nodiscard]] std::uint32_t directory_watcher::timeout() const noexcept
+	{
+		if (mPending.empty() && !mRescan)
+		{
+			return INFINITE;
+		}
+		auto const due = (std::min)(mLastChange + mOptions.debounce_milliseconds, mFirstChange + mOptions.max_delay_milliseconds);
+		auto const now = GetTickCount64();
+		return due <= now ? 0 : static_cast<std::uint32_t>((std::min<std::uint64_t>)(due - now, INFINITE - 1));
+	}
+
+	[[nodiscard]] std::wstring directory_watcher::path_of(file_change const& Change) const
+	{
+		std::wstring path;
+		path.reserve(mDirectoryPath.size() + 1 + Change.path.size());
+		path = mDirectoryPath;
+		if (!path.empty() && path.back() != L'\\' && path.back() != L'/')
+		{
+			path += L'\\';
+		}
+		path += Change.path;
+		return path;
+	}
+
+	void directory_watcher::issue()
+	{
+		mOverlapped = {};
+		mOverlapped.hEvent = mEvent.get();
+		check_bool(ResetEvent(mEvent.get()));
+		if (!ReadDirectoryChangesW(mDirectory.get(), mBuffer.data(), static_cast<DWORD>(mBuffer.size()), mOptions.subtree,
+			mOptions.filter, nullptr, &mOverlapped, nullptr))
+		{
+			mOverlapped = {};
+			throw_last_error();
+		}
+	}
+
+	void directory_watcher::collect()
+	{
+		if (!mOverlapped.hEvent)
+		{
+			// A previous call failed to begin another read.
+			issue();
+			return;
+		}
+
+		DWORD bytes;
+		if (!GetOverlappedResult(mDirectory.get(), &mOverlapped, &bytes, FALSE))
+		{
+			auto const lastError = GetLastError();
+			if (lastError == ERROR_IO_INCOMPLETE)
+			{
+				return;
+			}
+			mOverlapped = {};
+			if (lastError != ERROR_NOTIFY_ENUM_DIR)
+			{
+				// For example, ERROR_ACCESS_DENIED if the watched directory was deleted.
+				throw_win32(lastError);
+			}
+			bytes = 0;
+		}
+
+		auto const now = GetTickCount64();
+		if (mPending.empty() && !mRescan)
+		{
+			mFirstChange = now;
+		}
+		mLastChange = now;
+
+		if (bytes == 0)
+		{
+			// The system's buffer overflowed, so the changes since the last read were lost.
+			mRescan = true;
+			mPending.clear();
+		}
+		else if (!mRescan)
+		{
+			auto position = mBuffer.data();
+			while (true)
+			{
+				auto const info = reinterpret_cast<FILE_NOTIFY_INFORMATION const*>(position);
+				std::wstring_view const path(info->FileName, info->FileNameLength / sizeof(wchar_t));
+				switch (info->Action)
+				{
+				case FILE_ACTION_ADDED:
+				case FILE_ACTION_RENAMED_NEW_NAME:
+					record(path, file_change_action::added);
+					break;
+
+				case FILE_ACTION_REMOVED:
+				case FILE_ACTION_RENAMED_OLD_NAME:
+					record(path, file_change_action::removed);
+					break;
+
+				case FILE_ACTION_MODIFIED:
+					record(path, file_change_action::modified);
+					break;
+				}
+
+				if (info->NextEntryOffset == 0)
+				{
+					break;
+				}
+				position += info->NextEntryOffset;
+			}
+		}
+
+		issue();
+	}
+
+	void directory_watcher::record(std::wstring_view const Path, file_change_action const Action)
+	{
+		auto const [it, inserted] = mPending.try_emplace(std::wstring(Path), Action);
+		if (inserted)
+		{
+			return;
+		}
+
+		auto& pending = it->second;
+		switch (Action)
+		{
+		case file_change_action::added:
+		case file_change_action::modified:
+			// A file which was removed and then added again is reported as modified, since its contents may differ. A file which
+			// was added and then modified is still reported as added.
+			if (pending == file_change_action::removed)
+			{
+				pending = file_change_action::modified;
+			}
+			break;
+
+		case file_change_action::removed:
+			// A file which was added and then removed within the same batch never existed as far as the consumer knows.
+			if (pending == file_change_action::added)
+			{
+				mPending.erase(it);
+			}
+			else
+			{
+				pending = file_change_action::removed;
+			}
+			break;
+
+		default:
+			WDUL_ASSERT(false);
+		}
+	}
+}
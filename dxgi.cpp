@@ -5,14 +5,15 @@
 
 namespace wdul
 {
-	[[nodiscard]] std::vector<com_ptr<IDXGIAdapter4>> dxgi_list_adapters(
+	template <class VectorT>
+	void dxgi_list_adapters_x(
+		VectorT& AdapterArray,
 		_In_ IDXGIFactory6* const DxgiFactory,
 		DXGI_GPU_PREFERENCE const GpuPreference,
 		bool const NoSoftwareAdapter
 	)
 	{
-		std::vector<com_ptr<IDXGIAdapter4>> adapterArray;
-		adapterArray.reserve(3);
+		AdapterArray.reserve(3);
 		HRESULT hr;
 		for (std::uint32_t adapterIndex = 0; true; ++adapterIndex)
 		{
@@ -22,7 +23,7 @@ namespace wdul
 			{
 				if (hr == DXGI_ERROR_NOT_FOUND)
 				{
-					return adapterArray;
+					return;
 				}
 				throw_hresult(hr);
 			}
@@ -37,10 +38,33 @@ namespace wdul
 				}
 			}
 
-			adapterArray.push_back(std::move(adapter));
+			AdapterArray.push_back(std::move(adapter));
 		}
 	}
 
+	[[nodiscard]] std::vector<com_ptr<IDXGIAdapter4>> dxgi_list_adapters(
+		_In_ IDXGIFactory6* const DxgiFactory,
+		DXGI_GPU_PREFERENCE const GpuPreference,
+		bool const NoSoftwareAdapter
+	)
+	{
+		std::vector<com_ptr<IDXGIAdapter4>> adapterArray;
+		dxgi_list_adapters_x(adapterArray, DxgiFactory, GpuPreference, NoSoftwareAdapter);
+		return adapterArray;
+	}
+
+	[[nodiscard]] std::pmr::vector<com_ptr<IDXGIAdapter4>> dxgi_list_adapters(
+		_In_ std::pmr::memory_resource* const Resource,
+		_In_ IDXGIFactory6* const DxgiFactory,
+		DXGI_GPU_PREFERENCE const GpuPreference,
+		bool const NoSoftwareAdapter
+	)
+	{
+		std::pmr::vector<com_ptr<IDXGIAdapter4>> adapterArray(Resource);
+		dxgi_list_adapters_x(adapterArray, DxgiFactory, GpuPreference, NoSoftwareAdapter);
+		return adapterArray;
+	}
+
 	dxgi_fullscreen_transition_result dxgi_set_fullscreen_state(_In_ IDXGISwapChain* const SwapChain, bool const Enable, _In_opt_ IDXGIOutput* const Target)
 	{
 		auto const hr = SwapChain->SetFullscreenState(Enable, Target);
@@ -0,0 +1,175 @@
+// This file is part of the WillDaisey/WDUL (Windows Desktop Utility Library) project.
+// View this project on github: https://github.com/WillDaisey/wdul/
+
+#include "include/wdul/file_prefetcher.hpp"
+#include "include/wdul/async_io.hpp"
+#include "include/wdul/error.hpp"
+#include "include/wdul/virtual_memory.hpp"
+#include <algorithm>
+#include <deque>
+#include <utility>
+
+namespace wdul
+{
+	namespace impl
+	{
+		// A file being read by a file_prefetcher.
+		struct prefetch_file
+		{
+			file_handle handle;
+
+			// The number of reads of the file which have been submitted, but whose completion has not been dequeued, plus one
+			// while reads of the file are still being submitted. The file is closed once this reaches zero.
+			std::uint32_t pending;
+		};
+	}
+
+	void file_prefetcher::start(std::vector<file_access_entry> Profile, file_prefetch_options const& Options)
+	{
+		if (is_active())
+		{
+			throw hresult_invalid_state();
+		}
+
+		mProfile = std::move(Profile);
+		mOptions = Options;
+		mStats = {};
+		mError = nullptr;
+		mCancel.store(false, std::memory_order_relaxed);
+		mThread = std::thread([this]() { run(); });
+	}
+
+	void file_prefetcher::wait(_Out_opt_ file_prefetch_stats* const Stats)
+	{
+		if (!is_active())
+		{
+			throw hresult_invalid_state();
+		}
+
+		mThread.join();
+		mProfile = {};
+		if (mError)
+		{
+			std::rethrow_exception(std::exchange(mError, nullptr));
+		}
+		if (Stats)
+		{
+			*Stats = mStats;
+		}
+	}
+
+	void file_prefetcher::cancel() noexcept
+	{
+		if (!is_active())
+		{
+			return;
+		}
+
+		mCancel.store(true, std::memory_order_relaxed);
+		mThread.join();
+		mProfile = {};
+		mError = nullptr;
+	}
+
+	void file_prefetcher::run() noexcept
+	{
+		try
+		{
+			auto const chunkSize = impl::round_up_size((std::max)(mOptions.chunk_size, std::uint32_t(1)), file_access_granularity);
+			auto const queueDepth = static_cast<std::size_t>((std::max)(mOptions.queue_depth, std::uint32_t(1)));
+
+			// The files must stay open, and the buffers allocated, until the engine has waited for the reads in flight, so they
+			// are declared first, and destroyed last.
+			std::deque<impl::prefetch_file> files;
+			byte_array buffers(chunkSize * queueDepth);
+			std::vector<std::uint8_t*> freeBuffers;
+			freeBuffers.reserve(queueDepth);
+			for (std::size_t i = 0; i != queueDepth; ++i)
+			{
+				freeBuffers.push_back(buffers.data() + i * chunkSize);
+			}
+			async_io_engine engine(1);
+
+			// Dequeues at least one completion, returning the buffer of each to the free list, and closing each file which has no
+			// more reads in flight.
+			auto const complete = [&]()
+			{
+				async_io_completion completions[64];
+				auto const count = engine.wait(completions);
+				for (std::size_t i = 0; i != count; ++i)
+				{
+					auto const& completion = completions[i];
+					freeBuffers.push_back(static_cast<std::uint8_t*>(completion.request.buffer));
+					mStats.bytes += completion.bytes_transferred;
+					auto& file = *static_cast<impl::prefetch_file*>(completion.request.context);
+					if (--file.pending == 0)
+					{
+						file.handle.close();
+					}
+				}
+			};
+
+			for (auto const& entry : mProfile)
+			{
+				if (mCancel.load(std::memory_order_relaxed))
+				{
+					break;
+				}
+
+				file_handle handle(CreateFileW(entry.path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+					nullptr, OPEN_EXISTING, FILE_FLAG_OVERLAPPED, nullptr));
+				LARGE_INTEGER size;
+				if (!handle || !GetFileSizeEx(handle.get(), &size))
+				{
+					++mStats.skipped;
+					continue;
+				}
+				engine.attach(handle.get());
+				auto& file = files.emplace_back(impl::prefetch_file{ std::move(handle), 1 });
+				++mStats.files;
+
+				auto const fileSize = static_cast<std::uint64_t>(size.QuadPart);
+				file_range const whole{ 0, (std::min)(fileSize, mOptions.max_whole_file_size) };
+				auto const ranges = entry.ranges.empty() ? std::span<file_range const>(&whole, 1) : std::span<file_range const>(entry.ranges);
+				for (auto const& range : ranges)
+				{
+					auto offset = range.offset;
+					auto const end = (std::min)(range.offset + range.size, fileSize);
+					while (offset < end && !mCancel.load(std::memory_order_relaxed))
+					{
+						while (freeBuffers.empty())
+						{
+							complete();
+						}
+
+						async_io_request request;
+						request.file = file.handle.get();
+						request.operation = async_io_operation::read;
+						request.offset = offset;
+						request.buffer = freeBuffers.back();
+						request.size = static_cast<std::uint32_t>((std::min<std::uint64_t>)(end - offset, chunkSize));
+						request.context = &file;
+						engine.submit(request);
+						freeBuffers.pop_back();
+						++file.pending;
+						offset += request.size;
+					}
+				}
+
+				if (--file.pending == 0)
+				{
+					file.handle.close();
+				}
+			}
+
+			while (engine.in_flight() != 0)
+			{
+				complete();
+			}
+		}
+		catch (...)
+		{
+			mError = std::current_exception();
+		}
+	}
+}
@@ -3,6 +3,16 @@
 
 #include "include/wdul/fs.hpp"
 #include "include/wdul/parse.hpp"
+#include "include/wdul/thread.hpp"
+#include "include/wdul/time.hpp"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 namespace wdul
 {
@@ -38,6 +48,323 @@ namespace wdul
 		}
 	}
 
+	namespace impl
+	{
+		// Identifies a file independently of its path and of the handles open to it.
+		struct file_identity
+		{
+			std::uint32_t volume;
+			std::uint64_t index;
+
+			[[nodiscard]] bool operator==(file_identity const&) const noexcept = default;
+		};
+
+		struct file_identity_hash
+		{
+			[[nodiscard]] std::size_t operator()(file_identity const& Id) const noexcept
+			{
+				return std::hash<std::uint64_t>()(Id.index ^ (static_cast<std::uint64_t>(Id.volume) << 32));
+			}
+		};
+
+		// Retrieves the identity of the file the specified handle refers to. Returns false on failure.
+		[[nodiscard]] bool get_file_identity(_In_ HANDLE const File, file_identity& Id) noexcept
+		{
+			BY_HANDLE_FILE_INFORMATION info;
+			if (!GetFileInformationByHandle(File, &info))
+			{
+				return false;
+			}
+			Id.volume = info.dwVolumeSerialNumber;
+			Id.index = (static_cast<std::uint64_t>(info.nFileIndexHigh) << 32) | info.nFileIndexLow;
+			return true;
+		}
+
+		// The reads which a thread has made through the handle it last read from, and which have not yet been added to the
+		// recorder, so that a thread reading a file sequentially neither queries the identity of the file nor locks the recorder's
+		// mutex for each read.
+		struct file_read_cache
+		{
+			~file_read_cache();
+
+			// Locked by the thread which owns the cache, and by stop_file_access_recording, which flushes the cache of every
+			// thread. If both this and the recorder's mutex are locked, the recorder's mutex is locked first.
+			std::mutex mutex;
+
+			// The handle last read from, or null if the cache is empty. Only handles to recorded files are cached, so that a
+			// handle to a file which is not recorded, whose value is then reused for a handle to a recorded file, cannot cause the
+			// reads of the recorded file to be ignored.
+			HANDLE handle = nullptr;
+
+			// The value of file_access_generation when the identity of the file handle refers to was queried.
+			std::uint64_t generation = 0;
+
+			// The index of the file handle refers to in the recorder's entries.
+			std::size_t index = 0;
+
+			// The range read through handle since the reads were last added to the recorder, or an empty range if none.
+			file_range pending{};
+
+			// Links the caches of every thread which has read a file while recording. Guarded by the recorder's mutex.
+			file_read_cache* previous = nullptr;
+			file_read_cache* next = nullptr;
+			bool linked = false;
+		};
+
+		// The files recorded by start_file_access_recording.
+		struct file_access_recorder
+		{
+			std::mutex mutex;
+
+			// The files recorded, in the order they were first opened.
+			std::vector<file_access_entry> entries;
+
+			// Maps the full path of each file recorded to its index in entries.
+			std::unordered_map<std::wstring, std::size_t> indices;
+
+			// Maps the identity of each file recorded to its index in entries. Reads are attributed by the identity of the file
+			// the handle refers to, rather than by the handle, since the system reuses the values of closed handles, and files are
+			// also read through handles which were not opened by fopen.
+			std::unordered_map<file_identity, std::size_t, file_identity_hash> ids;
+
+			// The first of the caches of the threads which have read a file while recording.
+			file_read_cache* caches = nullptr;
+		};
+
+		// Set while file accesses are recorded. Checked before the recorder's mutex is locked, so that fopen and fread_at cost no
+		// more than an atomic load while file accesses are not recorded.
+		constinit std::atomic<bool> recording_file_accesses = false;
+
+		// Incremented whenever fopen opens a file while recording, and whenever recording starts or stops. A thread's cached
+		// handle is only trusted while this is unchanged, since the system may reuse the value of a closed handle for the next
+		// file opened.
+		constinit std::atomic<std::uint64_t> file_access_generation = 0;
+
+		[[nodiscard]] file_access_recorder& get_file_access_recorder()
+		{
+			static file_access_recorder recorder;
+			return recorder;
+		}
+
+		// Extends Range to cover the bytes from First to Last, and returns true, if they overlap or are adjacent to Range, or if
+		// Range is empty. Otherwise returns false, leaving Range unchanged.
+		[[nodiscard]] bool extend_file_range(file_range& Range, std::uint64_t const First, std::uint64_t const Last) noexcept
+		{
+			if (Range.size == 0)
+			{
+				Range = { First, Last - First };
+				return true;
+			}
+			if (First > Range.offset + Range.size || Last < Range.offset)
+			{
+				return false;
+			}
+			auto const end = (std::max)(Range.offset + Range.size, Last);
+			Range.offset = (std::min)(Range.offset, First);
+			Range.size = end - Range.offset;
+			return true;
+		}
+
+		// Adds the reads held by Cache to the recorder, and empties the cache's range. Both the recorder's mutex and the cache's
+		// mutex must be locked.
+		void flush_file_read_cache(file_access_recorder& Recorder, file_read_cache& Cache) noexcept
+		{
+			if (Cache.handle && Cache.pending.size != 0)
+			{
+				// Sequential reads extend the last range, so a file read from start to end is recorded as one range.
+				auto& ranges = Recorder.entries[Cache.index].ranges;
+				if (ranges.empty() ||
+					!extend_file_range(ranges.back(), Cache.pending.offset, Cache.pending.offset + Cache.pending.size))
+				{
+					try
+					{
+						ranges.push_back(Cache.pending);
+					}
+					catch (...)
+					{
+					}
+				}
+			}
+			Cache.pending = {};
+		}
+
+		file_read_cache::~file_read_cache()
+		{
+			if (!linked)
+			{
+				return;
+			}
+			auto& recorder = get_file_access_recorder();
+			std::lock_guard lock(recorder.mutex);
+			std::lock_guard cacheLock(mutex);
+			if (recording_file_accesses.load(std::memory_order_relaxed))
+			{
+				flush_file_read_cache(recorder, *this);
+			}
+			(previous ? previous->next : recorder.caches) = next;
+			if (next)
+			{
+				next->previous = previous;
+			}
+		}
+
+		void record_file_open(_In_ HANDLE const File, _In_z_ wchar_t const* const Filename, file_open_mode const CreationDisposition,
+			std::uint32_t const FlagsAndAttributes, file_access_mask const Access) noexcept
+		{
+			if (!recording_file_accesses.load(std::memory_order_relaxed))
+			{
+				return;
+			}
+			file_access_generation.fetch_add(1, std::memory_order_relaxed);
+
+			// Only existing files read through the system file cache benefit from being prefetched.
+			if ((Access.underlying() & (GENERIC_READ | GENERIC_ALL | to_underlying(file_access::read_data))) == 0 ||
+				CreationDisposition != file_open_mode::open_existing ||
+				(FlagsAndAttributes & (FILE_FLAG_NO_BUFFERING | FILE_FLAG_BACKUP_SEMANTICS)) != 0)
+			{
+				return;
+			}
+
+			// Recording is best effort, so a failure to record the file must not fail the open.
+			try
+			{
+				std::wstring path(MAX_PATH, L'\0');
+				for (;;)
+				{
+					auto const length = GetFullPathNameW(Filename, static_cast<DWORD>(path.size()), path.data(), nullptr);
+					if (length == 0)
+					{
+						return;
+					}
+					if (length < path.size())
+					{
+						// The path fit, and length excludes the null terminator.
+						path.resize(length);
+						break;
+					}
+					// The path did not fit, and length includes the null terminator.
+					path.resize(length);
+				}
+
+				file_identity id;
+				if (!get_file_identity(File, id))
+				{
+					return;
+				}
+
+				auto& recorder = get_file_access_recorder();
+				std::lock_guard lock(recorder.mutex);
+				if (!recording_file_accesses.load(std::memory_order_relaxed))
+				{
+					return;
+				}
+				auto const [it, inserted] = recorder.indices.try_emplace(path, recorder.entries.size());
+				if (inserted)
+				{
+					auto rollback = finally([&]() { recorder.indices.erase(it); });
+					recorder.entries.push_back({ std::move(path), {} });
+					rollback.revoke();
+				}
+
+				// A file opened through another path, such as a hard link, is recorded under the path it was last opened through.
+				recorder.ids.insert_or_assign(id, it->second);
+			}
+			catch (...)
+			{
+			}
+		}
+
+		void record_file_read(_In_ HANDLE const File, std::uint64_t const Offset, std::uint32_t const Size) noexcept
+		{
+			if (!recording_file_accesses.load(std::memory_order_relaxed) || Size == 0)
+			{
+				return;
+			}
+
+			auto const first = Offset - Offset % file_access_granularity;
+			auto const last = impl::round_up_size(Offset + Size, file_access_granularity);
+			thread_local file_read_cache cache;
+			auto const generation = file_access_generation.load(std::memory_order_relaxed);
+			bool cached;
+			{
+				std::lock_guard cacheLock(cache.mutex);
+				cached = cache.handle == File && cache.generation == generation;
+				if (cached && extend_file_range(cache.pending, first, last))
+				{
+					return;
+				}
+			}
+
+			// Either the handle differs from the one last read from, or a file has been opened since, so that the handle may now
+			// refer to another file, or the read does not continue the range held by the cache.
+			file_identity id;
+			if (!cached && !get_file_identity(File, id))
+			{
+				return;
+			}
+
+			auto& recorder = get_file_access_recorder();
+			std::lock_guard lock(recorder.mutex);
+			if (!recording_file_accesses.load(std::memory_order_relaxed))
+			{
+				return;
+			}
+			std::lock_guard cacheLock(cache.mutex);
+			if (cached && (cache.handle != File || cache.generation != generation))
+			{
+				// Recording was stopped, and has been started again, since the cache was checked.
+				return;
+			}
+			if (!cache.linked)
+			{
+				cache.next = recorder.caches;
+				if (cache.next)
+				{
+					cache.next->previous = &cache;
+				}
+				recorder.caches = &cache;
+				cache.linked = true;
+			}
+
+			flush_file_read_cache(recorder, cache);
+			if (!cached)
+			{
+				auto const it = recorder.ids.find(id);
+				if (it == recorder.ids.end())
+				{
+					// The file was not opened by fopen while recording, or was opened for writing.
+					cache.handle = nullptr;
+					return;
+				}
+				cache.handle = File;
+				cache.generation = generation;
+				cache.index = it->second;
+			}
+			cache.pending = { first, last - first };
+		}
+
+		// Sorts Ranges by offset, and merges those which overlap or are adjacent.
+		void normalize_file_ranges(std::vector<file_range>& Ranges) noexcept
+		{
+			std::sort(Ranges.begin(), Ranges.end(), [](file_range const& A, file_range const& B) { return A.offset < B.offset; });
+			std::size_t count = 0;
+			for (auto const& range : Ranges)
+			{
+				if (count != 0)
+				{
+					auto& previous = Ranges[count - 1];
+					if (range.offset <= previous.offset + previous.size)
+					{
+						previous.size = (std::max)(previous.offset + previous.size, range.offset + range.size) - previous.offset;
+						continue;
+					}
+				}
+				Ranges[count++] = range;
+			}
+			Ranges.resize(count);
+		}
+	}
+
 	[[nodiscard]] _Success_(return == fopen_code::success) fopen_code fopen(
 		_Outptr_ HANDLE* const FileHandle,
 		_In_z_ wchar_t const* const Filename,
@@ -52,6 +379,7 @@ namespace wdul
 		{
 			return to_fopen_code(GetLastError());
 		}
+		impl::record_file_open(*FileHandle, Filename, CreationDisposition, FlagsAndAttributes, Access);
 		return fopen_code::success;
 	}
 
@@ -63,7 +391,9 @@ namespace wdul
 		file_share_mode const ShareMode
 	)
 	{
-		return check_handle<file_handle::traits>(CreateFileW(Filename, Access.underlying(), to_underlying(ShareMode), nullptr, to_underlying(CreationDisposition), FlagsAndAttributes, nullptr));
+		auto file = check_handle<file_handle::traits>(CreateFileW(Filename, Access.underlying(), to_underlying(ShareMode), nullptr, to_underlying(CreationDisposition), FlagsAndAttributes, nullptr));
+		impl::record_file_open(file.get(), Filename, CreationDisposition, FlagsAndAttributes, Access);
+		return file;
 	}
 
 	// TODO: Consider putting this structure in public header.
@@ -79,14 +409,14 @@ namespace wdul
 		inclusive,
 	};
 
-	template <fread_delimit_mode Mode>
+	template <fread_delimit_mode Mode, class StringT = std::u8string>
 	std::int64_t fread_delimitx(
 		_In_ HANDLE const FileHandle,
 		_In_range_(> , 0) std::uint32_t const DelimSize,
 		_In_reads_(DelimSize) char8_t const* const Delim,
 		_In_range_(> , 0) std::uint32_t const BufferSize,
 		_In_reads_(BufferSize) std::uint8_t* const Buffer,
-		[[maybe_unused]] std::conditional_t<Mode != fread_delimit_mode::no_write, std::u8string&, unused_parameter> Output
+		[[maybe_unused]] std::conditional_t<Mode != fread_delimit_mode::no_write, StringT&, unused_parameter> Output
 	)
 	{
 		WDUL_ASSERT(DelimSize != 0);
@@ -94,60 +424,42 @@ namespace wdul
 		WDUL_ASSERT(BufferSize > 0);
 		WDUL_ASSERT(Buffer != nullptr);
 
-		auto const startFp = fgetpos(FileHandle);
-
-		std::uint32_t numBytesRead, lastMatchingCharCount = 0;
-		range<char8_t const> matchingChars, readRange;
+		delimiter_matcher matcher({ .first = Delim, .last = Delim + DelimSize });
+		std::int64_t consumed = 0;
 
 		while (true)
 		{
-			numBytesRead = fread(FileHandle, BufferSize, Buffer);
-			readRange.first = reinterpret_cast<char8_t*>(Buffer);
-			readRange.last = readRange.first + numBytesRead;
-
-			matchingChars = find_delimiter(readRange, { .first = Delim + lastMatchingCharCount, .last = Delim + DelimSize });
-			auto const matchingCharCount = static_cast<std::uint32_t>(matchingChars.last - matchingChars.first);
-
-			if constexpr (Mode == fread_delimit_mode::exclusive)
+			auto const numBytesRead = fread(FileHandle, BufferSize, Buffer);
+			if (numBytesRead == 0)
 			{
-				if (matchingCharCount == 0)
-				{
-					Output.append(Delim, Delim + lastMatchingCharCount);
-				}
-				auto last = readRange.last;
-				if (matchingChars.first != matchingChars.last)
-				{
-					last = matchingChars.first;
-				}
-				Output.append(readRange.first, last);
+				// The end of the file was reached. A partial match at the end of the file is not a delimiter.
+				return consumed;
 			}
+			auto const data = reinterpret_cast<char8_t const*>(Buffer);
+			range<char8_t const> const readRange{ .first = data, .last = data + numBytesRead };
 
-			if constexpr (Mode == fread_delimit_mode::inclusive)
-			{
-				Output.append(readRange.first, readRange.last);
-			}
+			auto const matchLast = matcher.feed(readRange);
+			auto const last = matchLast ? matchLast : readRange.last;
+			consumed += last - readRange.first;
 
-			if (matchingCharCount + lastMatchingCharCount == DelimSize)
+			if constexpr (Mode != fread_delimit_mode::no_write)
 			{
-				// Delimiter was found.
-				// Because more than enough characters may have been read from the file, the file pointer may need to move back such that
-				// it is situated after the delimiter.
-				auto const steps = -(readRange.last - matchingChars.last);
-				fwalk(FileHandle, steps);
-				return fgetpos(FileHandle) - startFp;
+				Output.append(readRange.first, last);
 			}
 
-			if (matchingCharCount == 0)
+			if (matchLast)
 			{
-				if (numBytesRead == 0)
+				// Delimiter was found. The delimiter may have begun in a previous read, but every character of it was appended to
+				// the output string by this call, so it can be removed from the end.
+				if constexpr (Mode == fread_delimit_mode::exclusive)
 				{
-					return fgetpos(FileHandle) - startFp;
+					Output.resize(Output.size() - DelimSize);
 				}
-				lastMatchingCharCount = 0;
-			}
-			else
-			{
-				lastMatchingCharCount += matchingCharCount;
+
+				// Because more than enough characters may have been read from the file, the file pointer may need to move back such that
+				// it is situated after the delimiter.
+				fwalk(FileHandle, -(readRange.last - matchLast));
+				return consumed;
 			}
 		}
 	}
@@ -175,50 +487,1032 @@ namespace wdul
 		return fread_delimitx<fread_delimit_mode::exclusive>(FileHandle, DelimSize, Delim, BufferSize, Buffer, Output);
 	}
 
-	[[nodiscard]] byte_array read_bytes(_In_z_ wchar_t const* const Filename)
+	std::int64_t fread_delimited_consecutive(
+		_In_ HANDLE const FileHandle,
+		_In_range_(> , 0) std::uint32_t const DelimSize,
+		_In_reads_(DelimSize) char8_t const* const Delim,
+		std::pmr::u8string& Output,
+		_In_range_(> , 0) std::uint32_t const BufferSize,
+		_In_reads_(BufferSize) std::uint8_t* const Buffer
+	)
 	{
-		auto f = fopen(Filename, file_open_mode::open_existing, FILE_FLAG_SEQUENTIAL_SCAN, generic_access::read, file_share_mode::read);
-		auto const size = file_size_cast<std::uint32_t>(fgetsize(f.get()));
+		return fread_delimitx<fread_delimit_mode::exclusive, std::pmr::u8string>(FileHandle, DelimSize, Delim, BufferSize, Buffer, Output);
+	}
+
+	template <fread_delimit_mode Mode, class StringT = std::u8string>
+	std::int64_t fread_delimitx(
+		_In_ HANDLE const FileHandle,
+		delimiter_set const& Delims,
+		_In_range_(> , 0) std::uint32_t const BufferSize,
+		_In_reads_(BufferSize) std::uint8_t* const Buffer,
+		[[maybe_unused]] std::conditional_t<Mode != fread_delimit_mode::no_write, StringT&, unused_parameter> Output,
+		_Out_opt_ std::size_t* const Found
+	)
+	{
+		WDUL_ASSERT(BufferSize > 0);
+		WDUL_ASSERT(Buffer != nullptr);
 
-		using allocator = byte_array::allocator;
-		auto data = static_cast<std::uint8_t*>(allocator::allocate(size));
+		delimiter_set_matcher matcher(Delims);
+		[[maybe_unused]] std::size_t outputStart = 0;
+		if constexpr (Mode != fread_delimit_mode::no_write)
+		{
+			outputStart = Output.size();
+		}
 
-		auto dataDeleter = finally([&]() { allocator::deallocate_unchecked(data); });
+		delimiter_set_match match;
+		bool found;
+		std::int64_t readCount = 0;
+		while (true)
+		{
+			auto const numBytesRead = fread(FileHandle, BufferSize, Buffer);
+			readCount += numBytesRead;
+			auto const data = reinterpret_cast<char8_t const*>(Buffer);
+			if (numBytesRead == 0)
+			{
+				// The end of the file was reached. A delimiter may have been found which was only waiting to see whether a longer
+				// delimiter followed.
+				found = matcher.finish(match);
+				break;
+			}
 
-		fread(f.get(), size, data);
+			// The matcher may rewind to the end of a match before the characters it has been given. Characters are appended to the
+			// output string as they are read, and the output string is truncated once the match is known.
+			if constexpr (Mode != fread_delimit_mode::no_write)
+			{
+				Output.append(data, data + numBytesRead);
+			}
+			if (matcher.feed({ .first = data, .last = data + numBytesRead }, match))
+			{
+				found = true;
+				break;
+			}
+		}
 
-		f.close();
+		if (!found)
+		{
+			if (Found) *Found = delimiter_set::npos;
+			return readCount;
+		}
 
-		dataDeleter.revoke();
+		if (Found) *Found = match.delimiter;
+		if constexpr (Mode == fread_delimit_mode::exclusive)
+		{
+			Output.resize(outputStart + static_cast<std::size_t>(match.first));
+		}
+		else if constexpr (Mode == fread_delimit_mode::inclusive)
+		{
+			Output.resize(outputStart + static_cast<std::size_t>(match.last));
+		}
 
-		return byte_array(size, data, take_ownership);
+		// Move the file pointer back such that it is situated after the delimiter.
+		auto const consumed = static_cast<std::int64_t>(match.last);
+		if (consumed != readCount)
+		{
+			fwalk(FileHandle, consumed - readCount);
+		}
+		return consumed;
 	}
 
-	[[nodiscard]] fopen_code read_bytes(byte_array& Output, _In_z_ wchar_t const* const Filename)
+	std::int64_t fread_delimited(
+		_In_ HANDLE const FileHandle,
+		delimiter_set const& Delims,
+		_In_range_(> , 0) std::uint32_t const BufferSize,
+		_In_reads_(BufferSize) std::uint8_t* const Buffer,
+		_Out_opt_ std::size_t* const Found
+	)
 	{
-		file_handle f;
-		auto const code = fopen(f.put(), Filename, file_open_mode::open_existing, FILE_FLAG_SEQUENTIAL_SCAN, generic_access::read,
+		return fread_delimitx<fread_delimit_mode::no_write>(FileHandle, Delims, BufferSize, Buffer, {}, Found);
+	}
+
+	std::int64_t fread_delimited_consecutive(
+		_In_ HANDLE const FileHandle,
+		delimiter_set const& Delims,
+		std::u8string& Output,
+		_In_range_(> , 0) std::uint32_t const BufferSize,
+		_In_reads_(BufferSize) std::uint8_t* const Buffer,
+		_Out_opt_ std::size_t* const Found
+	)
+	{
+		return fread_delimitx<fread_delimit_mode::exclusive>(FileHandle, Delims, BufferSize, Buffer, Output, Found);
+	}
+
+	std::int64_t fread_delimited_consecutive(
+		_In_ HANDLE const FileHandle,
+		delimiter_set const& Delims,
+		std::pmr::u8string& Output,
+		_In_range_(> , 0) std::uint32_t const BufferSize,
+		_In_reads_(BufferSize) std::uint8_t* const Buffer,
+		_Out_opt_ std::size_t* const Found
+	)
+	{
+		return fread_delimitx<fread_delimit_mode::exclusive, std::pmr::u8string>(FileHandle, Delims, BufferSize, Buffer, Output, Found);
+	}
+
+	[[nodiscard]] std::uint32_t impl::read_bytes_size(_In_ HANDLE const FileHandle)
+	{
+		return file_size_cast<std::uint32_t>(fgetsize(FileHandle));
+	}
+
+	[[nodiscard]] _Success_(return == fopen_code::success) fopen_code impl::read_bytes_open(file_handle& File, _In_z_ wchar_t const* const Filename)
+	{
+		return fopen(File.reput(), Filename, file_open_mode::open_existing, FILE_FLAG_SEQUENTIAL_SCAN, generic_access::read,
 			file_share_mode::read);
+	}
+
+	[[nodiscard]] byte_array read_bytes(_In_z_ wchar_t const* const Filename)
+	{
+		return read_bytes<malloc_traits>(Filename);
+	}
+
+	[[nodiscard]] fopen_code read_bytes(byte_array& Output, _In_z_ wchar_t const* const Filename)
+	{
+		return read_bytes<malloc_traits, 0>(Output, Filename);
+	}
 
+	[[nodiscard]] fopen_code read_bytes(virtual_buffer& Output, _In_z_ wchar_t const* const Filename)
+	{
+		read_bytes_options options;
+		options.chunk_size = std::size_t(1) << 30;
+		return read_bytes(Output, Filename, options);
+	}
+
+	namespace impl
+	{
+		[[nodiscard]] OVERLAPPED make_overlapped(std::uint64_t const Offset, HANDLE const Event) noexcept
+		{
+			OVERLAPPED overlapped{};
+			overlapped.Offset = static_cast<DWORD>(Offset);
+			overlapped.OffsetHigh = static_cast<DWORD>(Offset >> 32);
+			overlapped.hEvent = Event;
+			return overlapped;
+		}
+
+		// Waits for a read issued with the given OVERLAPPED structure to complete, where Issued is the value returned by the
+		// function which issued it. Returns the number of bytes read, which is zero if the read began at the end of the file.
+		[[nodiscard]] std::uint32_t complete_read(_In_ HANDLE const FileHandle, OVERLAPPED& Overlapped, BOOL const Issued)
+		{
+			if (!Issued)
+			{
+				auto const error = GetLastError();
+				if (error == ERROR_HANDLE_EOF)
+				{
+					return 0;
+				}
+				if (error != ERROR_IO_PENDING)
+				{
+					throw_win32(error);
+				}
+			}
+
+			// If the file was opened without FILE_FLAG_OVERLAPPED, the read has already completed, and this does not wait.
+			DWORD bytesRead;
+			if (!GetOverlappedResult(FileHandle, &Overlapped, &bytesRead, true))
+			{
+				if (GetLastError() == ERROR_HANDLE_EOF)
+				{
+					return 0;
+				}
+				throw_last_error();
+			}
+			return bytesRead;
+		}
+
+		// Same as complete_read, except for a write.
+		[[nodiscard]] std::uint32_t complete_write(_In_ HANDLE const FileHandle, OVERLAPPED& Overlapped, BOOL const Issued)
+		{
+			if (!Issued && GetLastError() != ERROR_IO_PENDING)
+			{
+				throw_last_error();
+			}
+			DWORD bytesWritten;
+			check_bool(GetOverlappedResult(FileHandle, &Overlapped, &bytesWritten, true));
+			return bytesWritten;
+		}
+
+		// The size of the buffer through which freadv_at and fwritev_at transfer runs of small buffers.
+		constexpr std::size_t vectored_bounce_size = std::size_t(16) << 10;
+
+		// The largest number of bytes passed to a single read or write by freadv_at and fwritev_at.
+		constexpr std::size_t vectored_max_transfer = std::size_t(1) << 30;
+
+		// Returns the number of buffers, starting from First, whose sizes are each less than vectored_bounce_size and sum to at
+		// most vectored_bounce_size. Writes the sum to Size.
+		template <class BufferT>
+		[[nodiscard]] std::size_t vectored_run(std::span<BufferT const> const Buffers, std::size_t const First, std::size_t& Size) noexcept
+		{
+			auto last = First;
+			Size = 0;
+			while (last != Buffers.size() && Buffers[last].size <= vectored_bounce_size - Size)
+			{
+				Size += Buffers[last].size;
+				++last;
+			}
+			return last - First;
+		}
+
+		// Builds the null-terminated segment array passed to ReadFileScatter and WriteFileGather.
+		class file_segments
+		{
+		public:
+			explicit file_segments(std::span<void* const> const Pages) :
+				mData(Pages.size() < std::size(mLocal) ? mLocal : (mHeap = std::make_unique<FILE_SEGMENT_ELEMENT[]>(Pages.size() + 1)).get())
+			{
+				for (std::size_t i = 0; i != Pages.size(); ++i)
+				{
+					mData[i].Buffer = Pages[i];
+				}
+				mData[Pages.size()].Buffer = nullptr;
+			}
+
+			[[nodiscard]] FILE_SEGMENT_ELEMENT* get() const noexcept { return mData; }
+
+		private:
+			FILE_SEGMENT_ELEMENT mLocal[33];
+			std::unique_ptr<FILE_SEGMENT_ELEMENT[]> mHeap;
+			FILE_SEGMENT_ELEMENT* mData;
+		};
+	}
+
+	std::uint32_t fread_at(_In_ HANDLE const FileHandle, std::uint64_t const Offset, std::uint32_t const BufferSize,
+		_Out_writes_bytes_to_(BufferSize, return) void* const Buffer, _In_opt_ HANDLE const Event)
+	{
+		impl::record_file_read(FileHandle, Offset, BufferSize);
+		auto overlapped = impl::make_overlapped(Offset, Event);
+		return impl::complete_read(FileHandle, overlapped, ReadFile(FileHandle, Buffer, BufferSize, nullptr, &overlapped));
+	}
+
+	std::uint32_t fwrite_at(_In_ HANDLE const FileHandle, std::uint64_t const Offset, std::uint32_t const BufferSize,
+		_In_reads_bytes_(BufferSize) void const* const Buffer, _In_opt_ HANDLE const Event)
+	{
+		auto overlapped = impl::make_overlapped(Offset, Event);
+		return impl::complete_write(FileHandle, overlapped, WriteFile(FileHandle, Buffer, BufferSize, nullptr, &overlapped));
+	}
+
+	[[nodiscard]] HANDLE get_thread_io_event()
+	{
+		thread_local auto const event = create_event(event_access_mask(standard_access::synchronize, event_access::modify_state),
+			event_create_flags::manual_reset);
+		return event.get();
+	}
+
+	std::size_t freadv_at(_In_ HANDLE const FileHandle, std::uint64_t const Offset, std::span<file_read_buffer const> const Buffers,
+		_In_opt_ HANDLE const Event)
+	{
+		std::uint8_t bounce[impl::vectored_bounce_size];
+		auto offset = Offset;
+		std::size_t total = 0;
+		std::size_t i = 0;
+		while (i != Buffers.size())
+		{
+			std::size_t runSize;
+			auto const runCount = impl::vectored_run(Buffers, i, runSize);
+			if (runCount > 1)
+			{
+				// Read the run of small buffers with a single read, then copy the bytes to each buffer. A run of empty buffers
+				// needs no read.
+				auto const bytesRead = runSize == 0 ? 0 : fread_at(FileHandle, offset, static_cast<std::uint32_t>(runSize), bounce, Event);
+				std::size_t copied = 0;
+				for (auto j = i; j != i + runCount && copied != bytesRead; ++j)
+				{
+					auto const count = (std::min)(Buffers[j].size, bytesRead - copied);
+					if (count != 0)
+					{
+						std::memcpy(Buffers[j].data, bounce + copied, count);
+						copied += count;
+					}
+				}
+				total += bytesRead;
+				if (bytesRead != runSize)
+				{
+					return total;
+				}
+
+				// Every buffer of the run is consumed, including any empty buffers after the last byte copied.
+				i += runCount;
+				offset += runSize;
+				continue;
+			}
+
+			// Read a large buffer, or a small buffer which cannot be combined with the next, straight from the file.
+			auto const& buffer = Buffers[i++];
+			auto out = static_cast<std::uint8_t*>(buffer.data);
+			auto remaining = buffer.size;
+			while (remaining != 0)
+			{
+				auto const size = static_cast<std::uint32_t>((std::min)(remaining, impl::vectored_max_transfer));
+				auto const bytesRead = fread_at(FileHandle, offset, size, out, Event);
+				total += bytesRead;
+				if (bytesRead != size)
+				{
+					return total;
+				}
+				offset += size;
+				out += size;
+				remaining -= size;
+			}
+		}
+		return total;
+	}
+
+	void fwritev_at(_In_ HANDLE const FileHandle, std::uint64_t const Offset, std::span<file_write_buffer const> const Buffers,
+		_In_opt_ HANDLE const Event)
+	{
+		std::uint8_t bounce[impl::vectored_bounce_size];
+		auto offset = Offset;
+		std::size_t i = 0;
+		while (i != Buffers.size())
+		{
+			std::uint8_t const* in;
+			std::size_t remaining;
+			std::size_t runSize;
+			auto const runCount = impl::vectored_run(Buffers, i, runSize);
+			if (runCount > 1)
+			{
+				// Copy the run of small buffers together, then write them with a single write.
+				std::size_t copied = 0;
+				for (auto const last = i + runCount; i != last; ++i)
+				{
+					if (Buffers[i].size != 0)
+					{
+						std::memcpy(bounce + copied, Buffers[i].data, Buffers[i].size);
+						copied += Buffers[i].size;
+					}
+				}
+				in = bounce;
+				remaining = runSize;
+			}
+			else
+			{
+				in = static_cast<std::uint8_t const*>(Buffers[i].data);
+				remaining = Buffers[i].size;
+				++i;
+			}
+			while (remaining != 0)
+			{
+				auto const size = static_cast<std::uint32_t>((std::min)(remaining, impl::vectored_max_transfer));
+				auto const bytesWritten = fwrite_at(FileHandle, offset, size, in, Event);
+				if (bytesWritten == 0)
+				{
+					throw_win32(ERROR_WRITE_FAULT);
+				}
+				offset += bytesWritten;
+				in += bytesWritten;
+				remaining -= bytesWritten;
+			}
+		}
+	}
+
+	std::uint32_t fread_scatter(_In_ HANDLE const FileHandle, std::uint64_t const Offset, std::span<void* const> const Pages,
+		std::uint32_t const Size, _In_ HANDLE const Event)
+	{
+		WDUL_ASSERT(Size <= Pages.size() * page_size());
+		impl::file_segments segments(Pages);
+		auto overlapped = impl::make_overlapped(Offset, Event);
+		return impl::complete_read(FileHandle, overlapped, ReadFileScatter(FileHandle, segments.get(), Size, nullptr, &overlapped));
+	}
+
+	std::uint32_t fwrite_gather(_In_ HANDLE const FileHandle, std::uint64_t const Offset, std::span<void* const> const Pages,
+		std::uint32_t const Size, _In_ HANDLE const Event)
+	{
+		WDUL_ASSERT(Size <= Pages.size() * page_size());
+		impl::file_segments segments(Pages);
+		auto overlapped = impl::make_overlapped(Offset, Event);
+		return impl::complete_write(FileHandle, overlapped, WriteFileGather(FileHandle, segments.get(), Size, nullptr, &overlapped));
+	}
+
+	[[nodiscard]] fopen_code read_bytes(virtual_buffer& Output, _In_z_ wchar_t const* const Filename,
+		read_bytes_options const& Options, _Out_opt_ read_bytes_stats* const Stats)
+	{
+		// The largest number of bytes passed to a single read.
+		constexpr std::size_t maxChunkSize = std::size_t(1) << 30;
+
+		WDUL_ASSERT(Options.threads != 0);
+		auto const chunkSize = impl::round_up_size((std::clamp)(Options.chunk_size, page_size(), maxChunkSize), page_size());
+
+		file_handle f;
+		auto const code = fopen(f.put(), Filename, file_open_mode::open_existing,
+			FILE_FLAG_OVERLAPPED | (Options.unbuffered ? FILE_FLAG_NO_BUFFERING : FILE_FLAG_SEQUENTIAL_SCAN),
+			generic_access::read, file_share_mode::read);
 		if (code != fopen_code::success)
 		{
 			return code;
 		}
+		auto const size = file_size_cast<std::size_t>(fgetsize(f.get()));
 
-		auto const size = file_size_cast<std::uint32_t>(fgetsize(f.get()));
+		virtual_buffer bytes;
+		std::int64_t elapsed = 0;
+		if (size != 0)
+		{
+			// Unbuffered reads must cover whole sectors, so the last chunk may read into the slack after the end of the file.
+			auto const capacity = impl::round_up_size(size, page_size());
+			if (capacity == 0)
+			{
+				throw file_too_large();
+			}
+			bytes = virtual_buffer(capacity, Options.large_pages);
+			auto const data = bytes.append_uninitialized(capacity);
 
-		using allocator = byte_array::allocator;
-		auto data = static_cast<std::uint8_t*>(allocator::allocate(size));
+			auto const chunkCount = (size - 1) / chunkSize + 1;
+			auto const threadCount = static_cast<std::size_t>((std::min)(static_cast<std::size_t>(Options.threads), chunkCount));
+			std::atomic<std::size_t> nextChunk = 0;
+			std::atomic<bool> failed = false;
 
-		auto dataDeleter = finally([&]() { allocator::deallocate_unchecked(data); });
+			// If the file is truncated while being read, the buffer is truncated to the end of the first short read.
+			std::atomic<std::size_t> end = size;
 
-		fread(f.get(), size, data);
+			auto const readChunks = [&]()
+			{
+				auto const event = create_event(event_access_mask(standard_access::synchronize, event_access::modify_state),
+					event_create_flags::manual_reset);
+				for (;;)
+				{
+					auto const chunk = nextChunk.fetch_add(1, std::memory_order_relaxed);
+					if (chunk >= chunkCount || failed.load(std::memory_order_relaxed))
+					{
+						return;
+					}
+					auto const offset = chunk * chunkSize;
+					auto const expected = (std::min)(chunkSize, size - offset);
+					auto const bytesRead = fread_at(f.get(), offset,
+						static_cast<std::uint32_t>((std::min)(chunkSize, capacity - offset)), data + offset,
+						event.get());
+					if (bytesRead < expected)
+					{
+						auto const chunkEnd = offset + bytesRead;
+						auto current = end.load(std::memory_order_relaxed);
+						while (chunkEnd < current && !end.compare_exchange_weak(current, chunkEnd, std::memory_order_relaxed))
+						{
+						}
+					}
+				}
+			};
 
+			std::vector<std::exception_ptr> errors(threadCount);
+			std::vector<std::thread> threads;
+			threads.reserve(threadCount - 1);
+			auto const start = get_performance_counts();
+			try
+			{
+				for (std::size_t i = 1; i < threadCount; ++i)
+				{
+					threads.emplace_back([&, i]()
+						{
+							try
+							{
+								readChunks();
+							}
+							catch (...)
+							{
+								errors[i] = std::current_exception();
+								failed.store(true, std::memory_order_relaxed);
+							}
+						});
+				}
+				readChunks();
+			}
+			catch (...)
+			{
+				errors[0] = std::current_exception();
+				failed.store(true, std::memory_order_relaxed);
+			}
+			for (auto& t : threads)
+			{
+				t.join();
+			}
+			elapsed = get_performance_counts() - start;
+			for (auto const& e : errors)
+			{
+				if (e)
+				{
+					std::rethrow_exception(e);
+				}
+			}
+			bytes.resize(end.load(std::memory_order_relaxed));
+		}
 		f.close();
 
-		dataDeleter.revoke();
+		if (Stats)
+		{
+			Stats->bytes = bytes.size();
+			Stats->seconds = static_cast<double>(elapsed) / static_cast<double>(get_performance_counts_per_sec());
+		}
+		Output = std::move(bytes);
+		return fopen_code::success;
+	}
+
+	namespace impl
+	{
+		// A directory waiting to be enumerated by a directory_walker.
+		struct directory_walk_item
+		{
+			std::wstring path;
+
+			// The depth of the entries of the directory.
+			std::uint32_t depth;
+		};
+
+		// Enumerates a directory tree for walk_directory, on one or more threads which share a stack of directories waiting to
+		// be enumerated.
+		class directory_walker
+		{
+		public:
+			directory_walker(directory_walk_options const& Options, directory_batch_callback const OnBatch, void* const BatchContext,
+				directory_descend_callback const Descend, void* const DescendContext) :
+				mOptions(Options),
+				mOnBatch(OnBatch),
+				mBatchContext(BatchContext),
+				mDescend(Descend),
+				mDescendContext(DescendContext)
+			{
+			}
+
+			// Enumerates the root directory on the calling thread, and returns the error code if it cannot be enumerated.
+			[[nodiscard]] fopen_code start(std::wstring Root)
+			{
+				worker_state worker(mOptions.batch_size);
+				auto const error = enumerate(worker, { std::move(Root), 0 });
+				flush(worker);
+				switch (error)
+				{
+				case ERROR_SUCCESS:
+					return fopen_code::success;
+
+				case ERROR_FILE_NOT_FOUND:
+				case ERROR_PATH_NOT_FOUND:
+				case ERROR_DIRECTORY:
+					return fopen_code::not_found;
+
+				case ERROR_ACCESS_DENIED:
+					return fopen_code::access_denied;
+
+				default:
+					throw_win32(error);
+				}
+			}
+
+			// Enumerates directories until there are none left, or another thread fails.
+			void run() noexcept
+			{
+				try
+				{
+					worker_state worker(mOptions.batch_size);
+					directory_walk_item item;
+					while (pop(item))
+					{
+						auto const finish = finally_always([this]() noexcept
+							{
+								std::lock_guard lock(mMutex);
+								if (--mActive == 0 && mPending.empty())
+								{
+									mAvailable.notify_all();
+								}
+							});
+						if (enumerate(worker, std::move(item)) != ERROR_SUCCESS)
+						{
+							mStats.skipped.fetch_add(1, std::memory_order_relaxed);
+						}
+					}
+					flush(worker);
+				}
+				catch (...)
+				{
+					std::lock_guard lock(mMutex);
+					if (!mError)
+					{
+						mError = std::current_exception();
+					}
+					mStopped.store(true, std::memory_order_relaxed);
+					mAvailable.notify_all();
+				}
+			}
+
+			// Rethrows the first exception thrown by a thread, if any.
+			void rethrow_error() const
+			{
+				if (mError)
+				{
+					std::rethrow_exception(mError);
+				}
+			}
+
+			void get_stats(directory_walk_stats& Stats) const noexcept
+			{
+				Stats.directories = mStats.directories.load(std::memory_order_relaxed);
+				Stats.entries = mStats.entries.load(std::memory_order_relaxed);
+				Stats.skipped = mStats.skipped.load(std::memory_order_relaxed);
+			}
+
+		private:
+			// The state of a thread which enumerates directories. The strings of the entries in a batch are stored in a fixed
+			// block of characters, so that no entry needs its own allocation.
+			struct worker_state
+			{
+				// The number of characters in the block. Greater than the longest path accepted by the system.
+				static constexpr std::size_t char_capacity = std::size_t(64) << 10;
+
+				explicit worker_state(std::size_t const BatchSize) :
+					chars(std::make_unique_for_overwrite<wchar_t[]>(char_capacity)),
+					charCount(0)
+				{
+					batch.reserve(BatchSize);
+				}
+
+				std::vector<directory_entry> batch;
+				std::unique_ptr<wchar_t[]> chars;
+				std::size_t charCount;
+				std::wstring search;
+			};
+
+			// Waits until a directory is waiting to be enumerated, and takes it. Returns false once no directories are waiting
+			// and none are being enumerated, or another thread failed.
+			[[nodiscard]] bool pop(directory_walk_item& Item)
+			{
+				std::unique_lock lock(mMutex);
+				mAvailable.wait(lock, [this]()
+					{
+						return !mPending.empty() || mActive == 0 || mStopped.load(std::memory_order_relaxed);
+					});
+				if (mPending.empty() || mStopped.load(std::memory_order_relaxed))
+				{
+					return false;
+				}
+				Item = std::move(mPending.back());
+				mPending.pop_back();
+				++mActive;
+				return true;
+			}
+
+			void push(std::wstring_view const Path, std::uint32_t const Depth)
+			{
+				directory_walk_item item{ std::wstring(Path), Depth };
+				std::lock_guard lock(mMutex);
+				mPending.push_back(std::move(item));
+				mAvailable.notify_one();
+			}
+
+			// Passes the batch of entries to the callback, and empties it.
+			void flush(worker_state& Worker)
+			{
+				if (!Worker.batch.empty())
+				{
+					mOnBatch(mBatchContext, Worker.batch);
+					Worker.batch.clear();
+				}
+				Worker.charCount = 0;
+			}
+
+			// Enumerates a directory, adding its entries to the batch and pushing its subdirectories. Returns ERROR_SUCCESS, or
+			// the error code if the directory cannot be listed, such as because access was denied, or its path is too long.
+			[[nodiscard]] std::uint32_t enumerate(worker_state& Worker, directory_walk_item const Item)
+			{
+				Worker.search.assign(Item.path);
+				Worker.search.append(L"\\*");
+
+				// FindExInfoBasic omits the short name, and FIND_FIRST_EX_LARGE_FETCH lists the directory in larger blocks.
+				WIN32_FIND_DATAW data;
+				find_file_handle find(FindFirstFileExW(Worker.search.c_str(), FindExInfoBasic, &data, FindExSearchNameMatch, nullptr,
+					FIND_FIRST_EX_LARGE_FETCH));
+				if (!find)
+				{
+					return GetLastError();
+				}
+				mStats.directories.fetch_add(1, std::memory_order_relaxed);
+
+				// The entries found are counted even if the walk stops partway through the directory.
+				std::uint64_t entryCount = 0;
+				auto const countEntries = finally_always([this, &entryCount]() noexcept
+					{
+						mStats.entries.fetch_add(entryCount, std::memory_order_relaxed);
+					});
+				do
+				{
+					std::wstring_view const name(data.cFileName);
+					if (name == L"." || name == L"..")
+					{
+						continue;
+					}
+					++entryCount;
+					if (data.dwFileAttributes & mOptions.exclude_attributes)
+					{
+						continue;
+					}
+					auto const isDirectory = (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+					auto const descend = isDirectory && Item.depth < mOptions.max_depth &&
+						(mOptions.follow_reparse_points || !(data.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT));
+					auto const report = isDirectory ? mOptions.report_directories : mOptions.report_files;
+					if (!descend && !report)
+					{
+						continue;
+					}
+
+					auto const pathSize = Item.path.size() + 1 + name.size();
+					if (pathSize > worker_state::char_capacity - Worker.charCount)
+					{
+						flush(Worker);
+						if (mStopped.load(std::memory_order_relaxed))
+						{
+							return ERROR_SUCCESS;
+						}
+					}
+					auto const path = Worker.chars.get() + Worker.charCount;
+					std::copy(Item.path.begin(), Item.path.end(), path);
+					path[Item.path.size()] = L'\\';
+					std::copy(name.begin(), name.end(), path + Item.path.size() + 1);
+					directory_entry const entry
+					{
+						.path = { path, pathSize },
+						.name = { path + Item.path.size() + 1, name.size() },
+						.attributes = static_cast<std::uint32_t>(data.dwFileAttributes),
+						.depth = Item.depth,
+						.size = isDirectory ? 0 : (static_cast<std::uint64_t>(data.nFileSizeHigh) << 32) | data.nFileSizeLow,
+						.last_write_time = (static_cast<std::uint64_t>(data.ftLastWriteTime.dwHighDateTime) << 32) |
+							data.ftLastWriteTime.dwLowDateTime,
+					};
+
+					if (descend && (!mDescend || mDescend(mDescendContext, entry)))
+					{
+						push(entry.path, Item.depth + 1);
+					}
+					if (report)
+					{
+						Worker.charCount += pathSize;
+						Worker.batch.push_back(entry);
+						if (Worker.batch.size() >= mOptions.batch_size)
+						{
+							flush(Worker);
+							if (mStopped.load(std::memory_order_relaxed))
+							{
+								return ERROR_SUCCESS;
+							}
+						}
+					}
+				} while (FindNextFileW(find.get(), &data));
+
+				auto const error = GetLastError();
+				if (error != ERROR_NO_MORE_FILES)
+				{
+					throw_win32(error);
+				}
+				return ERROR_SUCCESS;
+			}
+
+			directory_walk_options const& mOptions;
+			directory_batch_callback const mOnBatch;
+			void* const mBatchContext;
+			directory_descend_callback const mDescend;
+			void* const mDescendContext;
+
+			std::mutex mMutex;
+
+			// Notified when a directory is pushed, or when the walk finishes or fails.
+			std::condition_variable mAvailable;
+
+			std::vector<directory_walk_item> mPending;
+
+			// The number of directories being enumerated.
+			unsigned mActive = 0;
+
+			std::atomic<bool> mStopped = false;
+			std::exception_ptr mError;
+
+			struct
+			{
+				std::atomic<std::uint64_t> directories = 0;
+				std::atomic<std::uint64_t> entries = 0;
+				std::atomic<std::uint64_t> skipped = 0;
+			} mStats;
+		};
+
+		[[nodiscard]] fopen_code walk_directory(_In_z_ wchar_t const* const Root, directory_walk_options const& Options,
+			directory_batch_callback const OnBatch, void* const BatchContext, directory_descend_callback const Descend,
+			void* const DescendContext, directory_walk_stats* const Stats)
+		{
+			WDUL_ASSERT(Options.threads != 0);
+			WDUL_ASSERT(Options.batch_size != 0);
+
+			// Paths of entries are formed by appending a backslash and a name to the path of their directory.
+			std::wstring root(Root);
+			while (!root.empty() && (root.back() == L'\\' || root.back() == L'/'))
+			{
+				root.pop_back();
+			}
+
+			directory_walker walker(Options, OnBatch, BatchContext, Descend, DescendContext);
+
+			// The statistics are written even if a callback throws, so the caller can tell how far the walk got.
+			auto const writeStats = finally_always([&walker, Stats]() noexcept
+				{
+					if (Stats)
+					{
+						walker.get_stats(*Stats);
+					}
+				});
+
+			auto const code = walker.start(std::move(root));
+			if (code != fopen_code::success)
+			{
+				return code;
+			}
 
-		Output = byte_array(size, data, take_ownership);
+			std::vector<std::thread> threads;
+			threads.reserve(Options.threads - 1);
+			{
+				// The threads must be joined even if a thread cannot be started.
+				auto const joiner = finally_always([&threads]() noexcept
+					{
+						for (auto& thread : threads)
+						{
+							thread.join();
+						}
+					});
+				for (unsigned i = 1; i < Options.threads; ++i)
+				{
+					threads.emplace_back([&walker]() { walker.run(); });
+				}
+				walker.run();
+			}
+			walker.rethrow_error();
+			return fopen_code::success;
+		}
+	}
+
+	void start_file_access_recording()
+	{
+		auto& recorder = impl::get_file_access_recorder();
+		std::lock_guard lock(recorder.mutex);
+		if (impl::recording_file_accesses.load(std::memory_order_relaxed))
+		{
+			throw hresult_invalid_state();
+		}
+		impl::recording_file_accesses.store(true, std::memory_order_relaxed);
+		impl::file_access_generation.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	[[nodiscard]] std::vector<file_access_entry> stop_file_access_recording()
+	{
+		auto& recorder = impl::get_file_access_recorder();
+		std::vector<file_access_entry> entries;
+		{
+			std::lock_guard lock(recorder.mutex);
+			for (auto cache = recorder.caches; cache; cache = cache->next)
+			{
+				std::lock_guard cacheLock(cache->mutex);
+				if (impl::recording_file_accesses.load(std::memory_order_relaxed))
+				{
+					impl::flush_file_read_cache(recorder, *cache);
+				}
+				cache->handle = nullptr;
+			}
+			impl::recording_file_accesses.store(false, std::memory_order_relaxed);
+			impl::file_access_generation.fetch_add(1, std::memory_order_relaxed);
+			entries.swap(recorder.entries);
+			recorder.indices.clear();
+			recorder.ids.clear();
+		}
+		for (auto& entry : entries)
+		{
+			impl::normalize_file_ranges(entry.ranges);
+		}
+		return entries;
+	}
+
+	namespace impl
+	{
+		// A file access profile begins with these three values, followed by each file: the length of its path in characters, the
+		// characters of its path, the number of ranges, then the first block and number of blocks of each range, where a block is
+		// file_access_granularity bytes. Every value is a little-endian 32-bit integer, except the characters of the paths.
+		constexpr std::uint32_t file_access_profile_magic = MAKEFOURCC('W', 'F', 'A', 'P');
+
+		// Changes whenever the format, or file_access_granularity, changes.
+		constexpr std::uint32_t file_access_profile_version = 1;
+	}
+
+	void save_file_access_profile(std::span<file_access_entry const> const Profile, _In_z_ wchar_t const* const Filename)
+	{
+		std::vector<std::uint8_t> bytes;
+		auto const append = [&bytes](void const* const Data, std::size_t const Size)
+		{
+			auto const first = static_cast<std::uint8_t const*>(Data);
+			bytes.insert(bytes.end(), first, first + Size);
+		};
+		auto const append_u32 = [&append](std::uint32_t const Value)
+		{
+			append(&Value, sizeof(Value));
+		};
+
+		append_u32(impl::file_access_profile_magic);
+		append_u32(impl::file_access_profile_version);
+		append_u32(static_cast<std::uint32_t>(Profile.size()));
+		for (auto const& entry : Profile)
+		{
+			append_u32(static_cast<std::uint32_t>(entry.path.size()));
+			append(entry.path.data(), entry.path.size() * sizeof(wchar_t));
+
+			// A range which begins beyond the first 256 TiB of a file cannot be stored, and is not worth prefetching anyway.
+			constexpr std::uint64_t maxBlocks = 0xFFFFFFFF;
+			auto const count = std::count_if(entry.ranges.begin(), entry.ranges.end(), [](file_range const& Range)
+				{
+					return Range.offset / file_access_granularity <= maxBlocks;
+				});
+			append_u32(static_cast<std::uint32_t>(count));
+			for (auto const& range : entry.ranges)
+			{
+				auto const first = range.offset / file_access_granularity;
+				if (first <= maxBlocks)
+				{
+					append_u32(static_cast<std::uint32_t>(first));
+					append_u32(static_cast<std::uint32_t>((std::min)(
+						impl::round_up_size(range.size, file_access_granularity) / file_access_granularity, maxBlocks)));
+				}
+			}
+		}
+
+		// The profile is written to a temporary file, which then replaces the target, so that a failure part way through leaves
+		// the previous profile intact rather than a truncated one.
+		std::wstring temporary(Filename);
+		temporary += L".tmp";
+		auto file = fopen(temporary.c_str(), file_open_mode::create_always, FILE_ATTRIBUTE_NORMAL, generic_access::write,
+			file_share_mode::none);
+		auto remover = finally([&]()
+			{
+				(void)file.try_close();
+				DeleteFileW(temporary.c_str());
+			});
+		std::size_t written = 0;
+		while (written != bytes.size())
+		{
+			written += fwrite(file.get(), static_cast<std::uint32_t>((std::min)(bytes.size() - written, std::size_t(1) << 30)),
+				bytes.data() + written);
+		}
+		file.close();
+		check_bool(MoveFileExW(temporary.c_str(), Filename, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH));
+		remover.revoke();
+	}
+
+	[[nodiscard]] fopen_code load_file_access_profile(std::vector<file_access_entry>& Profile, _In_z_ wchar_t const* const Filename)
+	{
+		Profile.clear();
+		byte_array bytes;
+		auto const code = read_bytes(bytes, Filename);
+		if (code != fopen_code::success)
+		{
+			return code;
+		}
+
+		std::size_t cursor = 0;
+		auto const take = [&](void* const Out, std::size_t const Size) -> bool
+		{
+			if (bytes.size() - cursor < Size)
+			{
+				return false;
+			}
+			std::memcpy(Out, bytes.data() + cursor, Size);
+			cursor += Size;
+			return true;
+		};
+		auto const take_u32 = [&take](std::uint32_t& Value) -> bool
+		{
+			return take(&Value, sizeof(Value));
+		};
+
+		std::uint32_t magic, version, count;
+		if (!take_u32(magic) || magic != impl::file_access_profile_magic ||
+			!take_u32(version) || version != impl::file_access_profile_version ||
+			!take_u32(count))
+		{
+			return fopen_code::success;
+		}
+
+		// Every count is checked against the bytes remaining before anything is allocated, so a corrupt profile cannot cause a
+		// huge allocation.
+		std::vector<file_access_entry> profile;
+		for (std::uint32_t i = 0; i != count; ++i)
+		{
+			std::uint32_t pathLength;
+			if (!take_u32(pathLength) || pathLength > (bytes.size() - cursor) / sizeof(wchar_t))
+			{
+				return fopen_code::success;
+			}
+			auto& entry = profile.emplace_back();
+			entry.path.resize(pathLength);
+			take(entry.path.data(), pathLength * sizeof(wchar_t));
+
+			std::uint32_t rangeCount;
+			if (!take_u32(rangeCount) || rangeCount > (bytes.size() - cursor) / (2 * sizeof(std::uint32_t)))
+			{
+				return fopen_code::success;
+			}
+			entry.ranges.resize(rangeCount);
+			for (auto& range : entry.ranges)
+			{
+				std::uint32_t first, blocks;
+				take_u32(first);
+				take_u32(blocks);
+				range.offset = first * file_access_granularity;
+				range.size = blocks * file_access_granularity;
+			}
+		}
+		Profile = std::move(profile);
 		return fopen_code::success;
 	}
 }
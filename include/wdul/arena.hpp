@@ -0,0 +1,410 @@
+// This file is part of the WillDaisey/WDUL (Windows Desktop Utility Library) project.
+// View this project on github: https://github.com/WillDaisey/wdul/
+
+#pragma once
+#include "memory.hpp"
+#include <algorithm>
+
+namespace wdul
+{
+	/// <summary>
+	/// Identifies a position within a <c>basic_monotonic_arena</c>. Pass the mark to <c>basic_monotonic_arena::rewind</c> to
+	/// deallocate every block allocated after the mark was taken.
+	/// </summary>
+	struct arena_mark
+	{
+		void* chunk;
+		std::uint8_t* cursor;
+	};
+
+	/// <summary>
+	/// A bump-pointer (monotonic) arena. Storage is carved out of chunks obtained from <typeparamref name="UpstreamT"/>, and is
+	/// only returned to the arena as a whole through <c>reset</c>, <c>rewind</c> or <c>release</c>.
+	/// <para>
+	/// Each block records its size, so the most recently allocated block can grow or shrink in place, and deallocating the most
+	/// recently allocated block returns its storage to the arena. Deallocating any other block does nothing.
+	/// </para>
+	/// <para>Chunks are kept by <c>reset</c> and <c>rewind</c> so they can be reused; only <c>release</c> and the destructor return
+	/// chunks to the upstream allocator, except that a retained chunk too small for any later allocation is replaced by a bigger
+	/// one.</para>
+	/// </summary>
+	/// <typeparam name="UpstreamT">Allocator traits used to allocate chunks.</typeparam>
+	template <allocate_traits UpstreamT>
+	class basic_monotonic_arena
+	{
+	public:
+		using upstream_allocator = allocator<UpstreamT>;
+
+		/// <summary>The default minimum size of a chunk, in bytes.</summary>
+		static constexpr std::size_t default_chunk_size = 64 * 1024;
+
+		/// <summary>The alignment of every block returned by the arena.</summary>
+		static constexpr std::size_t alignment = default_allocation_alignment;
+
+		basic_monotonic_arena(basic_monotonic_arena const&) = delete;
+		basic_monotonic_arena& operator=(basic_monotonic_arena const&) = delete;
+
+		/// <summary>Constructs an empty arena. No storage is allocated until the first allocation is made.</summary>
+		/// <param name="ChunkSize">The minimum size of each chunk the arena allocates from the upstream allocator.</param>
+		explicit basic_monotonic_arena(std::size_t const ChunkSize = default_chunk_size) noexcept :
+			mChunkSize(ChunkSize)
+		{
+		}
+
+		~basic_monotonic_arena()
+		{
+			release();
+		}
+
+		/// <summary>Allocates a block of at least <paramref name="Size"/> bytes. Throws <c>std::bad_alloc</c> on failure.</summary>
+		/// <param name="Size">The size of the block. Must be non-zero.</param>
+		[[nodiscard]] void* allocate(std::size_t const Size)
+		{
+			WDUL_ASSERT(Size != 0);
+			auto const blockSize = block_size_for(Size);
+			if (static_cast<std::size_t>(mEnd - mCursor) < blockSize)
+			{
+				next_chunk(blockSize);
+			}
+			auto const header = mCursor;
+			mCursor += blockSize;
+			std::memcpy(header, &Size, sizeof(Size));
+			mLast = header + header_size;
+			return mLast;
+		}
+
+		/// <summary>Same as <c>allocate</c>, except the block is filled with zeroes.</summary>
+		[[nodiscard]] void* allocate_zeroed(std::size_t const Size)
+		{
+			auto const p = allocate(Size);
+			std::memset(p, 0, Size);
+			return p;
+		}
+
+		/// <summary>
+		/// If <paramref name="Ptr"/> is the most recently allocated block, its storage is returned to the arena. Otherwise, the
+		/// function does nothing. <paramref name="Ptr"/> may be <c>nullptr</c>.
+		/// </summary>
+		void deallocate(void* const Ptr) noexcept
+		{
+			if (Ptr && Ptr == mLast)
+			{
+				mCursor = mLast - header_size;
+				mLast = nullptr;
+			}
+		}
+
+		/// <summary>
+		/// Attempts to resize the block pointed to by <paramref name="Ptr"/> without moving it.
+		/// Any block can shrink in place, but only the most recently allocated block can grow in place.
+		/// </summary>
+		/// <returns><paramref name="Ptr"/> if the block was resized, otherwise <c>nullptr</c>.</returns>
+		[[nodiscard]] void* expand(void* const Ptr, std::size_t const Size) noexcept
+		{
+			WDUL_ASSERT(Size != 0);
+			if (!Ptr)
+			{
+				return nullptr;
+			}
+			auto const p = static_cast<std::uint8_t*>(Ptr);
+			if (p == mLast)
+			{
+				if (Size > max_block_size || static_cast<std::size_t>(mEnd - p) < round_up(Size))
+				{
+					return nullptr;
+				}
+				mCursor = p + round_up(Size);
+			}
+			else if (Size > block_size(Ptr))
+			{
+				return nullptr;
+			}
+			std::memcpy(p - header_size, &Size, sizeof(Size));
+			return Ptr;
+		}
+
+		/// <summary>
+		/// Resizes the block pointed to by <paramref name="Ptr"/>, growing in place where possible, otherwise allocating a new block
+		/// and copying the contents. If <paramref name="Ptr"/> is <c>nullptr</c>, the function performs an allocation.
+		/// </summary>
+		[[nodiscard]] void* reallocate(void* const Ptr, std::size_t const Size)
+		{
+			if (!Ptr)
+			{
+				return allocate(Size);
+			}
+			if (expand(Ptr, Size))
+			{
+				return Ptr;
+			}
+			auto const oldSize = block_size(Ptr);
+			auto const p = allocate(Size);
+			std::memcpy(p, Ptr, (std::min)(oldSize, Size));
+			return p;
+		}
+
+		/// <summary>Same as <c>reallocate</c>, except any bytes beyond the old size of the block are filled with zeroes.</summary>
+		[[nodiscard]] void* reallocate_zeroed(void* const Ptr, std::size_t const Size)
+		{
+			if (!Ptr)
+			{
+				return allocate_zeroed(Size);
+			}
+			auto const oldSize = block_size(Ptr);
+			auto const p = static_cast<std::uint8_t*>(reallocate(Ptr, Size));
+			if (Size > oldSize)
+			{
+				std::memset(p + oldSize, 0, Size - oldSize);
+			}
+			return p;
+		}
+
+		/// <returns>The size, in bytes, last requested for the block pointed to by <paramref name="Ptr"/>.</returns>
+		[[nodiscard]] static std::size_t block_size(void const* const Ptr) noexcept
+		{
+			WDUL_ASSERT(Ptr != nullptr);
+			std::size_t size;
+			std::memcpy(&size, static_cast<std::uint8_t const*>(Ptr) - header_size, sizeof(size));
+			return size;
+		}
+
+		/// <returns>A mark which identifies the current position of the arena.</returns>
+		[[nodiscard]] arena_mark mark() const noexcept
+		{
+			return { .chunk = mCurrent, .cursor = mCursor };
+		}
+
+		/// <summary>
+		/// Deallocates every block allocated since <paramref name="Mark"/> was taken. The chunks are kept for reuse.
+		/// <para><paramref name="Mark"/> must have been returned by this arena, and must not have been invalidated by a call to
+		/// <c>rewind</c> with an earlier mark, or by <c>reset</c> or <c>release</c>.</para>
+		/// </summary>
+		void rewind(arena_mark const& Mark) noexcept
+		{
+			if (!Mark.chunk)
+			{
+				reset();
+				return;
+			}
+			mCurrent = static_cast<chunk*>(Mark.chunk);
+			mCursor = Mark.cursor;
+			mEnd = chunk_data(mCurrent) + mCurrent->capacity;
+			mLast = nullptr;
+		}
+
+		/// <summary>Deallocates every block allocated from the arena. The chunks are kept for reuse.</summary>
+		void reset() noexcept
+		{
+			mCurrent = mFirst;
+			mLast = nullptr;
+			if (mCurrent)
+			{
+				mCursor = chunk_data(mCurrent);
+				mEnd = mCursor + mCurrent->capacity;
+			}
+			else
+			{
+				mCursor = nullptr;
+				mEnd = nullptr;
+			}
+		}
+
+		/// <summary>Deallocates every block allocated from the arena, and returns every chunk to the upstream allocator.</summary>
+		void release() noexcept
+		{
+			auto c = mFirst;
+			while (c)
+			{
+				upstream_allocator::deallocate_unchecked(std::exchange(c, c->next));
+			}
+			mFirst = nullptr;
+			reset();
+		}
+
+	private:
+		struct chunk
+		{
+			chunk* next;
+			std::size_t capacity;
+		};
+
+		static constexpr std::size_t round_up(std::size_t const Size) noexcept
+		{
+			return (Size + (alignment - 1)) & ~(alignment - 1);
+		}
+
+		static constexpr std::size_t header_size = round_up(sizeof(std::size_t));
+		static constexpr std::size_t chunk_header_size = round_up(sizeof(chunk));
+		static constexpr std::size_t max_block_size = (std::numeric_limits<std::size_t>::max)() - chunk_header_size - header_size - alignment;
+
+		static std::uint8_t* chunk_data(chunk* const Chunk) noexcept
+		{
+			return reinterpret_cast<std::uint8_t*>(Chunk) + chunk_header_size;
+		}
+
+		static std::size_t block_size_for(std::size_t const Size)
+		{
+			if (Size > max_block_size)
+			{
+				throw std::bad_alloc();
+			}
+			return header_size + round_up(Size);
+		}
+
+		// Makes the arena allocate from a chunk which can hold at least BlockSize bytes.
+		// The first retained chunk after the current chunk which is big enough is moved to follow the current chunk, and reused.
+		// If no retained chunk is big enough, the chunk after the current chunk is replaced by a new, bigger chunk, so the number
+		// of chunks only grows when every chunk is in use.
+		void next_chunk(std::size_t const BlockSize)
+		{
+			auto const next = mCurrent ? &mCurrent->next : &mFirst;
+			auto link = next;
+			while (*link && (*link)->capacity < BlockSize)
+			{
+				link = &(*link)->next;
+			}
+
+			auto c = *link;
+			if (c)
+			{
+				*link = c->next;
+				c->next = *next;
+				*next = c;
+			}
+			else
+			{
+				auto const capacity = (std::max)(mChunkSize, BlockSize);
+				c = static_cast<chunk*>(upstream_allocator::allocate(chunk_header_size + capacity));
+				if (!c)
+				{
+					throw std::bad_alloc();
+				}
+				c->capacity = capacity;
+				c->next = *next;
+				if (c->next)
+				{
+					upstream_allocator::deallocate_unchecked(std::exchange(c->next, c->next->next));
+				}
+				*next = c;
+			}
+			mCurrent = c;
+			mCursor = chunk_data(c);
+			mEnd = mCursor + c->capacity;
+			mLast = nullptr;
+		}
+
+		std::size_t mChunkSize;
+		chunk* mFirst = nullptr;
+		chunk* mCurrent = nullptr;
+		std::uint8_t* mCursor = nullptr;
+		std::uint8_t* mEnd = nullptr;
+
+		// Pointer to the most recently allocated block, or nullptr if it is unknown.
+		std::uint8_t* mLast = nullptr;
+	};
+
+	namespace impl
+	{
+		template <class ArenaT>
+		inline thread_local ArenaT* current_arena = nullptr;
+	}
+
+	/// <summary>
+	/// Allocator traits which allocate from the calling thread's current arena.
+	/// <para>
+	/// The current arena is set with <c>basic_arena_scope</c>. If the calling thread has no current arena, the calling thread's
+	/// default arena (see <c>thread_default_arena</c>) is used.
+	/// </para>
+	/// <para>
+	/// Storage should be deallocated, expanded and reallocated on the thread which allocated it, while the same arena is current.
+	/// Deallocating storage that was allocated from a different arena does nothing.
+	/// </para>
+	/// </summary>
+	/// <typeparam name="ArenaT">The arena type, such as <c>monotonic_arena</c>.</typeparam>
+	template <class ArenaT>
+	struct basic_arena_alloc_traits
+	{
+		/// <returns>The arena which the calling thread currently allocates from.</returns>
+		[[nodiscard]] static ArenaT& arena() noexcept
+		{
+			auto const current = impl::current_arena<ArenaT>;
+			return current ? *current : thread_default_arena();
+		}
+
+		/// <returns>
+		/// The calling thread's default arena. It is created on first use and destroyed when the thread exits.
+		/// </returns>
+		[[nodiscard]] static ArenaT& thread_default_arena() noexcept
+		{
+			thread_local ArenaT inst;
+			return inst;
+		}
+
+		[[nodiscard]] static void* allocate(std::size_t const Size)
+		{
+			return arena().allocate(Size);
+		}
+
+		[[nodiscard]] static void* allocate_zeroed(std::size_t const Size)
+		{
+			return arena().allocate_zeroed(Size);
+		}
+
+		static void deallocate(void* const Ptr) noexcept
+		{
+			arena().deallocate(Ptr);
+		}
+
+		[[nodiscard]] static void* reallocate(void* const Ptr, std::size_t const Size)
+		{
+			return arena().reallocate(Ptr, Size);
+		}
+
+		[[nodiscard]] static void* reallocate_zeroed(void* const Ptr, std::size_t const Size)
+		{
+			return arena().reallocate_zeroed(Ptr, Size);
+		}
+
+		[[nodiscard]] static void* expand(void* const Ptr, std::size_t const Size) noexcept
+		{
+			return arena().expand(Ptr, Size);
+		}
+
+		[[nodiscard]] static std::size_t usable_size(void const* const Ptr) noexcept
+		{
+			return ArenaT::block_size(Ptr);
+		}
+	};
+
+	/// <summary>
+	/// Makes an arena the current arena of the calling thread for the lifetime of the <c>basic_arena_scope</c> object.
+	/// The previous current arena is restored when the object is destroyed. Scopes may be nested.
+	/// </summary>
+	/// <typeparam name="ArenaT">The arena type, such as <c>monotonic_arena</c>.</typeparam>
+	template <class ArenaT>
+	class basic_arena_scope
+	{
+	public:
+		basic_arena_scope(basic_arena_scope const&) = delete;
+		basic_arena_scope& operator=(basic_arena_scope const&) = delete;
+
+		explicit basic_arena_scope(ArenaT& Arena) noexcept :
+			mPrevious(std::exchange(impl::current_arena<ArenaT>, &Arena))
+		{
+		}
+
+		~basic_arena_scope()
+		{
+			impl::current_arena<ArenaT> = mPrevious;
+		}
+
+	private:
+		ArenaT* mPrevious;
+	};
+
+	using monotonic_arena = basic_monotonic_arena<malloc_traits>;
+	using arena_alloc_traits = basic_arena_alloc_traits<monotonic_arena>;
+	using arena_allocator = allocator<arena_alloc_traits>;
+	using arena_scope = basic_arena_scope<monotonic_arena>;
+	using arena_byte_array = basic_byte_array<arena_alloc_traits>;
+}
@@ -0,0 +1,387 @@
+// This file is part of the WillDaisey/WDUL (Windows Desktop Utility Library) project.
+// View this project on github: https://github.com/WillDaisey/wdul/
+
+#pragma once
+#include "memory.hpp"
+#include <initializer_list>
+#include <memory>
+#include <type_traits>
+
+namespace wdul
+{
+	// Specifies whether objects of type T are trivially relocatable: an object can be moved to new storage by copying its
+	// bytes, after which the original object is treated as destroyed, without calling its destructor.
+	// Trivially copyable types are trivially relocatable. Specialise this template to declare other types trivially relocatable,
+	// for example, types which only hold an owning pointer.
+	template <class T>
+	struct is_trivially_relocatable : std::bool_constant<std::is_trivially_copyable_v<T>> {};
+
+	template <class T>
+	inline constexpr bool is_trivially_relocatable_v = is_trivially_relocatable<T>::value;
+
+	/// <summary>
+	/// Manages a dynamically allocated array of objects of type <typeparamref name="T"/>.
+	/// <para>
+	/// If <typeparamref name="T"/> is trivially relocatable (see <c>is_trivially_relocatable</c>), the storage grows by resizing
+	/// it in place (see <c>allocator::expand</c>), and failing that, by reallocating it (see <c>allocator::reallocate</c>), rather
+	/// than by allocating new storage, moving each element and destroying the old elements. With allocators such as
+	/// <c>heap_alloc_traits</c>, the storage is usually resized in place, so growing the array copies nothing and never holds
+	/// two copies of the elements at once.
+	/// </para>
+	/// <para>Otherwise, the array grows like <c>std::vector</c>.</para>
+	/// </summary>
+	/// <typeparam name="T">The element type.</typeparam>
+	/// <typeparam name="AllocT">Allocator traits which specify how to allocate and deallocate storage.</typeparam>
+	template <class T, allocate_traits AllocT = malloc_traits>
+	class basic_array
+	{
+		static_assert(alignof(T) <= default_allocation_alignment, "T must not be over-aligned");
+		static_assert(std::is_nothrow_destructible_v<T>, "T must be nothrow destructible");
+
+	public:
+		using allocator = allocator<AllocT>;
+		using value_type = T;
+		using size_type = std::size_t;
+		using iterator = T*;
+		using const_iterator = T const*;
+
+		/// <summary>True if elements are relocated by reallocating the storage.</summary>
+		static constexpr bool relocates_trivially = is_trivially_relocatable_v<T>;
+
+		/// <summary>Constructs an empty array.</summary>
+		basic_array() noexcept :
+			mData(nullptr), mSize(0), mCapacity(0)
+		{
+		}
+
+		/// <summary>Constructs an array of <paramref name="Count"/> value-initialised elements.</summary>
+		explicit basic_array(std::size_t const Count) :
+			basic_array()
+		{
+			resize(Count);
+		}
+
+		/// <summary>Constructs an array of <paramref name="Count"/> copies of <paramref name="Value"/>.</summary>
+		basic_array(std::size_t const Count, T const& Value) :
+			basic_array()
+		{
+			resize(Count, Value);
+		}
+
+		/// <summary>Constructs an array which contains copies of the elements of <paramref name="Init"/>.</summary>
+		basic_array(std::initializer_list<T> const Init) :
+			basic_array()
+		{
+			append(Init.begin(), Init.size());
+		}
+
+		/// <summary>Constructs an array by copying the elements of <paramref name="Other"/>.</summary>
+		basic_array(basic_array const& Other) :
+			basic_array()
+		{
+			append(Other.mData, Other.mSize);
+		}
+
+		/// <summary>Constructs an array by moving the storage of <paramref name="Other"/>. <paramref name="Other"/> is left empty.</summary>
+		basic_array(basic_array&& Other) noexcept :
+			mData(std::exchange(Other.mData, nullptr)),
+			mSize(std::exchange(Other.mSize, 0)),
+			mCapacity(std::exchange(Other.mCapacity, 0))
+		{
+		}
+
+		~basic_array()
+		{
+			clear();
+			allocator::deallocate(mData);
+		}
+
+		basic_array& operator=(basic_array const& Other)
+		{
+			if (this != &Other)
+			{
+				basic_array(Other).swap(*this);
+			}
+			return *this;
+		}
+
+		basic_array& operator=(basic_array&& Other) noexcept
+		{
+			basic_array(std::move(Other)).swap(*this);
+			return *this;
+		}
+
+		void swap(basic_array& Other) noexcept
+		{
+			std::swap(mData, Other.mData);
+			std::swap(mSize, Other.mSize);
+			std::swap(mCapacity, Other.mCapacity);
+		}
+
+		[[nodiscard]] T* data() noexcept { return mData; }
+		[[nodiscard]] T const* data() const noexcept { return mData; }
+
+		/// <returns>The number of elements in the array.</returns>
+		[[nodiscard]] std::size_t size() const noexcept { return mSize; }
+
+		/// <returns>The number of elements the array can hold without growing its storage.</returns>
+		[[nodiscard]] std::size_t capacity() const noexcept { return mCapacity; }
+
+		/// <returns><c>true</c> if and only if the array has no elements.</returns>
+		[[nodiscard]] bool empty() const noexcept { return mSize == 0; }
+
+		[[nodiscard]] iterator begin() noexcept { return mData; }
+		[[nodiscard]] const_iterator begin() const noexcept { return mData; }
+		[[nodiscard]] iterator end() noexcept { return mData + mSize; }
+		[[nodiscard]] const_iterator end() const noexcept { return mData + mSize; }
+
+		[[nodiscard]] T& operator[](std::size_t const Index) noexcept
+		{
+			WDUL_ASSERT(Index < mSize);
+			return mData[Index];
+		}
+
+		[[nodiscard]] T const& operator[](std::size_t const Index) const noexcept
+		{
+			WDUL_ASSERT(Index < mSize);
+			return mData[Index];
+		}
+
+		[[nodiscard]] T& front() noexcept { return (*this)[0]; }
+		[[nodiscard]] T const& front() const noexcept { return (*this)[0]; }
+		[[nodiscard]] T& back() noexcept { return (*this)[mSize - 1]; }
+		[[nodiscard]] T const& back() const noexcept { return (*this)[mSize - 1]; }
+
+		/// <summary>
+		/// Ensures the array can hold at least <paramref name="Capacity"/> elements without growing its storage.
+		/// If <paramref name="Capacity"/> is not greater than the current capacity, the function does nothing.
+		/// </summary>
+		void reserve(std::size_t const Capacity)
+		{
+			if (Capacity > mCapacity)
+			{
+				set_capacity(Capacity);
+			}
+		}
+
+		/// <summary>
+		/// Changes the number of elements to <paramref name="Count"/>. New elements are value-initialised; excess elements are
+		/// destroyed.
+		/// </summary>
+		void resize(std::size_t const Count)
+		{
+			if (Count > mSize)
+			{
+				if (Count > mCapacity)
+				{
+					grow(Count);
+				}
+				std::uninitialized_value_construct(mData + mSize, mData + Count);
+				mSize = Count;
+			}
+			else
+			{
+				shrink(Count);
+			}
+		}
+
+		/// <summary>
+		/// Changes the number of elements to <paramref name="Count"/>. New elements are copies of <paramref name="Value"/>; excess
+		/// elements are destroyed.
+		/// </summary>
+		void resize(std::size_t const Count, T const& Value)
+		{
+			if (Count > mSize)
+			{
+				if (Count > mCapacity)
+				{
+					// Value may refer to an element of this array, which growing the storage would invalidate.
+					T const copy(Value);
+					grow(Count);
+					std::uninitialized_fill(mData + mSize, mData + Count, copy);
+				}
+				else
+				{
+					std::uninitialized_fill(mData + mSize, mData + Count, Value);
+				}
+				mSize = Count;
+			}
+			else
+			{
+				shrink(Count);
+			}
+		}
+
+		/// <summary>Constructs an element at the end of the array from <paramref name="Args"/>.</summary>
+		/// <returns>A reference to the new element.</returns>
+		template <class... ArgsT>
+		T& emplace_back(ArgsT&&... Args)
+		{
+			if (mSize == mCapacity)
+			{
+				// The arguments may refer to elements of this array, which growing the storage would invalidate, so construct the
+				// element before growing.
+				T value(std::forward<ArgsT>(Args)...);
+				grow(mSize + 1);
+				std::construct_at(mData + mSize, std::move(value));
+			}
+			else
+			{
+				std::construct_at(mData + mSize, std::forward<ArgsT>(Args)...);
+			}
+			return mData[mSize++];
+		}
+
+		void push_back(T const& Value)
+		{
+			emplace_back(Value);
+		}
+
+		void push_back(T&& Value)
+		{
+			emplace_back(std::move(Value));
+		}
+
+		/// <summary>Destroys the last element. The array must not be empty.</summary>
+		void pop_back() noexcept
+		{
+			WDUL_ASSERT(mSize != 0);
+			std::destroy_at(mData + --mSize);
+		}
+
+		/// <summary>Appends copies of the <paramref name="Count"/> elements pointed to by <paramref name="Data"/>.</summary>
+		void append(_In_reads_(Count) T const* const Data, std::size_t const Count)
+		{
+			if (Count == 0)
+			{
+				return;
+			}
+			auto src = Data;
+			if (Count > mCapacity - mSize)
+			{
+				if (mSize > (std::numeric_limits<std::size_t>::max)() - Count)
+				{
+					throw std::bad_array_new_length();
+				}
+				if (Data >= mData && Data < mData + mSize)
+				{
+					// Data points into this array, which growing the storage will move.
+					auto const offset = Data - mData;
+					grow(mSize + Count);
+					src = mData + offset;
+				}
+				else
+				{
+					grow(mSize + Count);
+				}
+			}
+			std::uninitialized_copy_n(src, Count, mData + mSize);
+			mSize += Count;
+		}
+
+		/// <summary>Destroys every element. The capacity is unchanged.</summary>
+		void clear() noexcept
+		{
+			shrink(0);
+		}
+
+		/// <summary>Reduces the capacity to the number of elements.</summary>
+		void shrink_to_fit()
+		{
+			if (mCapacity == mSize)
+			{
+				return;
+			}
+			if (mSize == 0)
+			{
+				allocator::deallocate(mData);
+				mData = nullptr;
+				mCapacity = 0;
+				return;
+			}
+			set_capacity(mSize);
+		}
+
+	private:
+		void shrink(std::size_t const Count) noexcept
+		{
+			WDUL_ASSERT(Count <= mSize);
+			std::destroy(mData + Count, mData + mSize);
+			mSize = Count;
+		}
+
+		// Increases the capacity to at least MinCapacity, growing geometrically.
+		void grow(std::size_t const MinCapacity)
+		{
+			auto const geometric = mCapacity + mCapacity / 2;
+			set_capacity((std::max)(MinCapacity, geometric < mCapacity ? MinCapacity : geometric));
+		}
+
+		// Sets the capacity to exactly Capacity, which must be non-zero and not less than the size.
+		void set_capacity(std::size_t const Capacity)
+		{
+			WDUL_ASSERT(Capacity != 0 && Capacity >= mSize);
+			auto const bytes = sizeof_n<T>(Capacity);
+			if constexpr (relocates_trivially)
+			{
+				if (!mData || !allocator::expand(mData, bytes))
+				{
+					auto const p = allocator::reallocate(mData, bytes);
+					if (!p)
+					{
+						throw std::bad_alloc();
+					}
+					mData = static_cast<T*>(p);
+				}
+			}
+			else
+			{
+				auto const p = static_cast<T*>(allocator::allocate(bytes));
+				if (!p)
+				{
+					throw std::bad_alloc();
+				}
+				if constexpr (std::is_nothrow_move_constructible_v<T> || !std::is_copy_constructible_v<T>)
+				{
+					// A move-only type may have a throwing move constructor, in which case the elements already moved are destroyed
+					// by uninitialized_move_n, but the new storage must still be freed.
+					try
+					{
+						std::uninitialized_move_n(mData, mSize, p);
+					}
+					catch (...)
+					{
+						allocator::deallocate(p);
+						throw;
+					}
+				}
+				else
+				{
+					try
+					{
+						std::uninitialized_copy_n(mData, mSize, p);
+					}
+					catch (...)
+					{
+						allocator::deallocate(p);
+						throw;
+					}
+				}
+				std::destroy_n(mData, mSize);
+				allocator::deallocate(mData);
+				mData = p;
+			}
+			mCapacity = Capacity;
+		}
+
+		T* mData;
+		std::size_t mSize;
+		std::size_t mCapacity;
+	};
+
+	template <class T, allocate_traits AllocT>
+	void swap(basic_array<T, AllocT>& Lhs, basic_array<T, AllocT>& Rhs) noexcept
+	{
+		Lhs.swap(Rhs);
+	}
+}
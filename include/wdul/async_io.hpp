@@ -0,0 +1,157 @@
+// This file is part of the WillDaisey/WDUL (Windows Desktop Utility Library) project.
+// View this project on github: https://github.com/WillDaisey/wdul/
+
+#pragma once
+#include "handle.hpp"
+#include <atomic>
+#include <span>
+
+namespace wdul
+{
+	// The operation performed by an asynchronous I/O request.
+	enum class async_io_operation : std::uint8_t
+	{
+		read,
+		write,
+	};
+
+	struct async_io_completion;
+
+	// Called on the thread which dequeues the completion of a request. Must not throw.
+	using async_io_callback = void(*)(async_io_completion const& Completion);
+
+	// Describes a positional read or write, for submission to an async_io_engine.
+	struct async_io_request
+	{
+		// The file to read or write. Must have been opened with FILE_FLAG_OVERLAPPED and attached to the engine.
+		HANDLE file;
+
+		async_io_operation operation;
+
+		// The offset within the file, in bytes, at which to begin. The file pointer is neither used nor moved. If the file was
+		// opened with FILE_FLAG_NO_BUFFERING, the offset, size and buffer address must be multiples of the volume sector size.
+		std::uint64_t offset;
+
+		// The buffer to read into or write from. Must remain valid until the request completes.
+		void* buffer;
+
+		// The number of bytes to read or write.
+		std::uint32_t size;
+
+		// If not nullptr, called when the request completes.
+		async_io_callback callback = nullptr;
+
+		// Not used by the engine. Available to the callback and to the consumer of the completion.
+		void* context = nullptr;
+	};
+
+	// Describes the outcome of an asynchronous I/O request.
+	struct async_io_completion
+	{
+		// The request which completed.
+		async_io_request request;
+
+		// ERROR_SUCCESS if the request succeeded, otherwise a Win32 error code. A read which begins at or beyond the end of the
+		// file fails with ERROR_HANDLE_EOF. A read which reaches the end of the file succeeds with fewer bytes than requested.
+		std::uint32_t error;
+
+		// The number of bytes read or written.
+		std::uint32_t bytes_transferred;
+	};
+
+	/// <summary>
+	/// Performs positional reads and writes asynchronously through an I/O completion port, so that the threads which submit
+	/// requests are not blocked by storage latency.
+	/// <para>
+	/// Any number of requests, for any number of files, may be in flight at once. Requests are submitted individually or in
+	/// batches from any thread. Completions are dequeued in batches by any thread which calls <c>wait</c>, <c>dispatch</c> or
+	/// <c>drain</c>; typically, one or more worker threads call <c>dispatch</c> in a loop. Requests may complete in any order.
+	/// </para>
+	/// <para>
+	/// A request which fails immediately is completed through the port like any other, so every request submitted is completed
+	/// exactly once.
+	/// </para>
+	/// </summary>
+	class async_io_engine
+	{
+	public:
+		async_io_engine(async_io_engine const&) = delete;
+		async_io_engine& operator=(async_io_engine const&) = delete;
+
+		/// <summary>Creates an I/O completion port. Throws an exception on failure.</summary>
+		/// <param name="ConcurrentThreads">
+		/// The maximum number of threads the system allows to process completions concurrently, or zero for as many threads as
+		/// there are processors.
+		/// </param>
+		explicit async_io_engine(std::uint32_t const ConcurrentThreads = 0);
+
+		/// <summary>Waits for every request in flight to complete, invoking callbacks, then closes the completion port.</summary>
+		~async_io_engine();
+
+		/// <summary>
+		/// Associates a file with the engine, so that requests for it can be submitted. The file must have been opened with
+		/// <c>FILE_FLAG_OVERLAPPED</c>, and must not be closed while requests for it are in flight. A file can only be associated
+		/// with one engine. Throws an exception on failure.
+		/// </summary>
+		void attach(_In_ HANDLE const File);
+
+		/// <summary>Submits a request. Throws an exception if the request cannot be submitted.</summary>
+		void submit(async_io_request const& Request)
+		{
+			submit({ &Request, 1 });
+		}
+
+		/// <summary>
+		/// Submits a batch of requests, in order. Storage for every request is allocated before any is issued, so an allocation
+		/// failure leaves no request submitted. Throws an exception if the completion of a request which failed immediately
+		/// cannot be queued; the requests before it remain submitted, and are completed as usual, but it and the requests after it
+		/// are not submitted.
+		/// </summary>
+		/// <param name="Submitted">
+		/// Optional pointer to a variable which receives the number of requests submitted, even if an exception is thrown.
+		/// </param>
+		void submit(std::span<async_io_request const> const Requests, _Out_opt_ std::size_t* const Submitted = nullptr);
+
+		/// <summary>
+		/// Dequeues up to <c>Completions.size()</c> completions, waiting for at least one for up to <paramref name="Milliseconds"/>
+		/// milliseconds. The callback of each request which has one is invoked before the function returns. Throws an exception
+		/// on failure.
+		/// </summary>
+		/// <returns>The number of completions written to <paramref name="Completions"/>. Zero if the wait timed out.</returns>
+		std::size_t wait(std::span<async_io_completion> const Completions, std::uint32_t const Milliseconds = INFINITE);
+
+		/// <summary>Same as <c>wait</c>, except the function does not wait.</summary>
+		std::size_t poll(std::span<async_io_completion> const Completions)
+		{
+			return wait(Completions, 0);
+		}
+
+		/// <summary>
+		/// Dequeues a batch of completions, waiting for at least one for up to <paramref name="Milliseconds"/> milliseconds, and
+		/// invokes the callback of each request which has one.
+		/// </summary>
+		/// <returns>The number of requests completed. Zero if the wait timed out.</returns>
+		std::size_t dispatch(std::uint32_t const Milliseconds = INFINITE);
+
+		/// <summary>
+		/// Dispatches completions until no requests are in flight. Must not be called while another thread dequeues completions,
+		/// since the last completion could be dequeued by that thread, leaving this one waiting indefinitely.
+		/// </summary>
+		void drain();
+
+		/// <returns>The number of requests which have been submitted, but whose completion has not been dequeued.</returns>
+		[[nodiscard]] std::size_t in_flight() const noexcept { return mInFlight.load(std::memory_order_acquire); }
+
+		/// <returns>The I/O completion port.</returns>
+		[[nodiscard]] HANDLE port() const noexcept { return mPort.get(); }
+
+	private:
+		struct request_node;
+
+		// Completes the request of Entry, writing its completion to Completion, and returns the completion's callback.
+		async_io_callback complete(OVERLAPPED_ENTRY const& Entry, async_io_completion& Completion) noexcept;
+
+		generic_handle<invalid_handle_type::null> mPort;
+		std::atomic<std::size_t> mInFlight;
+	};
+}
@@ -0,0 +1,525 @@
+// This file is part of the WillDaisey/WDUL (Windows Desktop Utility Library) project.
+// View this project on github: https://github.com/WillDaisey/wdul/
+
+#pragma once
+#include "fs.hpp"
+#include "parse.hpp"
+#include "stream.hpp"
+#include <memory>
+#include <utility>
+
+namespace wdul
+{
+	/// <summary>
+	/// Reads a file through a large, refillable buffer. Reads of any size, including reads of delimited strings such as lines,
+	/// are served from the buffer, so the file is only read when the buffer runs out, and the file pointer never needs to move
+	/// backwards.
+	/// <para>
+	/// The reader can also read any <c>byte_source</c>; see <c>attach</c>. The bytes of a borrowable source, such as a
+	/// <c>memory_source</c> or <c>mapped_source</c>, are read in place rather than copied into the buffer.
+	/// </para>
+	/// <para>
+	/// The reader tracks its own position in the file, and reads with <c>fread_at</c>, so the file pointer is never used. Use
+	/// <c>position</c> and <c>seek</c> rather than <c>fgetpos</c> and <c>fsetpos</c>. Seeking within the buffered bytes does not
+	/// read the file. Since the file pointer is not shared, any number of readers on any number of threads may read the same
+	/// handle at once; see <c>share</c>. The reads proceed in parallel only if the handle was opened with
+	/// <c>FILE_FLAG_OVERLAPPED</c>; otherwise the system serializes them.
+	/// </para>
+	/// </summary>
+	class buffered_file_reader
+	{
+	public:
+		/// <summary>The default size of the buffer, in bytes.</summary>
+		static constexpr std::size_t default_buffer_size = std::size_t(64) << 10;
+
+		buffered_file_reader(buffered_file_reader const&) = delete;
+		buffered_file_reader& operator=(buffered_file_reader const&) = delete;
+
+		/// <summary>Constructs a reader which has no file. No buffer is allocated until a file is opened or attached.</summary>
+		buffered_file_reader() noexcept :
+			mSource(nullptr),
+			mData(nullptr),
+			mCursor(0),
+			mEnd(0),
+			mBufferPos(0)
+		{
+		}
+
+		/// <summary>Constructs a reader which takes ownership of <paramref name="File"/>, and reads from its current position.</summary>
+		/// <param name="File">A file opened with read access.</param>
+		/// <param name="BufferSize">The size of the buffer, in bytes. Must be non-zero.</param>
+		explicit buffered_file_reader(file_handle File, std::size_t const BufferSize = default_buffer_size);
+
+		buffered_file_reader(buffered_file_reader&& Other) noexcept :
+			mFileSource(std::move(Other.mFileSource)),
+			mSource(std::exchange(Other.mSource, nullptr)),
+			mBuffer(std::move(Other.mBuffer)),
+			mData(std::exchange(Other.mData, nullptr)),
+			mCursor(std::exchange(Other.mCursor, 0)),
+			mEnd(std::exchange(Other.mEnd, 0)),
+			mBufferPos(std::exchange(Other.mBufferPos, 0))
+		{
+			fixup(Other);
+		}
+
+		buffered_file_reader& operator=(buffered_file_reader&& Other) noexcept
+		{
+			buffered_file_reader(std::move(Other)).swap(*this);
+			return *this;
+		}
+
+		void swap(buffered_file_reader& Other) noexcept
+		{
+			mFileSource.swap(Other.mFileSource);
+			std::swap(mSource, Other.mSource);
+			mBuffer.swap(Other.mBuffer);
+			std::swap(mData, Other.mData);
+			std::swap(mCursor, Other.mCursor);
+			std::swap(mEnd, Other.mEnd);
+			std::swap(mBufferPos, Other.mBufferPos);
+			fixup(Other);
+			Other.fixup(*this);
+		}
+
+		/// <summary>Opens the specified file for reading. If a file is already open, it is closed first.</summary>
+		/// <param name="Filename">Pointer to a null-terminated UTF-16 string which contains the name of the file to open.</param>
+		/// <param name="BufferSize">The size of the buffer, in bytes. Must be non-zero.</param>
+		/// <returns>
+		/// One of the following values:<para/>
+		/// <c>fopen_code::success</c><para/>
+		/// <c>fopen_code::not_found</c><para/>
+		/// <c>fopen_code::access_denied</c><para/>
+		/// <c>fopen_code::in_use</c>
+		/// </returns>
+		[[nodiscard]] fopen_code open(_In_z_ wchar_t const* const Filename, std::size_t const BufferSize = default_buffer_size);
+
+		/// <summary>
+		/// Reads a file which the reader does not own, such as one shared with other readers. If a file is already open, it is
+		/// closed first.
+		/// </summary>
+		/// <param name="File">
+		/// A file opened with read access, with or without <c>FILE_FLAG_OVERLAPPED</c>. Must not be associated with an I/O
+		/// completion port, and must remain open until the reader is closed.
+		/// </param>
+		/// <param name="Position">The position of the first byte to read, relative to the start of the file.</param>
+		/// <param name="BufferSize">The size of the buffer, in bytes. Must be non-zero.</param>
+		void share(_In_ HANDLE const File, std::int64_t const Position = 0, std::size_t const BufferSize = default_buffer_size);
+
+		/// <summary>
+		/// Reads a <c>byte_source</c>, from its current position. If a file is already open, it is closed first. If the source is
+		/// borrowable, its bytes are read in place, and the buffer is only used to join a delimiter split between two borrowed
+		/// ranges. <c>seek</c> outside the buffered bytes requires a seekable source.
+		/// </summary>
+		/// <param name="Source">The source. Must remain valid until the reader is closed.</param>
+		/// <param name="BufferSize">The size of the buffer, in bytes. Must be non-zero.</param>
+		void attach(byte_source& Source, std::size_t const BufferSize = default_buffer_size);
+
+		/// <summary>
+		/// Closes the file, unless it is shared or attached, and discards the buffered bytes. The buffer is kept for reuse.
+		/// </summary>
+		void close() noexcept;
+
+		/// <returns><c>true</c> if and only if the reader has a file or source.</returns>
+		[[nodiscard]] bool is_open() const noexcept { return mSource != nullptr; }
+
+		/// <returns>The file handle, or nullptr if the reader is attached to a source. The reader does not use the file pointer.</returns>
+		[[nodiscard]] HANDLE file() const noexcept { return mFileSource.file(); }
+
+		/// <returns>The source read from, or nullptr if the reader has no file or source.</returns>
+		[[nodiscard]] byte_source* source() const noexcept { return mSource; }
+
+		/// <returns>The position of the next byte the reader will return, relative to the start of the file.</returns>
+		[[nodiscard]] std::int64_t position() const noexcept
+		{
+			return mBufferPos + static_cast<std::int64_t>(mCursor);
+		}
+
+		/// <summary>
+		/// Sets the position of the next byte the reader will return, relative to the start of the file. If the position is within
+		/// the buffered bytes, the file is not accessed.
+		/// </summary>
+		void seek(std::int64_t const Position);
+
+		/// <summary>Reads up to <paramref name="Size"/> bytes into <paramref name="Buffer"/>.</summary>
+		/// <returns>The number of bytes read, which is less than <paramref name="Size"/> only at the end of the file.</returns>
+		std::size_t read(_Out_writes_bytes_to_(Size, return) void* const Buffer, std::size_t const Size);
+
+		/// <summary>
+		/// Reads characters until the delimiter specified by the range [<paramref name="Delim"/>, <paramref name="Delim"/> +
+		/// <paramref name="DelimSize"/>) is found, or the end of the file is reached. The reader is positioned after the delimiter.
+		/// <paramref name="DelimSize"/> must be non-zero and not greater than the size of the buffer.
+		/// </summary>
+		/// <returns>The number of bytes consumed, including the delimiter. Zero only at the end of the file.</returns>
+		std::int64_t read_delimited(_In_range_(> , 0) std::size_t const DelimSize, _In_reads_(DelimSize) char8_t const* const Delim)
+		{
+			return read_delimitx(DelimSize, Delim, [](char8_t const*, char8_t const*) {});
+		}
+
+		/// <summary>
+		/// Same as the other overload, except the characters read before the delimiter are appended to <paramref name="Output"/>.
+		/// </summary>
+		/// <typeparam name="StringT">A string of <c>char8_t</c>, such as <c>std::u8string</c> or <c>std::pmr::u8string</c>.</typeparam>
+		template <class StringT>
+		std::int64_t read_delimited_consecutive(_In_range_(> , 0) std::size_t const DelimSize, _In_reads_(DelimSize) char8_t const* const Delim,
+			StringT& Output)
+		{
+			return read_delimitx(DelimSize, Delim, [&Output](char8_t const* const First, char8_t const* const Last)
+				{
+					Output.append(First, Last);
+				});
+		}
+
+		/// <summary>Calls <c>Output.clear()</c>, followed by <c>read_delimited_consecutive</c>.</summary>
+		template <class StringT>
+		std::int64_t read_delimited(_In_range_(> , 0) std::size_t const DelimSize, _In_reads_(DelimSize) char8_t const* const Delim,
+			StringT& Output)
+		{
+			Output.clear();
+			return read_delimited_consecutive(DelimSize, Delim, Output);
+		}
+
+		/// <summary>
+		/// Reads characters until any of the delimiters in <paramref name="Delims"/> is found, or the end of the file is reached.
+		/// The reader is positioned after the delimiter. See <c>delimiter_set_matcher</c> for which delimiter is found when several
+		/// match. The longest delimiter must not be longer than the buffer.
+		/// </summary>
+		/// <param name="Found">
+		/// If not nullptr, receives the index of the delimiter found, or <c>delimiter_set::npos</c> if the end of the file was
+		/// reached first.
+		/// </param>
+		/// <returns>The number of bytes consumed, including the delimiter. Zero only at the end of the file.</returns>
+		std::int64_t read_delimited(delimiter_set const& Delims, _Out_opt_ std::size_t* const Found = nullptr)
+		{
+			return read_delimitx(Delims, [](char8_t const*, char8_t const*) {}, Found);
+		}
+
+		/// <summary>
+		/// Same as the other overload, except the characters read before the delimiter are appended to <paramref name="Output"/>.
+		/// </summary>
+		template <class StringT>
+		std::int64_t read_delimited_consecutive(delimiter_set const& Delims, StringT& Output, _Out_opt_ std::size_t* const Found = nullptr)
+		{
+			return read_delimitx(Delims, [&Output](char8_t const* const First, char8_t const* const Last)
+				{
+					Output.append(First, Last);
+				}, Found);
+		}
+
+		/// <summary>Calls <c>Output.clear()</c>, followed by <c>read_delimited_consecutive</c>.</summary>
+		template <class StringT>
+		std::int64_t read_delimited(delimiter_set const& Delims, StringT& Output, _Out_opt_ std::size_t* const Found = nullptr)
+		{
+			Output.clear();
+			return read_delimited_consecutive(Delims, Output, Found);
+		}
+
+		/// <summary>
+		/// Reads characters to <paramref name="Output"/> until a new line is found, or the end of the file is reached.
+		/// The characters which make up the new line are not included in <paramref name="Output"/>. See <c>freadline</c>.
+		/// </summary>
+		/// <param name="Mode">Specifies which character sequences are new lines.</param>
+		/// <returns>The number of bytes consumed, including the new line. Zero only at the end of the file.</returns>
+		template <class StringT>
+		std::int64_t readline(StringT& Output, newline_mode const Mode = newline_mode::crlf)
+		{
+			if (Mode == newline_mode::any)
+			{
+				return read_delimited(newline_delimiters(), Output);
+			}
+			char8_t const delimiter[] = { u8'\r', u8'\n' };
+			return read_delimited(sizeof(delimiter), delimiter, Output);
+		}
+
+	private:
+		// Makes the bytes which follow the buffered bytes available. If every buffered byte has been consumed and the source is
+		// borrowable, the next bytes are borrowed. Otherwise, the unconsumed bytes are moved to the start of the buffer, and the
+		// source is read into the free space after them. Returns the number of new bytes, which is zero only at the end of the
+		// file.
+		std::size_t refill();
+
+		// Redirects mSource to this reader's file_source if it referred to Other's.
+		void fixup(buffered_file_reader const& Other) noexcept
+		{
+			if (mSource == &Other.mFileSource)
+			{
+				mSource = &mFileSource;
+			}
+		}
+
+		// Consumes characters until the delimiter is found or the end of the file is reached, passing each run of characters
+		// which precede the delimiter to Sink.
+		template <class SinkT>
+		std::int64_t read_delimitx(std::size_t const DelimSize, char8_t const* const Delim, SinkT&& Sink)
+		{
+			WDUL_ASSERT(DelimSize != 0 && Delim != nullptr);
+			WDUL_ASSERT(DelimSize <= mBuffer.size());
+
+			auto const start = position();
+			delimiter_matcher matcher({ .first = Delim, .last = Delim + DelimSize });
+
+			// The offset within the buffer of the first byte not yet given to the matcher.
+			auto fed = mCursor;
+			for (;;)
+			{
+				auto const data = reinterpret_cast<char8_t const*>(mData);
+				if (auto const matchLast = matcher.feed({ .first = data + fed, .last = data + mEnd }))
+				{
+					Sink(data + mCursor, matchLast - DelimSize);
+					mCursor = static_cast<std::size_t>(matchLast - data);
+					return position() - start;
+				}
+
+				// Keep the partially matched bytes buffered, so that they can be excluded from the output if the delimiter is
+				// completed by the next refill.
+				auto const keep = mEnd - matcher.matched();
+				Sink(data + mCursor, data + keep);
+				mCursor = keep;
+				if (refill() == 0)
+				{
+					// The end of the file was reached. A partial match at the end of the file is not a delimiter. The refill may have
+					// moved the bytes, so data is not used.
+					Sink(reinterpret_cast<char8_t const*>(mData) + mCursor, reinterpret_cast<char8_t const*>(mData) + mEnd);
+					mCursor = mEnd;
+					return position() - start;
+				}
+
+				// The refill moved the partially matched bytes to the start of the buffer.
+				fed = matcher.matched();
+			}
+		}
+
+		// Same as the other overload, except the search is for any of the delimiters in Delims.
+		template <class SinkT>
+		std::int64_t read_delimitx(delimiter_set const& Delims, SinkT&& Sink, std::size_t* const Found)
+		{
+			WDUL_ASSERT(Delims.max_size() <= mBuffer.size());
+
+			auto const start = position();
+			delimiter_set_matcher matcher(Delims);
+
+			// The offset within the buffer of the first character of the stream given to the matcher. It becomes negative once
+			// the start of the stream has been consumed and moved out of the buffer by a refill.
+			auto origin = static_cast<std::ptrdiff_t>(mCursor);
+			auto const at = [this, &origin](std::uint64_t const Offset) noexcept
+			{
+				return reinterpret_cast<char8_t const*>(mData) + (origin + static_cast<std::ptrdiff_t>(Offset));
+			};
+
+			delimiter_set_match match;
+			for (;;)
+			{
+				auto const data = reinterpret_cast<char8_t const*>(mData);
+				if (matcher.feed({ .first = at(matcher.position()), .last = data + mEnd }, match))
+				{
+					break;
+				}
+
+				// Keep the characters which may be part of a match buffered, so that they can be excluded from the output, and so
+				// that the matcher can rewind to the end of the match.
+				auto const keep = mEnd - matcher.pending();
+				Sink(data + mCursor, data + keep);
+				mCursor = keep;
+
+				// The refill moves the buffered characters to the start of the buffer.
+				auto const compacted = static_cast<std::ptrdiff_t>(mCursor);
+				auto const bytesRead = refill();
+				origin -= compacted;
+				if (bytesRead == 0)
+				{
+					// The end of the file was reached.
+					if (matcher.finish(match))
+					{
+						break;
+					}
+					Sink(reinterpret_cast<char8_t const*>(mData) + mCursor, reinterpret_cast<char8_t const*>(mData) + mEnd);
+					mCursor = mEnd;
+					if (Found) *Found = delimiter_set::npos;
+					return position() - start;
+				}
+			}
+
+			Sink(reinterpret_cast<char8_t const*>(mData) + mCursor, at(match.first));
+			mCursor = static_cast<std::size_t>(origin + static_cast<std::ptrdiff_t>(match.last));
+			if (Found) *Found = match.delimiter;
+			return position() - start;
+		}
+
+		// Reads the file opened by open or shared by share.
+		file_source mFileSource;
+
+		// The source read from: either mFileSource, or a source passed to attach.
+		byte_source* mSource;
+
+		byte_array mBuffer;
+
+		// The buffered bytes: either mBuffer, or bytes borrowed from the source.
+		std::uint8_t const* mData;
+
+		// The offset within the buffered bytes of the next byte to return.
+		std::size_t mCursor;
+
+		// The number of buffered bytes.
+		std::size_t mEnd;
+
+		// The position within the file of the first buffered byte.
+		std::int64_t mBufferPos;
+	};
+
+	inline void swap(buffered_file_reader& Lhs, buffered_file_reader& Rhs) noexcept
+	{
+		Lhs.swap(Rhs);
+	}
+
+	namespace impl
+	{
+		// The background thread and spare buffer of a buffered_file_writer with write-behind enabled.
+		class write_behind;
+	}
+
+	/// <summary>
+	/// Writes a file through a buffer, so that many small writes are coalesced into few large ones. Bytes are written to the
+	/// file in blocks the size of the buffer, at offsets which are multiples of the buffer size, and writes at least as large as
+	/// the buffer bypass it.
+	/// <para>
+	/// With write-behind enabled, a background thread writes each full block while the caller fills a second buffer, so the
+	/// caller only waits for the file if it fills the second buffer before the first is written.
+	/// </para>
+	/// <para>
+	/// The writer tracks its own position in the file, and writes with <c>fwrite_at</c>, so the file pointer is never used.
+	/// Buffered bytes are not written to the file until a block fills, or <c>flush</c>, <c>sync</c> or <c>close</c> is called.
+	/// <c>flush</c> hands the buffered bytes to the system, after which they are visible to other readers of the file and survive
+	/// the termination of the process. <c>sync</c> also waits for the storage device to store them, after which they survive a
+	/// power failure.
+	/// </para>
+	/// </summary>
+	class buffered_file_writer : public byte_sink
+	{
+	public:
+		/// <summary>The default size of the buffer, in bytes.</summary>
+		static constexpr std::size_t default_buffer_size = std::size_t(64) << 10;
+
+		/// <summary>The alignment of the buffer. The size of the buffer is rounded up to a multiple of this value.</summary>
+		static constexpr std::size_t buffer_alignment = 4096;
+
+		using buffer_type = aligned_byte_array<buffer_alignment>;
+
+		buffered_file_writer(buffered_file_writer const&) = delete;
+		buffered_file_writer& operator=(buffered_file_writer const&) = delete;
+
+		/// <summary>Constructs a writer which has no file. No buffer is allocated until a file is opened or attached.</summary>
+		buffered_file_writer() noexcept;
+
+		/// <summary>Constructs a writer which takes ownership of <paramref name="File"/>, and writes from its current position.</summary>
+		/// <param name="File">A file opened with write access and without <c>FILE_FLAG_OVERLAPPED</c>.</param>
+		/// <param name="BufferSize">The size of the buffer, in bytes. Must be non-zero.</param>
+		/// <param name="WriteBehind">If true, full blocks are written by a background thread.</param>
+		explicit buffered_file_writer(file_handle File, std::size_t const BufferSize = default_buffer_size, bool const WriteBehind = false);
+
+		buffered_file_writer(buffered_file_writer&& Other) noexcept;
+		buffered_file_writer& operator=(buffered_file_writer&& Other) noexcept;
+
+		/// <summary>
+		/// Writes the buffered bytes and closes the file. Failures are ignored; call <c>close</c> first to observe them.
+		/// </summary>
+		~buffered_file_writer();
+
+		void swap(buffered_file_writer& Other) noexcept
+		{
+			mFile.swap(Other.mFile);
+			mBuffer.swap(Other.mBuffer);
+			std::swap(mSize, Other.mSize);
+			std::swap(mLimit, Other.mLimit);
+			std::swap(mBlockPos, Other.mBlockPos);
+			mWriteBehind.swap(Other.mWriteBehind);
+		}
+
+		/// <summary>
+		/// Opens the specified file for writing. If a file is already open, it is closed first. If <paramref name="Mode"/> opens an
+		/// existing file without truncating it, writing begins at the end of the file.
+		/// </summary>
+		/// <param name="Filename">Pointer to a null-terminated UTF-16 string which contains the name of the file to open.</param>
+		/// <param name="Mode">Specifies whether to create or open the file.</param>
+		/// <param name="BufferSize">The size of the buffer, in bytes. Must be non-zero.</param>
+		/// <param name="WriteBehind">If true, full blocks are written by a background thread.</param>
+		/// <returns>
+		/// One of the following values:<para/>
+		/// <c>fopen_code::success</c><para/>
+		/// <c>fopen_code::not_found</c><para/>
+		/// <c>fopen_code::access_denied</c><para/>
+		/// <c>fopen_code::in_use</c><para/>
+		/// <c>fopen_code::already_exists</c>
+		/// </returns>
+		[[nodiscard]] fopen_code open(_In_z_ wchar_t const* const Filename, file_open_mode const Mode = file_open_mode::create_always,
+			std::size_t const BufferSize = default_buffer_size, bool const WriteBehind = false);
+
+		/// <summary>Writes the buffered bytes and closes the file. Throws an exception if the bytes cannot be written.</summary>
+		void close();
+
+		/// <returns><c>true</c> if and only if the writer has a file.</returns>
+		[[nodiscard]] bool is_open() const noexcept { return static_cast<bool>(mFile); }
+
+		/// <returns>The file handle. The writer does not use its file pointer.</returns>
+		[[nodiscard]] HANDLE file() const noexcept { return mFile.get(); }
+
+		/// <returns>The position at which the next byte will be written, relative to the start of the file.</returns>
+		[[nodiscard]] std::uint64_t position() const noexcept { return mBlockPos + mSize; }
+
+		/// <summary>Writes <paramref name="Size"/> bytes from <paramref name="Data"/>.</summary>
+		void write(_In_reads_bytes_(Size) void const* const Data, std::size_t const Size);
+
+		/// <summary>Writes the characters of <paramref name="String"/>.</summary>
+		void write(std::u8string_view const String)
+		{
+			write(String.data(), String.size());
+		}
+
+		/// <summary>Writes every byte of <paramref name="Bytes"/>, so that the writer can be the sink of <c>pump</c>.</summary>
+		void write(std::span<std::uint8_t const> const Bytes) override
+		{
+			write(Bytes.data(), Bytes.size());
+		}
+
+		/// <summary>
+		/// Hands the buffered bytes to the system, and waits for any background write to finish. Throws an exception if the bytes
+		/// cannot be written, including the bytes of an earlier background write.
+		/// </summary>
+		void flush();
+
+		/// <summary>Calls <c>flush</c>, then waits for the storage device to store the file's data. See <c>fsync</c>.</summary>
+		void sync();
+
+		/// <summary>Reserves storage for the file up to <paramref name="Size"/> bytes. See <c>fpreallocate</c>.</summary>
+		void preallocate(std::uint64_t const Size)
+		{
+			WDUL_ASSERT(is_open());
+			fpreallocate(mFile.get(), Size);
+		}
+
+	private:
+		// Allocates the buffer and starts the background thread, if any, for a file at the given position.
+		void start(std::uint64_t const Position, std::size_t const BufferSize, bool const WriteBehind);
+
+		// Writes the buffered bytes, which make up the current block, and begins the next block.
+		void write_block();
+
+		file_handle mFile;
+		buffer_type mBuffer;
+
+		// The number of bytes in the buffer.
+		std::size_t mSize;
+
+		// The number of bytes which fit in the current block. Less than the size of the buffer if the block begins at an offset
+		// which is not a multiple of the size of the buffer, so that the next block does.
+		std::size_t mLimit;
+
+		// The position within the file of the first byte in the buffer.
+		std::uint64_t mBlockPos;
+
+		std::unique_ptr<impl::write_behind> mWriteBehind;
+	};
+
+	inline void swap(buffered_file_writer& Lhs, buffered_file_writer& Rhs) noexcept
+	{
+		Lhs.swap(Rhs);
+	}
+}
@@ -0,0 +1,328 @@
+// This file is part of the WillDaisey/WDUL (Windows Desktop Utility Library) project.
+// View this project on github: https://github.com/WillDaisey/wdul/
+
+#pragma once
+#include "memory.hpp"
+#include <atomic>
+#include <bit>
+#include <string>
+
+namespace wdul
+{
+	// Conceptualises a type which names a group of allocations, such as a subsystem.
+	// Example:
+	//   struct fs_read_buffers_tag { static constexpr char const name[] = "fs read buffers"; };
+	template <class T>
+	concept allocation_tag = requires
+	{
+		{ T::name } -> std::convertible_to<char const*>;
+	};
+
+	// The number of buckets in an allocation size histogram.
+	// Bucket i counts allocations of [2^i, 2^(i+1)) bytes. The last bucket also counts all larger allocations.
+	inline constexpr std::size_t allocation_histogram_buckets = 32;
+
+	// A snapshot of the statistics recorded by counting_alloc_traits.
+	struct allocation_stats
+	{
+		// The number of allocations, excluding reallocations.
+		std::uint64_t allocations;
+
+		// The number of deallocations, excluding reallocations.
+		std::uint64_t deallocations;
+
+		// The number of reallocations and expansions which resized storage without moving it.
+		std::uint64_t in_place_reallocations;
+
+		// The number of reallocations which moved storage.
+		std::uint64_t moving_reallocations;
+
+		// The sum of the sizes of every allocation and reallocation.
+		std::uint64_t total_bytes;
+
+		// The number of bytes currently allocated.
+		std::int64_t live_bytes;
+
+		// The highest value live_bytes has reached.
+		std::int64_t peak_bytes;
+
+		// Histogram of allocation and reallocation sizes. See allocation_histogram_buckets.
+		std::uint64_t size_histogram[allocation_histogram_buckets];
+	};
+
+	// Formats the given statistics as a single line of text.
+	[[nodiscard]] std::string format_allocation_stats(_In_z_ char const* const Name, allocation_stats const& Stats);
+
+	namespace impl
+	{
+		// Counters owned by a single thread. Only the owning thread writes to the counters, so updates do not need atomic
+		// read-modify-write operations; other threads only read them when statistics are collected.
+		//
+		// The exception is the shared counters of a registry, which are used by every thread whose own counters could not be
+		// allocated, and so are updated with atomic read-modify-write operations.
+		struct allocation_counters
+		{
+			allocation_counters* next;
+			std::atomic<bool> in_use;
+			bool shared;
+			std::atomic<std::uint64_t> allocations;
+			std::atomic<std::uint64_t> deallocations;
+			std::atomic<std::uint64_t> in_place_reallocations;
+			std::atomic<std::uint64_t> moving_reallocations;
+			std::atomic<std::uint64_t> total_bytes;
+			std::atomic<std::uint64_t> size_histogram[allocation_histogram_buckets];
+
+			void increase(std::atomic<std::uint64_t>& Counter, std::uint64_t const Amount) const noexcept
+			{
+				if (shared)
+				{
+					Counter.fetch_add(Amount, std::memory_order_relaxed);
+				}
+				else
+				{
+					Counter.store(Counter.load(std::memory_order_relaxed) + Amount, std::memory_order_relaxed);
+				}
+			}
+
+			void record_size(std::size_t const Size) noexcept
+			{
+				increase(total_bytes, Size);
+				auto const bucket = (std::min)(static_cast<std::size_t>(std::bit_width(Size)) - 1, allocation_histogram_buckets - 1);
+				increase(size_histogram[bucket], 1);
+			}
+		};
+
+		// The counters of every thread which has used a given tag.
+		// Counters are never freed; when a thread exits, its counters are released for reuse by another thread.
+		struct allocation_registry
+		{
+			std::atomic<allocation_counters*> head;
+
+			// Used by threads whose own counters could not be allocated. Not in the list which starts at head.
+			allocation_counters shared_counters{ .shared = true };
+			std::atomic<std::int64_t> live_bytes;
+			std::atomic<std::int64_t> peak_bytes;
+
+			void add_live_bytes(std::int64_t const Amount) noexcept
+			{
+				auto const live = live_bytes.fetch_add(Amount, std::memory_order_relaxed) + Amount;
+				auto peak = peak_bytes.load(std::memory_order_relaxed);
+				while (live > peak && !peak_bytes.compare_exchange_weak(peak, live, std::memory_order_relaxed));
+			}
+		};
+
+		// Returns counters for the calling thread to use, reusing released counters where possible. If no counters can be
+		// reused, and memory for new counters cannot be allocated, returns the registry's shared counters.
+		[[nodiscard]] allocation_counters& acquire_allocation_counters(allocation_registry& Registry) noexcept;
+
+		// Sums the counters of every thread.
+		[[nodiscard]] allocation_stats collect_allocation_stats(allocation_registry const& Registry) noexcept;
+
+		class thread_allocation_counters
+		{
+		public:
+			thread_allocation_counters(thread_allocation_counters const&) = delete;
+			thread_allocation_counters& operator=(thread_allocation_counters const&) = delete;
+
+			explicit thread_allocation_counters(allocation_registry& Registry) noexcept :
+				mCounters(acquire_allocation_counters(Registry))
+			{
+			}
+
+			~thread_allocation_counters()
+			{
+				if (!mCounters.shared)
+				{
+					mCounters.in_use.store(false, std::memory_order_release);
+				}
+			}
+
+			[[nodiscard]] allocation_counters& get() const noexcept
+			{
+				return mCounters;
+			}
+
+		private:
+			allocation_counters& mCounters;
+		};
+	}
+
+	// Wraps InnerT, recording statistics about allocations made through it under the tag TagT.
+	//
+	// Each thread records counts in its own counters, which are only summed when statistics are requested with stats().
+	// Live and peak byte counts are shared by every thread using the tag.
+	//
+	// Every block is prefixed by a header of default_allocation_alignment bytes which stores the block's requested size.
+	template <allocate_traits InnerT, allocation_tag TagT>
+	struct counting_alloc_traits
+	{
+		using inner_allocator = allocator<InnerT>;
+
+		[[nodiscard]] static void* allocate(std::size_t const Size)
+		{
+			WDUL_ASSERT(Size != 0);
+			auto const header = inner_allocator::allocate(block_size(Size));
+			if (!header)
+			{
+				return nullptr;
+			}
+			record_allocation(Size);
+			return set_size(header, Size);
+		}
+
+		[[nodiscard]] static void* allocate_zeroed(std::size_t const Size)
+		{
+			WDUL_ASSERT(Size != 0);
+			auto const header = inner_allocator::allocate_zeroed(block_size(Size));
+			if (!header)
+			{
+				return nullptr;
+			}
+			record_allocation(Size);
+			return set_size(header, Size);
+		}
+
+		static void deallocate(void* const Ptr) noexcept
+		{
+			if (!Ptr)
+			{
+				return;
+			}
+			auto const size = get_size(Ptr);
+			auto& counters = thread_counters();
+			counters.increase(counters.deallocations, 1);
+			registry().add_live_bytes(-static_cast<std::int64_t>(size));
+			inner_allocator::deallocate_unchecked(get_header(Ptr));
+		}
+
+		[[nodiscard]] static void* reallocate(void* const Ptr, std::size_t const Size)
+		{
+			if (!Ptr)
+			{
+				return allocate(Size);
+			}
+			auto const oldSize = get_size(Ptr);
+			auto const oldHeader = get_header(Ptr);
+			auto const header = inner_allocator::reallocate(oldHeader, block_size(Size));
+			if (!header)
+			{
+				return nullptr;
+			}
+			record_reallocation(oldSize, Size, header == oldHeader);
+			return set_size(header, Size);
+		}
+
+		[[nodiscard]] static void* reallocate_zeroed(void* const Ptr, std::size_t const Size)
+		{
+			if (!Ptr)
+			{
+				return allocate_zeroed(Size);
+			}
+			auto const oldSize = get_size(Ptr);
+			auto const oldHeader = get_header(Ptr);
+			auto const header = inner_allocator::reallocate_zeroed(oldHeader, block_size(Size));
+			if (!header)
+			{
+				return nullptr;
+			}
+			record_reallocation(oldSize, Size, header == oldHeader);
+			return set_size(header, Size);
+		}
+
+		[[nodiscard]] static void* expand(void* const Ptr, std::size_t const Size) noexcept requires has_expand<InnerT>
+		{
+			WDUL_ASSERT(Size != 0);
+			if (!Ptr || Size > (std::numeric_limits<std::size_t>::max)() - header_size)
+			{
+				return nullptr;
+			}
+			auto const oldSize = get_size(Ptr);
+			if (!InnerT::expand(get_header(Ptr), Size + header_size))
+			{
+				return nullptr;
+			}
+			record_reallocation(oldSize, Size, true);
+			return set_size(get_header(Ptr), Size);
+		}
+
+		[[nodiscard]] static std::size_t usable_size(void const* const Ptr) noexcept
+		{
+			WDUL_ASSERT(Ptr != nullptr);
+			return get_size(Ptr);
+		}
+
+		// Returns a snapshot of the statistics recorded for TagT.
+		[[nodiscard]] static allocation_stats stats() noexcept
+		{
+			return impl::collect_allocation_stats(registry());
+		}
+
+#ifdef _DEBUG
+		// Outputs the statistics recorded for TagT to the debug sinks, under the category debug::categories::memory.
+		static void output_stats(debug::severity const Severity = debug::severity::info)
+		{
+			auto const str = format_allocation_stats(TagT::name, stats());
+			debug::output(debug::get_facility(), debug::categories::memory, Severity, __func__, str.c_str());
+		}
+#endif
+
+	private:
+		static constexpr std::size_t header_size = default_allocation_alignment;
+
+		[[nodiscard]] static impl::allocation_registry& registry() noexcept
+		{
+			static impl::allocation_registry inst;
+			return inst;
+		}
+
+		// Called from noexcept functions, so the counters are acquired without throwing.
+		[[nodiscard]] static impl::allocation_counters& thread_counters() noexcept
+		{
+			thread_local impl::thread_allocation_counters inst(registry());
+			return inst.get();
+		}
+
+		static std::size_t block_size(std::size_t const Size)
+		{
+			if (Size > (std::numeric_limits<std::size_t>::max)() - header_size)
+			{
+				throw std::bad_alloc();
+			}
+			return Size + header_size;
+		}
+
+		static void* set_size(void* const Header, std::size_t const Size) noexcept
+		{
+			std::memcpy(Header, &Size, sizeof(Size));
+			return static_cast<std::uint8_t*>(Header) + header_size;
+		}
+
+		static std::size_t get_size(void const* const Ptr) noexcept
+		{
+			std::size_t size;
+			std::memcpy(&size, static_cast<std::uint8_t const*>(Ptr) - header_size, sizeof(size));
+			return size;
+		}
+
+		static void* get_header(void* const Ptr) noexcept
+		{
+			return static_cast<std::uint8_t*>(Ptr) - header_size;
+		}
+
+		static void record_allocation(std::size_t const Size) noexcept
+		{
+			auto& counters = thread_counters();
+			counters.increase(counters.allocations, 1);
+			counters.record_size(Size);
+			registry().add_live_bytes(static_cast<std::int64_t>(Size));
+		}
+
+		static void record_reallocation(std::size_t const OldSize, std::size_t const NewSize, bool const InPlace) noexcept
+		{
+			auto& counters = thread_counters();
+			counters.increase(InPlace ? counters.in_place_reallocations : counters.moving_reallocations, 1);
+			counters.record_size(NewSize);
+			registry().add_live_bytes(static_cast<std::int64_t>(NewSize) - static_cast<std::int64_t>(OldSize));
+		}
+	};
+}
@@ -162,6 +162,7 @@ namespace wdul::debug
 		inline constexpr category strings = 4;
 		inline constexpr category window = 5;
 		inline constexpr category mf = 6;
+		inline constexpr category memory = 7;
 	}
 }
 
@@ -0,0 +1,193 @@
+// This file is part of the WillDaisey/WDUL (Windows Desktop Utility Library) project.
+// View this project on github: https://github.com/WillDaisey/wdul/
+
+#pragma once
+#include "fs.hpp"
+#include "thread.hpp"
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace wdul
+{
+	// Describes what happened to a file or directory reported by a directory_watcher.
+	enum class file_change_action : std::uint8_t
+	{
+		// The file was created, or renamed to its current name. When a directory is renamed, the files within it are not
+		// reported.
+		added,
+
+		// The file was deleted, or renamed to another name.
+		removed,
+
+		// The file was written to, or its attributes changed, or it was deleted and then created again.
+		modified,
+
+		// Changes were lost because the notification buffer overflowed, so any file in the watched tree may have changed.
+		// The path of a change with this action is empty.
+		rescan,
+	};
+
+	// A change reported by a directory_watcher.
+	struct file_change
+	{
+		// The path of the file relative to the watched directory, such as "textures\stone.dds".
+		std::wstring path;
+
+		file_change_action action;
+	};
+
+	// Specifies what a directory_watcher watches, and how it batches the changes.
+	struct directory_watch_options
+	{
+		// If true, the subdirectories of the directory are watched too.
+		bool subtree = true;
+
+		// The kinds of change which are reported, as FILE_NOTIFY_CHANGE_* flags.
+		std::uint32_t filter = FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME | FILE_NOTIFY_CHANGE_SIZE |
+			FILE_NOTIFY_CHANGE_LAST_WRITE;
+
+		// A batch is delivered once no change has been reported for this many milliseconds, so that a file which is written
+		// several times in quick succession (as most programs save files) is reported once.
+		std::uint32_t debounce_milliseconds = 100;
+
+		// The longest a batch is held back by a continuous stream of changes, in milliseconds.
+		std::uint32_t max_delay_milliseconds = 1000;
+
+		// The size of the buffer which receives notifications from the system, in bytes. If more changes occur between reads
+		// than fit in the buffer, they are lost and a file_change_action::rescan change is reported. Network shares do not
+		// support buffers larger than 64 KiB.
+		std::uint32_t buffer_size = 64 * 1024;
+	};
+
+	/// <summary>
+	/// Watches a directory tree for changes with <c>ReadDirectoryChangesW</c>, and delivers them in debounced batches. Changes to
+	/// the same file within a batch are coalesced into one; for example, a file which is created and then written to is reported
+	/// as added, and a file which is created and then deleted is not reported at all. The cost of a batch is proportional to the
+	/// number of changes, not to the number of files in the tree, so this replaces polling each file with <c>fexists</c> or
+	/// <c>fgetsize</c>.
+	/// <para>
+	/// Changes are only collected while a thread is in <c>wait</c>, <c>poll</c> or <c>dispatch</c>; the system buffers the
+	/// changes which occur in between. A thread which runs a message loop can wait for <c>event()</c> with a timeout of
+	/// <c>timeout()</c> milliseconds alongside its other handles, and then call <c>poll</c>.
+	/// </para>
+	/// <para>
+	/// Pass <c>path_of(Change)</c> to <c>ini_file_reader::open</c> or <c>read_bytes</c> to reload a changed file. A file may still be
+	/// open in the program which wrote it, in which case these return <c>fopen_code::in_use</c>; the next write closes it, and
+	/// another change is reported.
+	/// </para>
+	/// <para>The member functions of a <c>directory_watcher</c> must not be called concurrently.</para>
+	/// </summary>
+	class directory_watcher
+	{
+	public:
+		directory_watcher(directory_watcher const&) = delete;
+		directory_watcher& operator=(directory_watcher const&) = delete;
+
+		directory_watcher() noexcept = default;
+
+		/// <summary>Stops watching the directory, if it is being watched.</summary>
+		~directory_watcher()
+		{
+			close();
+		}
+
+		/// <summary>
+		/// Starts watching a directory. Throws an exception if the directory cannot be watched for a reason other than those
+		/// below, or if the <c>directory_watcher</c> is already open.
+		/// </summary>
+		/// <param name="Directory">Pointer to a null-terminated UTF-16 string which contains the path of the directory to watch.</param>
+		/// <param name="Options">Specifies what is watched, and how changes are batched.</param>
+		/// <returns>
+		/// One of the following values:<para/>
+		/// <c>fopen_code::success</c><para/>
+		/// <c>fopen_code::not_found</c><para/>
+		/// <c>fopen_code::access_denied</c>
+		/// </returns>
+		[[nodiscard]] fopen_code open(_In_z_ wchar_t const* const Directory, directory_watch_options const& Options = {});
+
+		/// <summary>Stops watching the directory, and discards any changes which have not been delivered.</summary>
+		void close() noexcept;
+
+		/// <summary>
+		/// Waits up to <paramref name="Milliseconds"/> milliseconds for a batch of changes, and writes the batch to
+		/// <paramref name="Changes"/>, replacing its contents. A batch is ready once no change has been reported for
+		/// <c>debounce_milliseconds</c>, or <c>max_delay_milliseconds</c> after its first change. Throws an exception on failure,
+		/// such as if the watched directory is deleted.
+		/// </summary>
+		/// <returns>The number of changes in the batch. Zero if the wait timed out, in which case <paramref name="Changes"/> is empty.</returns>
+		std::size_t wait(std::vector<file_change>& Changes, std::uint32_t const Milliseconds = INFINITE);
+
+		/// <summary>Same as <c>wait</c>, except the function does not wait.</summary>
+		std::size_t poll(std::vector<file_change>& Changes)
+		{
+			return wait(Changes, 0);
+		}
+
+		/// <summary>
+		/// Waits up to <paramref name="Milliseconds"/> milliseconds for a batch of changes, and invokes
+		/// <paramref name="OnBatch"/> with a <c>std::span&lt;file_change const&gt;</c> of the batch, if there is one.
+		/// </summary>
+		/// <returns>The number of changes in the batch. Zero if the wait timed out, in which case <paramref name="OnBatch"/> is not invoked.</returns>
+		template <class BatchFn>
+		std::size_t dispatch(BatchFn&& OnBatch, std::uint32_t const Milliseconds = INFINITE)
+		{
+			auto const count = wait(mBatch, Milliseconds);
+			if (count != 0)
+			{
+				OnBatch(std::span<file_change const>(mBatch));
+			}
+			return count;
+		}
+
+		/// <returns>
+		/// The number of milliseconds until the changes collected so far are ready to be delivered. <c>INFINITE</c> if none have
+		/// been collected.
+		/// </returns>
+		[[nodiscard]] std::uint32_t timeout() const noexcept;
+
+		/// <returns>
+		/// A manual-reset event which is signaled when the system has reported changes which have not yet been collected.
+		/// </returns>
+		[[nodiscard]] HANDLE event() const noexcept { return mEvent.get(); }
+
+		/// <returns>The path of the watched directory, as passed to <c>open</c>.</returns>
+		[[nodiscard]] std::wstring_view directory() const noexcept { return mDirectoryPath; }
+
+		/// <returns>The path of the changed file: the path of the watched directory, a backslash, then the relative path.</returns>
+		[[nodiscard]] std::wstring path_of(file_change const& Change) const;
+
+		/// <returns><c>true</c> if and only if the <c>directory_watcher</c> is watching a directory.</returns>
+		[[nodiscard]] bool is_open() const noexcept { return static_cast<bool>(mDirectory); }
+
+	private:
+		// Begins an asynchronous read of the changes in the directory.
+		void issue();
+
+		// Collects the changes reported by the read in progress, if it has completed, then begins another.
+		void collect();
+
+		// Records a change to Path, coalescing it with any earlier change to Path in the same batch.
+		void record(std::wstring_view const Path, file_change_action const Action);
+
+		file_handle mDirectory;
+		event_handle mEvent;
+		OVERLAPPED mOverlapped = {};
+		byte_array mBuffer;
+		std::wstring mDirectoryPath;
+		directory_watch_options mOptions;
+
+		// The net change to each file since the last batch was delivered.
+		std::unordered_map<std::wstring, file_change_action> mPending;
+		bool mRescan = false;
+
+		// The tick counts at which the first and last change of the current batch were collected.
+		std::uint64_t mFirstChange = 0;
+		std::uint64_t mLastChange = 0;
+
+		// Used by dispatch.
+		std::vector<file_change> mBatch;
+	};
+}
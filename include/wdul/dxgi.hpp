@@ -3,6 +3,7 @@
 
 #pragma once
 #include "com.hpp"
+#include <memory_resource>
 #include <vector>
 #include <dxgi1_6.h>
 
@@ -27,6 +28,14 @@ namespace wdul
 		bool const NoSoftwareAdapter = true
 	);
 
+	// Same as the above overload, except the returned array allocates storage from the memory resource specified by Resource.
+	[[nodiscard]] std::pmr::vector<com_ptr<IDXGIAdapter4>> dxgi_list_adapters(
+		_In_ std::pmr::memory_resource* const Resource,
+		_In_ IDXGIFactory6* const DxgiFactory,
+		DXGI_GPU_PREFERENCE const GpuPreference = dxgi_default_gpu_preference,
+		bool const NoSoftwareAdapter = true
+	);
+
 	// Returns true if and only if the display supports tearing.
 	// Internally calls IDXGIFactory5::CheckFeatureSupport with the feature DXGI_FEATURE_PRESENT_ALLOW_TEARING.
 	[[nodiscard]] inline bool dxgi_check_tearing_support(_In_ IDXGIFactory5* const DxgiFactory)
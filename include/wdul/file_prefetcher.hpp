@@ -0,0 +1,113 @@
+// This file is part of the WillDaisey/WDUL (Windows Desktop Utility Library) project.
+// View this project on github: https://github.com/WillDaisey/wdul/
+
+#pragma once
+#include "fs.hpp"
+#include <atomic>
+#include <exception>
+#include <thread>
+#include <vector>
+
+namespace wdul
+{
+	// Specifies how a file_prefetcher reads the files of a profile.
+	struct file_prefetch_options
+	{
+		// The number of reads in flight at once. Several outstanding reads are usually needed to saturate an NVMe device.
+		std::uint32_t queue_depth = 32;
+
+		// The size of each read, in bytes. Rounded up to a multiple of file_access_granularity.
+		std::uint32_t chunk_size = std::uint32_t(256) << 10;
+
+		// A file recorded without ranges is read from its start, up to this many bytes.
+		std::uint64_t max_whole_file_size = std::uint64_t(64) << 20;
+	};
+
+	// Describes the work done by a file_prefetcher.
+	struct file_prefetch_stats
+	{
+		// The number of files opened.
+		std::uint64_t files = 0;
+
+		// The number of bytes read.
+		std::uint64_t bytes = 0;
+
+		// The number of files which could not be opened, such as because they no longer exist.
+		std::uint64_t skipped = 0;
+	};
+
+	/// <summary>
+	/// Reads the files of a profile recorded by <c>start_file_access_recording</c> on a background thread, so that they are in
+	/// the system file cache by the time the program opens them. The reads are issued through an <c>async_io_engine</c>,
+	/// <c>file_prefetch_options::queue_depth</c> at a time, in the order the files were first opened, so the files needed first
+	/// are read first. The bytes read are discarded.
+	/// <para>
+	/// The prefetcher opens files with <c>CreateFileW</c> rather than <c>fopen</c>, so its reads are not recorded, and a new
+	/// profile can be recorded while the previous one is prefetched. It shares read, write and delete access, so it never causes
+	/// the program's own opens to fail with <c>fopen_code::in_use</c>.
+	/// </para>
+	/// <para>
+	/// For example, at the start of the program:
+	/// <code>
+	/// std::vector&lt;file_access_entry&gt; profile;
+	/// if (load_file_access_profile(profile, L"startup.wfap") == fopen_code::success) prefetcher.start(std::move(profile));
+	/// start_file_access_recording();
+	/// </code>
+	/// and once startup is complete:
+	/// <code>
+	/// save_file_access_profile(stop_file_access_recording(), L"startup.wfap");
+	/// </code>
+	/// </para>
+	/// </summary>
+	class file_prefetcher
+	{
+	public:
+		file_prefetcher(file_prefetcher const&) = delete;
+		file_prefetcher& operator=(file_prefetcher const&) = delete;
+
+		file_prefetcher() noexcept = default;
+
+		/// <summary>Cancels the prefetch, if one is in progress.</summary>
+		~file_prefetcher()
+		{
+			cancel();
+		}
+
+		/// <summary>
+		/// Starts reading the files of <paramref name="Profile"/> on a background thread. Throws <c>hresult_invalid_state</c> if a
+		/// prefetch has been started, and neither <c>wait</c> nor <c>cancel</c> has been called since.
+		/// </summary>
+		/// <param name="Profile">The files to read, such as a profile returned by <c>load_file_access_profile</c>.</param>
+		/// <param name="Options">Specifies how the files are read.</param>
+		void start(std::vector<file_access_entry> Profile, file_prefetch_options const& Options = {});
+
+		/// <summary>
+		/// Waits for the prefetch to finish. A file which cannot be opened is skipped, but if the prefetch fails for another reason,
+		/// such as because memory is exhausted, the exception is rethrown. Throws <c>hresult_invalid_state</c> if no prefetch has
+		/// been started.
+		/// </summary>
+		/// <param name="Stats">Optional pointer to an object which receives the number of files and bytes read.</param>
+		void wait(_Out_opt_ file_prefetch_stats* const Stats = nullptr);
+
+		/// <summary>
+		/// Stops issuing reads, and waits for the reads in flight to finish. Does nothing if no prefetch has been started.
+		/// </summary>
+		void cancel() noexcept;
+
+		/// <returns><c>true</c> if a prefetch has been started, and neither <c>wait</c> nor <c>cancel</c> has been called since.</returns>
+		[[nodiscard]] bool is_active() const noexcept { return mThread.joinable(); }
+
+	private:
+		void run() noexcept;
+
+		std::vector<file_access_entry> mProfile;
+		file_prefetch_options mOptions;
+		file_prefetch_stats mStats;
+
+		// The exception thrown by the background thread, if any.
+		std::exception_ptr mError;
+
+		std::atomic<bool> mCancel = false;
+		std::thread mThread;
+	};
+}
@@ -4,8 +4,16 @@
 #pragma once
 #include "handle.hpp"
 #include "memory.hpp"
+#include "ring_buffer.hpp"
 #include "access_control.hpp"
+#include "parse.hpp"
+#include <concepts>
+#include <memory_resource>
+#include <span>
 #include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
 
 namespace wdul
 {
@@ -210,6 +218,25 @@ namespace wdul
 		return sz.QuadPart;
 	}
 
+	// Reserves at least Size bytes of storage for the specified file without changing its size, so that subsequent writes up to
+	// Size bytes extend the file without allocating storage piecemeal, and are less likely to fragment it. Storage reserved
+	// beyond the end of the file is released when the last handle to the file is closed.
+	// This function wraps the SetFileInformationByHandle function, using the FileAllocationInfo class.
+	inline void fpreallocate(_In_ HANDLE const FileHandle, std::uint64_t const Size)
+	{
+		FILE_ALLOCATION_INFO info;
+		info.AllocationSize.QuadPart = static_cast<LONGLONG>(Size);
+		check_bool(SetFileInformationByHandle(FileHandle, FileAllocationInfo, &info, sizeof(info)));
+	}
+
+	// Writes the system's buffered data for the specified file to the storage device, and waits for the device to report that
+	// the data is stored. Data written before the call survives a power failure once the function returns.
+	// This function wraps the FlushFileBuffers function. For further reading, view the MSDN documentation for FlushFileBuffers.
+	inline void fsync(_In_ HANDLE const FileHandle)
+	{
+		check_bool(FlushFileBuffers(FileHandle));
+	}
+
 	// Returns true if a directory with the given name exists.
 	// Returns false if the directory with the specified name does not exist, access was denied, or some other error occured.
 	inline bool directory_exists(_In_z_ wchar_t const* const Filename) noexcept
@@ -240,6 +267,82 @@ namespace wdul
 		return bytesWritten;
 	}
 
+	// Reads up to BufferSize bytes from the specified file, starting Offset bytes from the beginning of the file, without using
+	// the file pointer. Returns the number of bytes read, which is less than BufferSize only if the end of the file was reached.
+	//
+	// Any number of threads may call fread_at and fwrite_at on the same handle at once, each with its own offset, without
+	// locking. If the file was opened without FILE_FLAG_OVERLAPPED, the system serializes the calls, so they complete one at a
+	// time, and moves the file pointer to the end of the bytes read, so positional and sequential reads of the same handle must
+	// not be mixed across threads. If the file was opened with FILE_FLAG_OVERLAPPED, the calls proceed in parallel, and Event
+	// must be a manual-reset event owned by the calling thread, such as the one returned by get_thread_io_event, which is used to
+	// wait for the read.
+	// This function wraps the ReadFile function. For further reading, view the MSDN documentation for ReadFile.
+	std::uint32_t fread_at(_In_ HANDLE const FileHandle, std::uint64_t const Offset, std::uint32_t const BufferSize,
+		_Out_writes_bytes_to_(BufferSize, return) void* const Buffer, _In_opt_ HANDLE const Event = nullptr);
+
+	// Writes BufferSize bytes to the specified file, starting Offset bytes from the beginning of the file, without using the file
+	// pointer. Returns the number of bytes written. See fread_at.
+	// This function wraps the WriteFile function. For further reading, view the MSDN documentation for WriteFile.
+	std::uint32_t fwrite_at(_In_ HANDLE const FileHandle, std::uint64_t const Offset, std::uint32_t const BufferSize,
+		_In_reads_bytes_(BufferSize) void const* const Buffer, _In_opt_ HANDLE const Event = nullptr);
+
+	// Returns a manual-reset event owned by the calling thread, which is created on first use and closed when the thread exits.
+	// It can be passed as the Event argument of fread_at and fwrite_at whether or not the file was opened with
+	// FILE_FLAG_OVERLAPPED, so functions which are given a handle by the caller can accept either kind. The file must not be
+	// associated with an I/O completion port.
+	[[nodiscard]] HANDLE get_thread_io_event();
+
+	// Describes a buffer which freadv_at reads into.
+	struct file_read_buffer
+	{
+		void* data;
+		std::size_t size;
+	};
+
+	// Describes a buffer which fwritev_at writes from.
+	struct file_write_buffer
+	{
+		void const* data;
+		std::size_t size;
+	};
+
+	// Reads the region of the specified file which starts Offset bytes from the beginning of the file into each buffer in turn,
+	// as if by fread_at. Runs of buffers which together are no larger than 16 KiB, such as a header followed by a small payload,
+	// are read with a single read, and copied to the buffers; larger buffers are read straight from the file. Returns the number
+	// of bytes read, which is less than the total size of the buffers only if the end of the file was reached.
+	std::size_t freadv_at(_In_ HANDLE const FileHandle, std::uint64_t const Offset, std::span<file_read_buffer const> const Buffers,
+		_In_opt_ HANDLE const Event = nullptr);
+
+	// Writes each buffer in turn to the region of the specified file which starts Offset bytes from the beginning of the file,
+	// as if by fwrite_at. Runs of buffers which together are no larger than 16 KiB, such as a RIFF chunk header followed by a
+	// small payload, are copied together and written with a single write; larger buffers are written straight to the file.
+	void fwritev_at(_In_ HANDLE const FileHandle, std::uint64_t const Offset, std::span<file_write_buffer const> const Buffers,
+		_In_opt_ HANDLE const Event = nullptr);
+
+	// Reads Size bytes from the specified file, starting Offset bytes from the beginning of the file, into a sequence of pages,
+	// with a single request. The file must have been opened with FILE_FLAG_NO_BUFFERING and FILE_FLAG_OVERLAPPED, so Offset and
+	// Size must be multiples of the volume sector size. Each element of Pages is the address of a page-aligned buffer of
+	// page_size() bytes, such as a page of a virtual_buffer, and Size must not exceed the size of the pages. Event must be a
+	// manual-reset event, which is used to wait for the read. Returns the number of bytes read.
+	// This function wraps the ReadFileScatter function. For further reading, view the MSDN documentation for ReadFileScatter.
+	std::uint32_t fread_scatter(_In_ HANDLE const FileHandle, std::uint64_t const Offset, std::span<void* const> const Pages,
+		std::uint32_t const Size, _In_ HANDLE const Event);
+
+	// Same as fread_scatter, except the pages are written to the file with a single request. Returns the number of bytes written.
+	// This function wraps the WriteFileGather function. For further reading, view the MSDN documentation for WriteFileGather.
+	std::uint32_t fwrite_gather(_In_ HANDLE const FileHandle, std::uint64_t const Offset, std::span<void* const> const Pages,
+		std::uint32_t const Size, _In_ HANDLE const Event);
+
+	// Reads from the specified file into the free space of the given ring buffer, and commits the bytes read.
+	// Reads at most Buffer.free_space() bytes. Returns the number of bytes read.
+	inline std::uint32_t fread(_In_ HANDLE const FileHandle, mirrored_ring_buffer& Buffer)
+	{
+		auto const bytesRead = fread(FileHandle, static_cast<std::uint32_t>((std::min)(Buffer.free_space(), std::size_t(0xFFFFFFFF))),
+			Buffer.write_data());
+		Buffer.commit(bytesRead);
+		return bytesRead;
+	}
+
 	// Reads characters from the specified file until the specified delimiter is found, or the end of the file is reached.
 	// The delimiter is specified by the range [Delim, Delim + DelimSize).
 	// The range [Buffer, Buffer + BufferSize) is used as a buffer for each time data is read from the file.
@@ -294,6 +397,16 @@ namespace wdul
 		_In_reads_(BufferSize) std::uint8_t* const Buffer
 	);
 
+	// Same as the std::u8string overload, except the output string allocates from its memory resource.
+	std::int64_t fread_delimited_consecutive(
+		_In_ HANDLE const FileHandle,
+		_In_range_(> , 0) std::uint32_t const DelimSize,
+		_In_reads_(DelimSize) char8_t const* const Delim,
+		std::pmr::u8string& Output,
+		_In_range_(> , 0) std::uint32_t const BufferSize,
+		_In_reads_(BufferSize) std::uint8_t* const Buffer
+	);
+
 	// Calls Output.clear(), followed by fread_delimited_consecutive.
 	inline std::int64_t fread_delimited(
 		_In_ HANDLE const FileHandle,
@@ -308,8 +421,97 @@ namespace wdul
 		return fread_delimited_consecutive(FileHandle, DelimSize, Delim, Output, BufferSize, Buffer);
 	}
 
+	// Calls Output.clear(), followed by fread_delimited_consecutive.
+	inline std::int64_t fread_delimited(
+		_In_ HANDLE const FileHandle,
+		_In_range_(> , 0) std::uint32_t const DelimSize,
+		_In_reads_(DelimSize) char8_t const* const Delim,
+		std::pmr::u8string& Output,
+		_In_range_(> , 0) std::uint32_t const BufferSize,
+		_In_reads_(BufferSize) std::uint8_t* const Buffer
+	)
+	{
+		Output.clear();
+		return fread_delimited_consecutive(FileHandle, DelimSize, Delim, Output, BufferSize, Buffer);
+	}
+
+	// Same as fread_delimited, except reading stops at the first of any of the delimiters in the set specified by Delims. See
+	// delimiter_set_matcher for which delimiter is found when several match.
+	// If Found is not nullptr, the index of the delimiter found is written to it, or delimiter_set::npos if the end of the file
+	// was reached first.
+	// Preconditions: BufferSize must be greater than zero.
+	std::int64_t fread_delimited(
+		_In_ HANDLE const FileHandle,
+		delimiter_set const& Delims,
+		_In_range_(> , 0) std::uint32_t const BufferSize,
+		_In_reads_(BufferSize) std::uint8_t* const Buffer,
+		_Out_opt_ std::size_t* const Found = nullptr
+	);
+
+	// Same as fread_delimited_consecutive, except reading stops at the first of any of the delimiters in the set specified by
+	// Delims. The delimiter found is not appended to the output string.
+	// If Found is not nullptr, the index of the delimiter found is written to it, or delimiter_set::npos if the end of the file
+	// was reached first.
+	std::int64_t fread_delimited_consecutive(
+		_In_ HANDLE const FileHandle,
+		delimiter_set const& Delims,
+		std::u8string& Output,
+		_In_range_(> , 0) std::uint32_t const BufferSize,
+		_In_reads_(BufferSize) std::uint8_t* const Buffer,
+		_Out_opt_ std::size_t* const Found = nullptr
+	);
+
+	// Same as the std::u8string overload, except the output string allocates from its memory resource.
+	std::int64_t fread_delimited_consecutive(
+		_In_ HANDLE const FileHandle,
+		delimiter_set const& Delims,
+		std::pmr::u8string& Output,
+		_In_range_(> , 0) std::uint32_t const BufferSize,
+		_In_reads_(BufferSize) std::uint8_t* const Buffer,
+		_Out_opt_ std::size_t* const Found = nullptr
+	);
+
+	// Calls Output.clear(), followed by fread_delimited_consecutive.
+	inline std::int64_t fread_delimited(
+		_In_ HANDLE const FileHandle,
+		delimiter_set const& Delims,
+		std::u8string& Output,
+		_In_range_(> , 0) std::uint32_t const BufferSize,
+		_In_reads_(BufferSize) std::uint8_t* const Buffer,
+		_Out_opt_ std::size_t* const Found = nullptr
+	)
+	{
+		Output.clear();
+		return fread_delimited_consecutive(FileHandle, Delims, Output, BufferSize, Buffer, Found);
+	}
+
+	// Calls Output.clear(), followed by fread_delimited_consecutive.
+	inline std::int64_t fread_delimited(
+		_In_ HANDLE const FileHandle,
+		delimiter_set const& Delims,
+		std::pmr::u8string& Output,
+		_In_range_(> , 0) std::uint32_t const BufferSize,
+		_In_reads_(BufferSize) std::uint8_t* const Buffer,
+		_Out_opt_ std::size_t* const Found = nullptr
+	)
+	{
+		Output.clear();
+		return fread_delimited_consecutive(FileHandle, Delims, Output, BufferSize, Buffer, Found);
+	}
+
+	// Specifies which character sequences are new lines.
+	enum class newline_mode : std::uint8_t
+	{
+		// A carriage return character followed by a line feed character (CR+LF).
+		crlf,
+
+		// Any of CR+LF, LF or CR. A CR followed by an LF is a single new line. Suitable for files whose line endings are mixed.
+		any,
+	};
+
 	// Reads characters from the specified file until the a new line is found, or the end of the file is reached.
-	// A new line is represented by a carriage return character followed my a line feed character (CR+LF).
+	// A new line is represented by a carriage return character followed my a line feed character (CR+LF), or, if Mode is
+	// newline_mode::any, by any of CR+LF, LF or CR.
 	// The range [Buffer, Buffer + BufferSize) is used as a buffer for each time data is read from the file.
 	// 
 	// Preconditions:
@@ -324,16 +526,22 @@ namespace wdul
 	// Exception effects:
 	// The file pointer may have moved.
 	// The contents of the range [Buffer, Buffer + BufferSize) is indeterminate.
-	inline std::int64_t freadline(_In_ HANDLE const FileHandle, std::uint32_t const BufferSize, std::uint8_t* const Buffer)
+	inline std::int64_t freadline(_In_ HANDLE const FileHandle, std::uint32_t const BufferSize, std::uint8_t* const Buffer,
+		newline_mode const Mode = newline_mode::crlf)
 	{
+		if (Mode == newline_mode::any)
+		{
+			return fread_delimited(FileHandle, newline_delimiters(), BufferSize, Buffer);
+		}
 		char8_t const delimiter[] = { u8'\r', u8'\n' };
 		return fread_delimited(FileHandle, sizeof(delimiter), delimiter, BufferSize, Buffer);
 	}
 
 	// Reads characters from the specified file to the string specified by Output until a new line is found, or the end of the
-	// file is reached. A new line is represented by a carriage return character followed my a line feed character (CR+LF).
-	// The characters which make up the new line are not included in the output string, however, carriage return and line feed
-	// characters may appear separately in the output string.
+	// file is reached. A new line is represented by a carriage return character followed my a line feed character (CR+LF), or,
+	// if Mode is newline_mode::any, by any of CR+LF, LF or CR.
+	// The characters which make up the new line are not included in the output string, however, in newline_mode::crlf,
+	// carriage return and line feed characters may appear separately in the output string.
 	// The range [Buffer, Buffer + BufferSize) is used as a buffer for each time data is read from the file.
 	// 
 	// Preconditions:
@@ -348,12 +556,88 @@ namespace wdul
 	// Exception effects:
 	// The file pointer may have moved.
 	// The contents of the range [Buffer, Buffer + BufferSize) is indeterminate.
-	inline std::int64_t freadline(_In_ HANDLE const FileHandle, std::u8string& Output, std::uint32_t const BufferSize, std::uint8_t* const Buffer)
+	inline std::int64_t freadline(_In_ HANDLE const FileHandle, std::u8string& Output, std::uint32_t const BufferSize, std::uint8_t* const Buffer,
+		newline_mode const Mode = newline_mode::crlf)
 	{
+		if (Mode == newline_mode::any)
+		{
+			return fread_delimited(FileHandle, newline_delimiters(), Output, BufferSize, Buffer);
+		}
+		char8_t const delimiter[] = { u8'\r', u8'\n' };
+		return fread_delimited(FileHandle, sizeof(delimiter), delimiter, Output, BufferSize, Buffer);
+	}
+
+	// Same as the std::u8string overload, except the output string allocates from its memory resource.
+	inline std::int64_t freadline(_In_ HANDLE const FileHandle, std::pmr::u8string& Output, std::uint32_t const BufferSize, std::uint8_t* const Buffer,
+		newline_mode const Mode = newline_mode::crlf)
+	{
+		if (Mode == newline_mode::any)
+		{
+			return fread_delimited(FileHandle, newline_delimiters(), Output, BufferSize, Buffer);
+		}
 		char8_t const delimiter[] = { u8'\r', u8'\n' };
 		return fread_delimited(FileHandle, sizeof(delimiter), delimiter, Output, BufferSize, Buffer);
 	}
 
+	namespace impl
+	{
+		// Returns the size of the given file, for use by read_bytes.
+		// Throws file_too_large if the file cannot be read with a single call to fread.
+		[[nodiscard]] std::uint32_t read_bytes_size(_In_ HANDLE const FileHandle);
+
+		// Opens the given file for use by read_bytes.
+		[[nodiscard]] _Success_(return == fopen_code::success) fopen_code read_bytes_open(file_handle& File, _In_z_ wchar_t const* const Filename);
+	}
+
+	/// <summary>Reads a file to an array of bytes.</summary>
+	/// <typeparam name="AllocT">Allocator traits used to allocate the array.</typeparam>
+	/// <typeparam name="Alignment">The alignment of the array, or zero for the default alignment of <typeparamref name="AllocT"/>.</typeparam>
+	/// <param name="Filename">Pointer to a null-terminated UTF-16 string which contains the name of the file to be opened and read.</param>
+	/// <returns>A <c>basic_byte_array</c> containing the bytes read from the file.</returns>
+	template <allocate_traits AllocT, std::size_t Alignment = 0>
+	[[nodiscard]] basic_byte_array<AllocT, Alignment> read_bytes(_In_z_ wchar_t const* const Filename)
+	{
+		auto f = fopen(Filename, file_open_mode::open_existing, FILE_FLAG_SEQUENTIAL_SCAN, generic_access::read, file_share_mode::read);
+		basic_byte_array<AllocT, Alignment> bytes(impl::read_bytes_size(f.get()));
+		if (bytes.size() != 0)
+		{
+			fread(f.get(), static_cast<std::uint32_t>(bytes.size()), bytes.data());
+		}
+		f.close();
+		return bytes;
+	}
+
+	/// <summary>Reads a file to an array of bytes.</summary>
+	/// <typeparam name="AllocT">Allocator traits used to allocate the array.</typeparam>
+	/// <typeparam name="Alignment">The alignment of the array, or zero for the default alignment of <typeparamref name="AllocT"/>.</typeparam>
+	/// <param name="Output">Reference to a <c>basic_byte_array</c> which will contain the bytes read from the file.</param>
+	/// <param name="Filename">Pointer to a null-terminated UTF-16 string which contains the name of the file to be opened and read.</param>
+	/// <returns>
+	/// One of the following values:<para/>
+	/// <c>fopen_code::success</c><para/>
+	/// <c>fopen_code::not_found</c><para/>
+	/// <c>fopen_code::access_denied</c><para/>
+	/// <c>fopen_code::in_use</c>
+	/// </returns>
+	template <allocate_traits AllocT, std::size_t Alignment>
+	[[nodiscard]] fopen_code read_bytes(basic_byte_array<AllocT, Alignment>& Output, _In_z_ wchar_t const* const Filename)
+	{
+		file_handle f;
+		auto const code = impl::read_bytes_open(f, Filename);
+		if (code != fopen_code::success)
+		{
+			return code;
+		}
+		basic_byte_array<AllocT, Alignment> bytes(impl::read_bytes_size(f.get()));
+		if (bytes.size() != 0)
+		{
+			fread(f.get(), static_cast<std::uint32_t>(bytes.size()), bytes.data());
+		}
+		f.close();
+		Output = std::move(bytes);
+		return fopen_code::success;
+	}
+
 	/// <summary>Reads a file to an array of bytes.</summary>
 	/// <param name="Filename">Pointer to a null-terminated UTF-16 string which contains the name of the file to be opened and read.</param>
 	/// <returns>A <c>byte_array</c> containing the bytes read from the file.</returns>
@@ -370,4 +654,273 @@ namespace wdul
 	/// <c>fopen_code::in_use</c>
 	/// </returns>
 	[[nodiscard]] fopen_code read_bytes(byte_array& Output, _In_z_ wchar_t const* const Filename);
+
+	/// <summary>
+	/// Reads a file to a <c>virtual_buffer</c>. The buffer reserves exactly enough address space for the file, and the file is
+	/// read straight into the committed pages, so files larger than 4 GiB can be read without copying. To allocate the buffer
+	/// with large pages, or to read the file in smaller chunks or on several threads, pass a <c>read_bytes_options</c>.
+	/// </summary>
+	/// <param name="Output">Reference to a <c>virtual_buffer</c> which will contain the bytes read from the file.</param>
+	/// <param name="Filename">Pointer to a null-terminated UTF-16 string which contains the name of the file to be opened and read.</param>
+	/// <returns>
+	/// One of the following values:<para/>
+	/// <c>fopen_code::success</c><para/>
+	/// <c>fopen_code::not_found</c><para/>
+	/// <c>fopen_code::access_denied</c><para/>
+	/// <c>fopen_code::in_use</c>
+	/// </returns>
+	[[nodiscard]] fopen_code read_bytes(virtual_buffer& Output, _In_z_ wchar_t const* const Filename);
+
+	// Specifies how read_bytes reads a file into a virtual_buffer.
+	struct read_bytes_options
+	{
+		// The size of each read, in bytes. Rounded up to a multiple of the page size, and limited to 1 GiB.
+		std::size_t chunk_size = std::size_t(8) << 20;
+
+		// The number of threads which read chunks concurrently, each with positional reads. If 1, every chunk is read on the
+		// calling thread. Several outstanding reads are usually needed to saturate an NVMe device.
+		unsigned threads = 1;
+
+		// If true, the file is opened with FILE_FLAG_NO_BUFFERING, so the data is read straight from the device into the buffer
+		// rather than through the system file cache. Chunks are page aligned, which satisfies the sector alignment required by
+		// unbuffered reads on every common device.
+		bool unbuffered = false;
+
+		// If true, attempts to allocate the buffer with large pages. See virtual_buffer.
+		bool large_pages = false;
+	};
+
+	// Describes a call to read_bytes.
+	struct read_bytes_stats
+	{
+		// The number of bytes read.
+		std::uint64_t bytes = 0;
+
+		// The time taken to read the bytes, in seconds, excluding the time taken to open the file and reserve the buffer.
+		double seconds = 0;
+
+		// Returns the throughput of the read in bytes per second, or zero if no time was measured.
+		[[nodiscard]] double bytes_per_sec() const noexcept
+		{
+			return seconds > 0 ? static_cast<double>(bytes) / seconds : 0;
+		}
+	};
+
+	/// <summary>
+	/// Reads a file of any size to a <c>virtual_buffer</c>, in chunks of <c>read_bytes_options::chunk_size</c> bytes, optionally
+	/// dispatching the chunks to several threads.
+	/// </summary>
+	/// <param name="Output">Reference to a <c>virtual_buffer</c> which will contain the bytes read from the file.</param>
+	/// <param name="Filename">Pointer to a null-terminated UTF-16 string which contains the name of the file to be opened and read.</param>
+	/// <param name="Options">Specifies how the file is read.</param>
+	/// <param name="Stats">Optional pointer to an object which receives the number of bytes read and the time taken.</param>
+	/// <returns>
+	/// One of the following values:<para/>
+	/// <c>fopen_code::success</c><para/>
+	/// <c>fopen_code::not_found</c><para/>
+	/// <c>fopen_code::access_denied</c><para/>
+	/// <c>fopen_code::in_use</c>
+	/// </returns>
+	[[nodiscard]] fopen_code read_bytes(virtual_buffer& Output, _In_z_ wchar_t const* const Filename,
+		read_bytes_options const& Options, _Out_opt_ read_bytes_stats* const Stats = nullptr);
+
+	// Describes a file or directory found by walk_directory. The strings are only valid until the batch callback returns.
+	struct directory_entry
+	{
+		// The path of the entry: the root passed to walk_directory, followed by the names of the directories between the root
+		// and the entry, then the name of the entry, separated by backslashes.
+		std::wstring_view path;
+
+		// The name of the entry, which is the last component of path.
+		std::wstring_view name;
+
+		// The file attributes of the entry, such as FILE_ATTRIBUTE_DIRECTORY.
+		std::uint32_t attributes;
+
+		// The number of directories between the root and the entry. Entries of the root itself have a depth of zero.
+		std::uint32_t depth;
+
+		// The size of the file, in bytes. Zero for directories.
+		std::uint64_t size;
+
+		// The time the entry was last written, as a FILETIME (100-nanosecond intervals since January 1, 1601 UTC).
+		std::uint64_t last_write_time;
+
+		[[nodiscard]] bool is_directory() const noexcept { return (attributes & FILE_ATTRIBUTE_DIRECTORY) != 0; }
+	};
+
+	// Specifies how walk_directory walks a directory tree.
+	struct directory_walk_options
+	{
+		// The number of threads which enumerate directories concurrently. If 1, every directory is enumerated on the calling
+		// thread. Directories are handed out from a shared queue, so subtrees of any shape are spread across the threads.
+		unsigned threads = 1;
+
+		// The depth of the deepest directory to enumerate. Zero enumerates the root only.
+		std::uint32_t max_depth = UINT32_MAX;
+
+		// Entries with any of these attributes are neither reported nor descended into, such as FILE_ATTRIBUTE_HIDDEN.
+		std::uint32_t exclude_attributes = 0;
+
+		// If false, files are not reported.
+		bool report_files = true;
+
+		// If false, directories are not reported, although they are still descended into.
+		bool report_directories = true;
+
+		// If true, directories which are reparse points, such as symbolic links and junctions, are descended into. This can
+		// visit a directory more than once, or loop until max_depth is reached.
+		bool follow_reparse_points = false;
+
+		// The largest number of entries passed to a single call of the batch callback.
+		std::size_t batch_size = 256;
+	};
+
+	// Describes a call to walk_directory.
+	struct directory_walk_stats
+	{
+		// The number of directories enumerated, including the root.
+		std::uint64_t directories = 0;
+
+		// The number of entries found, including entries which were excluded or not reported.
+		std::uint64_t entries = 0;
+
+		// The number of directories below the root which could not be enumerated, such as because access was denied, they were
+		// removed during the walk, or their paths are too long. These directories are skipped.
+		std::uint64_t skipped = 0;
+	};
+
+	namespace impl
+	{
+		using directory_batch_callback = void(*)(void* Context, std::span<directory_entry const> Batch);
+		using directory_descend_callback = bool(*)(void* Context, directory_entry const& Entry);
+
+		[[nodiscard]] fopen_code walk_directory(_In_z_ wchar_t const* const Root, directory_walk_options const& Options,
+			directory_batch_callback const OnBatch, void* const BatchContext, directory_descend_callback const Descend,
+			void* const DescendContext, directory_walk_stats* const Stats);
+	}
+
+	/// <summary>
+	/// Enumerates the files and directories in a directory tree, passing the entries to <paramref name="OnBatch"/> in batches.
+	/// Each directory is listed with large fetches, and each entry's attributes, size and last write time come from the listing,
+	/// so no file is opened or queried individually. The walk allocates per directory, but not per entry.
+	/// <para>
+	/// If <c>Options.threads</c> is greater than 1, the callbacks are invoked concurrently from several threads, and entries are
+	/// reported in no particular order. Otherwise, the callbacks are invoked on the calling thread. If a callback throws an
+	/// exception, the walk stops, and the exception is rethrown once every thread has stopped.
+	/// </para>
+	/// </summary>
+	/// <param name="Root">Pointer to a null-terminated UTF-16 string which contains the path of the directory to walk.</param>
+	/// <param name="Options">Specifies how the tree is walked.</param>
+	/// <param name="OnBatch">A callable invoked with a <c>std::span&lt;directory_entry const&gt;</c> for each batch of entries.</param>
+	/// <param name="Descend">
+	/// A callable invoked with each directory entry not excluded by <paramref name="Options"/>, before the directory is
+	/// descended into. If it returns false, the directory's subtree is skipped; the directory itself is still reported.
+	/// </param>
+	/// <param name="Stats">
+	/// Optional pointer to an object which receives the number of directories and entries found. It is written even if a
+	/// callback throws, in which case it counts the entries found before the walk stopped.
+	/// </param>
+	/// <returns>
+	/// One of the following values:<para/>
+	/// <c>fopen_code::success</c><para/>
+	/// <c>fopen_code::not_found</c>, if the root does not exist or is not a directory.<para/>
+	/// <c>fopen_code::access_denied</c>, if the root could not be enumerated.
+	/// </returns>
+	template <class BatchFn, class DescendFn>
+		requires std::predicate<DescendFn&, directory_entry const&>
+	[[nodiscard]] fopen_code walk_directory(_In_z_ wchar_t const* const Root, directory_walk_options const& Options, BatchFn&& OnBatch,
+		DescendFn&& Descend, _Out_opt_ directory_walk_stats* const Stats = nullptr)
+	{
+		return impl::walk_directory(Root, Options,
+			[](void* const Context, std::span<directory_entry const> const Batch)
+			{
+				(*static_cast<std::remove_reference_t<BatchFn>*>(Context))(Batch);
+			}, const_cast<void*>(static_cast<void const*>(std::addressof(OnBatch))),
+			[](void* const Context, directory_entry const& Entry) -> bool
+			{
+				return (*static_cast<std::remove_reference_t<DescendFn>*>(Context))(Entry);
+			}, const_cast<void*>(static_cast<void const*>(std::addressof(Descend))), Stats);
+	}
+
+	/// <summary>Same as the other overload, except every directory not excluded by <paramref name="Options"/> is descended into.</summary>
+	template <class BatchFn>
+	[[nodiscard]] fopen_code walk_directory(_In_z_ wchar_t const* const Root, directory_walk_options const& Options, BatchFn&& OnBatch,
+		_Out_opt_ directory_walk_stats* const Stats = nullptr)
+	{
+		return impl::walk_directory(Root, Options,
+			[](void* const Context, std::span<directory_entry const> const Batch)
+			{
+				(*static_cast<std::remove_reference_t<BatchFn>*>(Context))(Batch);
+			}, const_cast<void*>(static_cast<void const*>(std::addressof(OnBatch))), nullptr, nullptr, Stats);
+	}
+
+	// A range of bytes within a file.
+	struct file_range
+	{
+		std::uint64_t offset;
+		std::uint64_t size;
+	};
+
+	// A file opened while file accesses were recorded, and the ranges read from it. If ranges is empty, the file was only read
+	// with the file pointer (such as by fread or the read_bytes templates) or through a mapped view, so all of it is assumed to
+	// have been read.
+	struct file_access_entry
+	{
+		// The full path of the file.
+		std::wstring path;
+
+		// The ranges read, sorted by offset, with none overlapping or adjacent. Each range starts and ends on a multiple of
+		// file_access_granularity, so the last may extend beyond the end of the file.
+		std::vector<file_range> ranges;
+	};
+
+	// The granularity with which file accesses are recorded, in bytes. Recording ranges of this size keeps a profile small, and
+	// lets a prefetcher read it with few large reads rather than many small ones.
+	inline constexpr std::uint64_t file_access_granularity = std::uint64_t(64) << 10;
+
+	// Starts recording the files which fopen opens for reading, and the ranges read from them by fread_at and freadv_at. Reads
+	// are recorded through any handle to a recorded file, including handles opened with CreateFileW. Since buffered_file_reader,
+	// file_source, mapped_file and the read_bytes functions open files with fopen, the files read by any of these are recorded.
+	// Files opened with FILE_FLAG_NO_BUFFERING or FILE_FLAG_BACKUP_SEMANTICS are not recorded, since the system file cache does
+	// not serve them.
+	//
+	// Intended to be called at the start of the program, and stopped once startup is complete, to produce a profile for
+	// file_prefetcher to replay on the next start. Recording is best effort: a file which cannot be recorded, such as because
+	// memory is exhausted, is omitted. While not recording, the cost to fopen and fread_at is a single atomic load. While
+	// recording, each thread holds the range it is reading from a recorded file through its last handle, and extends it under
+	// a mutex private to the thread, so sequential reads neither query the file nor contend with other threads. The identity
+	// of the file is queried again when the thread reads through another handle, or after fopen has opened a file, since the
+	// system may then have reused the value of a closed handle. A handle opened with CreateFileW, which reuses the value of a
+	// closed handle to a recorded file before fopen opens another file, may have its reads attributed to that file.
+	// Throws hresult_invalid_state if file accesses are already being recorded.
+	void start_file_access_recording();
+
+	// Stops recording file accesses, and returns the files recorded, in the order they were first opened. Returns an empty
+	// profile if file accesses were not being recorded.
+	[[nodiscard]] std::vector<file_access_entry> stop_file_access_recording();
+
+	// Writes a profile returned by stop_file_access_recording to the specified file, replacing it if it exists. The profile is
+	// written to a temporary file, named by appending ".tmp" to Filename, which then replaces the file, so that a failure or a
+	// crash part way through never leaves a truncated profile. Throws an exception on failure.
+	void save_file_access_profile(std::span<file_access_entry const> const Profile, _In_z_ wchar_t const* const Filename);
+
+	/// <summary>
+	/// Reads a profile written by <c>save_file_access_profile</c>. If the file is not a valid profile, such as a profile written
+	/// by another version of the library, <paramref name="Profile"/> is cleared and <c>fopen_code::success</c> is returned, since
+	/// a stale profile only means that nothing is prefetched.
+	/// </summary>
+	/// <param name="Profile">
+	/// Reference to a vector which receives the files of the profile, replacing its contents. Cleared if the file cannot be
+	/// opened.
+	/// </param>
+	/// <param name="Filename">Pointer to a null-terminated UTF-16 string which contains the name of the profile.</param>
+	/// <returns>
+	/// One of the following values:<para/>
+	/// <c>fopen_code::success</c><para/>
+	/// <c>fopen_code::not_found</c><para/>
+	/// <c>fopen_code::access_denied</c><para/>
+	/// <c>fopen_code::in_use</c>
+	/// </returns>
+	[[nodiscard]] fopen_code load_file_access_profile(std::vector<file_access_entry>& Profile, _In_z_ wchar_t const* const Filename);
 }
@@ -2,7 +2,7 @@
 // View this project on github: https://github.com/WillDaisey/wdul/
 
 #pragma once
-#include "fs.hpp"
+#include "buffered_file.hpp"
 
 namespace wdul
 {
@@ -13,13 +13,26 @@ namespace wdul
 		ini_file_reader(ini_file_reader const&) = delete;
 		ini_file_reader& operator=(ini_file_reader const&) = delete;
 
-		ini_file_reader() noexcept
+		ini_file_reader() noexcept = default;
+
+		/// <summary>
+		/// Constructs a reader whose internal strings allocate storage from <paramref name="Resource"/>, such as a resource
+		/// returned by <c>get_allocator_resource</c> or an <c>arena_resource</c>.
+		/// </summary>
+		/// <param name="Resource">The memory resource. Must outlive the reader.</param>
+		explicit ini_file_reader(_In_ std::pmr::memory_resource* const Resource) noexcept :
+			mNode(Resource),
+			mSection(Resource)
 		{
-			leave_uninitialized(mReadBuffer);
 		}
 
 		ini_file_reader(ini_file_reader&&) noexcept = default;
-		ini_file_reader& operator=(ini_file_reader&&) noexcept = default;
+
+		/// <summary>
+		/// If the readers' strings allocate from different memory resources, the strings are copied rather than moved, so the
+		/// assignment may throw <c>std::bad_alloc</c>.
+		/// </summary>
+		ini_file_reader& operator=(ini_file_reader&&) = default;
 
 		/// <summary>
 		/// Opens the file specified by <paramref name="Filename"/>.
@@ -34,7 +47,25 @@ namespace wdul
 		/// </returns>
 		fopen_code open(_In_z_ wchar_t const* const Filename);
 
-		/// <summary>Closes the file.</summary>
+		/// <summary>
+		/// Reads a file which the reader does not own. The reader does not use the file pointer, so any number of readers may
+		/// share one handle, on any number of threads. See <c>buffered_file_reader::share</c>.
+		/// </summary>
+		/// <param name="File">
+		/// A file opened with read access, with or without <c>FILE_FLAG_OVERLAPPED</c>. Must not be associated with an I/O
+		/// completion port, and must remain open until the reader is closed.
+		/// </param>
+		void share(_In_ HANDLE const File);
+
+		/// <summary>
+		/// Reads a <c>byte_source</c>, such as a <c>memory_source</c>, or a <c>transform_source</c> which converts a UTF-16 file
+		/// to UTF-8. The source must be seekable, and the position of the source when it is attached is treated as the start of
+		/// the file. See <c>buffered_file_reader::attach</c>.
+		/// </summary>
+		/// <param name="Source">The source. Must remain valid until the reader is closed.</param>
+		void attach(byte_source& Source);
+
+		/// <summary>Closes the file, unless it is shared or attached.</summary>
 		void close() noexcept;
 
 		/// <summary>
@@ -59,17 +90,32 @@ namespace wdul
 		/// </returns>
 		bool find_value(std::u8string& Value, std::u8string_view const Key);
 
+		/// <summary>
+		/// Same as the <c>std::u8string</c> overload, except <paramref name="Value"/> allocates storage from its own memory resource.
+		/// </summary>
+		bool find_value(std::pmr::u8string& Value, std::u8string_view const Key);
+
 		/// <returns><c>true</c> if and only if the <c>ini_file_reader</c> is currently open.</returns>
-		[[nodiscard]] bool is_open() const noexcept { return !!mFile; }
+		[[nodiscard]] bool is_open() const noexcept { return mReader.is_open(); }
 
-		/// <returns>The name of the current section.</returns>
-		[[nodiscard]] std::u8string const& get_section() const noexcept { return mSection; }
+		/// <returns>
+		/// The name of the current section. The view is invalidated when the current section changes, or the reader is destroyed.
+		/// </returns>
+		[[nodiscard]] std::u8string_view get_section() const noexcept { return mSection; }
 
 	private:
-		file_handle mFile;
-		std::u8string mNode;
-		std::u8string mSection;
+		template <class StringT>
+		bool find_value_x(StringT& Value, std::u8string_view const Key);
+
+		// .ini files are small, so a small buffer is enough to hold most files in their entirety.
+		static constexpr std::size_t buffer_size = 4096;
+
+		buffered_file_reader mReader;
+		std::pmr::u8string mNode;
+		std::pmr::u8string mSection;
 		std::int64_t mSectionFp = 0;
-		std::uint8_t mReadBuffer[128];
+
+		// The position of the start of the file, which is non-zero if an attached source was not at the start of its stream.
+		std::int64_t mStart = 0;
 	};
 }
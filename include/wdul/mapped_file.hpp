@@ -0,0 +1,260 @@
+// This file is part of the WillDaisey/WDUL (Windows Desktop Utility Library) project.
+// View this project on github: https://github.com/WillDaisey/wdul/
+
+#pragma once
+#include "fs.hpp"
+#include <span>
+#include <utility>
+
+namespace wdul
+{
+	// Specifies how the pages of a file view may be accessed.
+	enum class map_access : std::uint8_t
+	{
+		// The view can only be read.
+		read_only,
+
+		// The view can be read and written. Written pages are copied privately to the process, so writes are never seen by the
+		// file or by other views.
+		copy_on_write,
+	};
+
+	/// <summary>
+	/// Manages a view of a file mapped into the address space of the calling process. The contents of the file are loaded by
+	/// page faults as the view is accessed, rather than being copied into a buffer up front.
+	/// <para>
+	/// A view remains valid after the <c>mapped_file</c> which created it has been closed or destroyed.
+	/// </para>
+	/// </summary>
+	class file_view
+	{
+	public:
+		file_view(file_view const&) = delete;
+		file_view& operator=(file_view const&) = delete;
+
+		/// <summary>Constructs an empty view.</summary>
+		file_view() noexcept :
+			mBase(nullptr),
+			mData(nullptr),
+			mSize(0),
+			mOffset(0),
+			mAccess(map_access::read_only)
+		{
+		}
+
+		file_view(file_view&& Other) noexcept :
+			mBase(std::exchange(Other.mBase, nullptr)),
+			mData(std::exchange(Other.mData, nullptr)),
+			mSize(std::exchange(Other.mSize, 0)),
+			mOffset(std::exchange(Other.mOffset, 0)),
+			mAccess(std::exchange(Other.mAccess, map_access::read_only))
+		{
+		}
+
+		~file_view()
+		{
+			unmap();
+		}
+
+		file_view& operator=(file_view&& Other) noexcept
+		{
+			file_view(std::move(Other)).swap(*this);
+			return *this;
+		}
+
+		void swap(file_view& Other) noexcept
+		{
+			std::swap(mBase, Other.mBase);
+			std::swap(mData, Other.mData);
+			std::swap(mSize, Other.mSize);
+			std::swap(mOffset, Other.mOffset);
+			std::swap(mAccess, Other.mAccess);
+		}
+
+		/// <returns>A pointer to the first byte of the view, or nullptr if the view is empty.</returns>
+		[[nodiscard]] std::uint8_t const* data() const noexcept { return mData; }
+
+		/// <returns>
+		/// A pointer to the first byte of the view, through which the view may be written. The view must have been mapped with
+		/// <c>map_access::copy_on_write</c>.
+		/// </returns>
+		[[nodiscard]] std::uint8_t* mutable_data() noexcept
+		{
+			WDUL_ASSERT(mAccess == map_access::copy_on_write || !mData);
+			return mData;
+		}
+
+		/// <returns>The size of the view, in bytes.</returns>
+		[[nodiscard]] std::size_t size() const noexcept { return mSize; }
+
+		/// <returns><c>true</c> if and only if the view has no bytes.</returns>
+		[[nodiscard]] bool empty() const noexcept { return mSize == 0; }
+
+		/// <returns>The offset within the file of the first byte of the view.</returns>
+		[[nodiscard]] std::uint64_t offset() const noexcept { return mOffset; }
+
+		/// <returns>The access with which the view was mapped.</returns>
+		[[nodiscard]] map_access access() const noexcept { return mAccess; }
+
+		/// <returns>The bytes of the view.</returns>
+		[[nodiscard]] std::span<std::uint8_t const> bytes() const noexcept { return { mData, mSize }; }
+
+		/// <returns>
+		/// The bytes of the view, which may be written. The view must have been mapped with <c>map_access::copy_on_write</c>.
+		/// </returns>
+		[[nodiscard]] std::span<std::uint8_t> mutable_bytes() noexcept { return { mutable_data(), mSize }; }
+
+		/// <summary>
+		/// Asks the system to read the pages in the range [<paramref name="Offset"/>, <paramref name="Offset"/> +
+		/// <paramref name="Size"/>) of the view into memory, with large, concurrent reads, so that accessing them later does not
+		/// fault on each page. The range is clamped to the view. The function does not wait for the reads to complete.
+		/// </summary>
+		/// <param name="Offset">The offset of the range within the view, in bytes.</param>
+		/// <param name="Size">The size of the range, in bytes.</param>
+		/// <returns><c>true</c> if the request was accepted. The request is only a hint, so a failure can be ignored.</returns>
+		bool prefetch(std::size_t const Offset, std::size_t const Size) const noexcept;
+
+		/// <summary>Asks the system to read the entire view into memory. See the other overload.</summary>
+		bool prefetch() const noexcept
+		{
+			return prefetch(0, mSize);
+		}
+
+		/// <summary>Unmaps the view. The view is left empty. Pages written through a copy-on-write view are discarded.</summary>
+		void unmap() noexcept;
+
+	private:
+		friend class mapped_file;
+
+		file_view(void* const Base, std::uint8_t* const Data, std::size_t const Size, std::uint64_t const Offset,
+			map_access const Access) noexcept :
+			mBase(Base),
+			mData(Data),
+			mSize(Size),
+			mOffset(Offset),
+			mAccess(Access)
+		{
+		}
+
+		// The address returned by MapViewOfFile, which is on an allocation granularity boundary at or before mData.
+		void* mBase;
+		std::uint8_t* mData;
+		std::size_t mSize;
+		std::uint64_t mOffset;
+		map_access mAccess;
+	};
+
+	inline void swap(file_view& Lhs, file_view& Rhs) noexcept
+	{
+		Lhs.swap(Rhs);
+	}
+
+	/// <summary>
+	/// Manages a file mapping object for a file opened for reading, from which <c>file_view</c> objects are created.
+	/// <para>
+	/// Views may cover any range of the file, so a file larger than the address space the process is willing to spend on it
+	/// can be processed through a sliding window of views.
+	/// </para>
+	/// </summary>
+	class mapped_file
+	{
+	public:
+		mapped_file(mapped_file const&) = delete;
+		mapped_file& operator=(mapped_file const&) = delete;
+
+		/// <summary>Constructs an object which has no open file.</summary>
+		mapped_file() noexcept :
+			mSize(0),
+			mAccess(map_access::read_only)
+		{
+		}
+
+		/// <summary>Opens and maps the specified file. Throws an exception on failure.</summary>
+		/// <param name="Filename">Pointer to a null-terminated UTF-16 string which contains the name of the file to be mapped.</param>
+		/// <param name="Access">The access with which views of the file are mapped.</param>
+		explicit mapped_file(_In_z_ wchar_t const* const Filename, map_access const Access = map_access::read_only);
+
+		mapped_file(mapped_file&& Other) noexcept :
+			mFile(std::move(Other.mFile)),
+			mMapping(std::move(Other.mMapping)),
+			mSize(std::exchange(Other.mSize, 0)),
+			mAccess(std::exchange(Other.mAccess, map_access::read_only))
+		{
+		}
+
+		mapped_file& operator=(mapped_file&& Other) noexcept
+		{
+			mapped_file(std::move(Other)).swap(*this);
+			return *this;
+		}
+
+		void swap(mapped_file& Other) noexcept
+		{
+			mFile.swap(Other.mFile);
+			mMapping.swap(Other.mMapping);
+			std::swap(mSize, Other.mSize);
+			std::swap(mAccess, Other.mAccess);
+		}
+
+		/// <summary>
+		/// Opens and maps the specified file. If a file is already open, it is closed first. Throws an exception if the file is
+		/// opened but cannot be mapped.
+		/// </summary>
+		/// <param name="Filename">Pointer to a null-terminated UTF-16 string which contains the name of the file to be mapped.</param>
+		/// <param name="Access">The access with which views of the file are mapped.</param>
+		/// <returns>
+		/// One of the following values:<para/>
+		/// <c>fopen_code::success</c><para/>
+		/// <c>fopen_code::not_found</c><para/>
+		/// <c>fopen_code::access_denied</c><para/>
+		/// <c>fopen_code::in_use</c>
+		/// </returns>
+		[[nodiscard]] fopen_code open(_In_z_ wchar_t const* const Filename, map_access const Access = map_access::read_only);
+
+		/// <summary>Closes the file. Views which have been created remain valid.</summary>
+		void close() noexcept;
+
+		/// <returns><c>true</c> if and only if a file is open.</returns>
+		[[nodiscard]] bool is_open() const noexcept { return static_cast<bool>(mFile); }
+
+		/// <returns>The size of the file, in bytes, at the time it was opened.</returns>
+		[[nodiscard]] std::uint64_t size() const noexcept { return mSize; }
+
+		/// <returns>The access with which views of the file are mapped.</returns>
+		[[nodiscard]] map_access access() const noexcept { return mAccess; }
+
+		/// <summary>
+		/// Maps a view of the range [<paramref name="Offset"/>, <paramref name="Offset"/> + <paramref name="Size"/>) of the file.
+		/// The range is clamped to the end of the file. <paramref name="Offset"/> need not be aligned.
+		/// Throws an exception if the view cannot be mapped.
+		/// </summary>
+		/// <param name="Offset">The offset within the file of the first byte of the view.</param>
+		/// <param name="Size">The maximum size of the view, in bytes.</param>
+		[[nodiscard]] file_view view(std::uint64_t const Offset, std::size_t const Size) const;
+
+		/// <summary>
+		/// Maps a view of the entire file. Throws <c>file_too_large</c> if the file cannot fit in the address space.
+		/// </summary>
+		[[nodiscard]] file_view view() const;
+
+	private:
+		// Creates a file mapping object for File, which must be open for reading, and takes ownership of File.
+		void map(file_handle File, map_access const Access);
+
+		file_handle mFile;
+		generic_handle<invalid_handle_type::null> mMapping;
+		std::uint64_t mSize;
+		map_access mAccess;
+	};
+
+	inline void swap(mapped_file& Lhs, mapped_file& Rhs) noexcept
+	{
+		Lhs.swap(Rhs);
+	}
+
+	/// <summary>Maps a view of an entire file. Throws an exception on failure.</summary>
+	/// <param name="Filename">Pointer to a null-terminated UTF-16 string which contains the name of the file to be mapped.</param>
+	/// <param name="Access">The access with which the view is mapped.</param>
+	/// <returns>A <c>file_view</c> of the file's contents.</returns>
+	[[nodiscard]] file_view map_file(_In_z_ wchar_t const* const Filename, map_access const Access = map_access::read_only);
+}
@@ -3,6 +3,7 @@
 
 #pragma once
 #include "debug.hpp"
+#include <algorithm>
 #include <cstring>
 #include <new>
 #include <Windows.h>
@@ -33,9 +34,18 @@ namespace wdul
 		// Ptr may be nullptr, in which case, the function performs an allocation. Size must be non-zero.
 		{ T::reallocate(Ptr, Size) } -> std::same_as<void*>;
 		// Ptr may be nullptr, in which case, the function performs a zeroed allocation. Size must be non-zero.
+		// Only the bytes beyond the old size of the block are filled with zeroes; the existing contents are preserved.
 		{ T::reallocate_zeroed(Ptr, Size) } -> std::same_as<void*>;
 	};
 
+	template <class T>
+	concept has_usable_size = requires(void const* const Ptr)
+	{
+		// Returns the number of bytes which may be used in the block pointed to by Ptr, which is at least the size last requested
+		// for the block. Ptr must not be nullptr.
+		{ T::usable_size(Ptr) } -> std::same_as<std::size_t>;
+	};
+
 	template <class T>
 	concept has_deallocate_unchecked = requires(void* const Ptr)
 	{
@@ -64,6 +74,27 @@ namespace wdul
 		{ T::expand_unchecked(Ptr, Size) } -> std::same_as<void*>;
 	};
 
+	template <class T>
+	concept has_aligned_allocate = requires(void* const Ptr, std::size_t const Size, std::size_t const Alignment)
+	{
+		// Alignment must be a power of two. Size must be non-zero.
+		{ T::allocate_aligned(Size, Alignment) } -> std::same_as<void*>;
+		// Ptr may be nullptr, in which case, the function does nothing. Alignment must be that which Ptr was allocated with.
+		{ T::deallocate_aligned(Ptr, Alignment) } -> std::same_as<void>;
+		// Ptr may be nullptr, in which case, the function performs an aligned allocation. Alignment must be that which Ptr was
+		// allocated with. Size must be non-zero.
+		{ T::reallocate_aligned(Ptr, Size, Alignment) } -> std::same_as<void*>;
+	};
+
+	// The alignment, in bytes, which storage returned by every allocate_traits type in WDUL satisfies.
+	inline constexpr std::size_t default_allocation_alignment = __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+
+	// Returns true if Alignment is a power of two.
+	[[nodiscard]] constexpr bool is_valid_alignment(std::size_t const Alignment) noexcept
+	{
+		return Alignment != 0 && (Alignment & (Alignment - 1)) == 0;
+	}
+
 	// Provides a uniform interface for types which satisfy allocate_traits.
 	template <allocate_traits AllocateTraits>
 	struct allocator
@@ -139,6 +170,181 @@ namespace wdul
 		{
 			return traits_type::reallocate_zeroed(Ptr, Size);
 		}
+
+		// Attempts to resize the storage pointed to by Ptr to at least Size bytes without moving it.
+		// Returns Ptr if the storage was resized in place, otherwise returns nullptr and the storage is left unchanged.
+		// If the traits do not satisfy has_expand, the function always returns nullptr.
+		// If Ptr is nullptr, the function returns nullptr.
+		// Size must be non-zero.
+		[[nodiscard]] static void* expand([[maybe_unused]] void* const Ptr, [[maybe_unused]] std::size_t const Size) noexcept
+		{
+			if constexpr (has_expand<traits_type>)
+			{
+				return traits_type::expand(Ptr, Size);
+			}
+			else
+			{
+				WDUL_ASSERT(Size != 0);
+				return nullptr;
+			}
+		}
+
+		// Returns the number of bytes which may be used in the storage pointed to by Ptr, which is at least the size last requested
+		// for the storage.
+		// Ptr must not be nullptr, and must not have been allocated with allocate_aligned.
+		[[nodiscard]] static std::size_t usable_size(void const* const Ptr) noexcept requires has_usable_size<traits_type>
+		{
+			WDUL_ASSERT(Ptr != nullptr);
+			return traits_type::usable_size(Ptr);
+		}
+
+		// Allocates storage for Size bytes, aligned to an Alignment-byte boundary.
+		// If the traits do not satisfy has_aligned_allocate and Alignment is greater than default_allocation_alignment, a larger
+		// block is allocated and a pointer to the original block is stored immediately before the aligned storage.
+		// Storage allocated with allocate_aligned must only be deallocated with deallocate_aligned, and reallocated with
+		// reallocate_aligned or expand_aligned, with the same alignment.
+		// Alignment must be a power of two. Size must be non-zero.
+		[[nodiscard]] static void* allocate_aligned(std::size_t const Size, std::size_t const Alignment)
+		{
+			WDUL_ASSERT(is_valid_alignment(Alignment));
+			if constexpr (has_aligned_allocate<traits_type>)
+			{
+				return traits_type::allocate_aligned(Size, Alignment);
+			}
+			else
+			{
+				if (Alignment <= default_allocation_alignment)
+				{
+					return traits_type::allocate(Size);
+				}
+				return align_block(traits_type::allocate(aligned_block_size(Size, Alignment)), Alignment);
+			}
+		}
+
+		// Deallocates storage allocated with allocate_aligned or reallocate_aligned.
+		// If Ptr is nullptr, the function does nothing.
+		static void deallocate_aligned(void* const Ptr, std::size_t const Alignment) noexcept
+		{
+			WDUL_ASSERT(is_valid_alignment(Alignment));
+			if constexpr (has_aligned_allocate<traits_type>)
+			{
+				traits_type::deallocate_aligned(Ptr, Alignment);
+			}
+			else
+			{
+				if (Alignment <= default_allocation_alignment || !Ptr)
+				{
+					traits_type::deallocate(Ptr);
+					return;
+				}
+				traits_type::deallocate(original_block(Ptr));
+			}
+		}
+
+		// Reallocates storage allocated with allocate_aligned or reallocate_aligned such that the new storage size is at least
+		// Size bytes, and is aligned to an Alignment-byte boundary.
+		// If Ptr is nullptr, the function performs the equivalent of allocate_aligned.
+		// Alignment must be that which Ptr was allocated with. Size must be non-zero.
+		[[nodiscard]] static void* reallocate_aligned(void* const Ptr, std::size_t const Size, std::size_t const Alignment)
+		{
+			WDUL_ASSERT(is_valid_alignment(Alignment));
+			if constexpr (has_aligned_allocate<traits_type>)
+			{
+				return traits_type::reallocate_aligned(Ptr, Size, Alignment);
+			}
+			else
+			{
+				if (Alignment <= default_allocation_alignment)
+				{
+					return traits_type::reallocate(Ptr, Size);
+				}
+				if (!Ptr)
+				{
+					return allocate_aligned(Size, Alignment);
+				}
+				auto const oldBlock = original_block(Ptr);
+				auto const oldOffset = static_cast<std::size_t>(static_cast<std::uint8_t*>(Ptr) - static_cast<std::uint8_t*>(oldBlock));
+				auto const newBlock = static_cast<std::uint8_t*>(traits_type::reallocate(oldBlock, aligned_block_size(Size, Alignment)));
+				if (!newBlock)
+				{
+					return nullptr;
+				}
+				auto const p = newBlock + aligned_offset(newBlock, Alignment);
+				if (p != newBlock + oldOffset)
+				{
+					// The block moved to an address with a different alignment; shift the contents to the new aligned position.
+					// The range [newBlock + oldOffset, newBlock + oldOffset + Size) is always within the new block.
+					std::memmove(p, newBlock + oldOffset, Size);
+				}
+				return align_block(newBlock, Alignment);
+			}
+		}
+
+		// Attempts to resize storage allocated with allocate_aligned or reallocate_aligned to at least Size bytes without moving it.
+		// Returns Ptr if the storage was resized in place, otherwise returns nullptr and the storage is left unchanged.
+		// If Ptr is nullptr, the function returns nullptr.
+		// Alignment must be that which Ptr was allocated with. Size must be non-zero.
+		[[nodiscard]] static void* expand_aligned([[maybe_unused]] void* const Ptr, [[maybe_unused]] std::size_t const Size, std::size_t const Alignment) noexcept
+		{
+			WDUL_ASSERT(is_valid_alignment(Alignment));
+			if constexpr (has_aligned_allocate<traits_type>)
+			{
+				return nullptr;
+			}
+			else
+			{
+				if (Alignment <= default_allocation_alignment)
+				{
+					return expand(Ptr, Size);
+				}
+				if (!Ptr || Size > (std::numeric_limits<std::size_t>::max)() - Alignment - sizeof(void*))
+				{
+					return nullptr;
+				}
+				auto const block = original_block(Ptr);
+				auto const offset = static_cast<std::size_t>(static_cast<std::uint8_t*>(Ptr) - static_cast<std::uint8_t*>(block));
+				return expand(block, offset + Size) ? Ptr : nullptr;
+			}
+		}
+
+	private:
+		// Returns the size of a block which can hold Size bytes at an Alignment-byte boundary, plus a pointer to the block.
+		static std::size_t aligned_block_size(std::size_t const Size, std::size_t const Alignment)
+		{
+			if (Size > (std::numeric_limits<std::size_t>::max)() - Alignment - sizeof(void*))
+			{
+				throw std::bad_alloc();
+			}
+			return Size + Alignment - 1 + sizeof(void*);
+		}
+
+		// Returns the first Alignment-byte boundary in Block which leaves room for a pointer to Block before it, and stores the
+		// pointer. If Block is nullptr, returns nullptr.
+		static void* align_block(void* const Block, std::size_t const Alignment) noexcept
+		{
+			if (!Block)
+			{
+				return nullptr;
+			}
+			auto const p = static_cast<std::uint8_t*>(Block) + aligned_offset(Block, Alignment);
+			std::memcpy(p - sizeof(void*), &Block, sizeof(void*));
+			return p;
+		}
+
+		// Returns the offset of the aligned storage within Block.
+		static std::size_t aligned_offset(void const* const Block, std::size_t const Alignment) noexcept
+		{
+			auto const address = reinterpret_cast<std::uintptr_t>(Block);
+			return static_cast<std::size_t>(((address + sizeof(void*) + Alignment - 1) & ~(Alignment - 1)) - address);
+		}
+
+		// Returns the pointer stored by align_block.
+		static void* original_block(void* const Ptr) noexcept
+		{
+			void* block;
+			std::memcpy(&block, static_cast<std::uint8_t*>(Ptr) - sizeof(void*), sizeof(void*));
+			return block;
+		}
 	};
 
 	struct malloc_traits
@@ -154,9 +360,9 @@ namespace wdul
 		[[nodiscard]] static void* allocate_zeroed(std::size_t const Size)
 		{
 			WDUL_ASSERT(Size != 0);
-			auto const p = std::malloc(Size);
+			// calloc can skip zeroing storage which is fresh from the operating system, and therefore already zeroed.
+			auto const p = std::calloc(1, Size);
 			if (!p) throw std::bad_alloc();
-			std::memset(p, 0, Size);
 			return p;
 		}
 
@@ -176,9 +382,47 @@ namespace wdul
 		[[nodiscard]] static void* reallocate_zeroed(void* const Ptr, std::size_t const Size)
 		{
 			WDUL_ASSERT(Size != 0);
-			auto const p = std::realloc(Ptr, Size);
+			if (!Ptr)
+			{
+				return allocate_zeroed(Size);
+			}
+			// Only the grown tail is zeroed, so growing a zeroed block step by step does not rewrite the bytes before it.
+			auto const oldSize = usable_size(Ptr);
+			auto const p = static_cast<std::uint8_t*>(std::realloc(Ptr, Size));
+			if (!p) throw std::bad_alloc();
+			if (Size > oldSize)
+			{
+				std::memset(p + oldSize, 0, Size - oldSize);
+			}
+			return p;
+		}
+
+		// The CRT's _msize returns the size last requested for the block, so there are no uninitialised bytes between the
+		// requested size and the usable size.
+		[[nodiscard]] static std::size_t usable_size(void const* const Ptr) noexcept
+		{
+			WDUL_ASSERT(Ptr != nullptr);
+			return _msize(const_cast<void*>(Ptr));
+		}
+
+		[[nodiscard]] static void* allocate_aligned(std::size_t const Size, std::size_t const Alignment)
+		{
+			WDUL_ASSERT(Size != 0);
+			auto const p = _aligned_malloc(Size, Alignment);
+			if (!p) throw std::bad_alloc();
+			return p;
+		}
+
+		static void deallocate_aligned(void* const Ptr, std::size_t) noexcept
+		{
+			_aligned_free(Ptr);
+		}
+
+		[[nodiscard]] static void* reallocate_aligned(void* const Ptr, std::size_t const Size, std::size_t const Alignment)
+		{
+			WDUL_ASSERT(Size != 0);
+			auto const p = _aligned_realloc(Ptr, Size, Alignment);
 			if (!p) throw std::bad_alloc();
-			std::memset(p, 0, Size);
 			return p;
 		}
 	};
@@ -247,6 +491,12 @@ namespace wdul
 		{
 			return reallocate_fixed(Ptr, Size);
 		}
+
+		[[nodiscard]] static std::size_t usable_size(void const* const Ptr) noexcept
+		{
+			WDUL_ASSERT(Ptr != nullptr);
+			return LocalSize(const_cast<void*>(Ptr));
+		}
 	};
 	using local_allocator = allocator<local_alloc_traits>;
 
@@ -314,9 +564,99 @@ namespace wdul
 			WDUL_ASSERT(Size != 0);
 			return reallocate_fixed(Ptr, Size);
 		}
+
+		[[nodiscard]] static std::size_t usable_size(void const* const Ptr) noexcept
+		{
+			WDUL_ASSERT(Ptr != nullptr);
+			return HeapSize(GetProcessHeap(), 0, Ptr);
+		}
 	};
 	using heap_allocator = allocator<heap_alloc_traits>;
 
+	namespace impl
+	{
+		[[nodiscard]] void* pool_allocate(std::size_t const Size);
+		[[nodiscard]] void* pool_allocate_zeroed(std::size_t const Size);
+		void pool_deallocate(void* const Ptr) noexcept;
+		[[nodiscard]] void* pool_reallocate(void* const Ptr, std::size_t const Size);
+		[[nodiscard]] void* pool_expand(void* const Ptr, std::size_t const Size) noexcept;
+		[[nodiscard]] std::size_t pool_size(void const* const Ptr) noexcept;
+	}
+
+	// Serves small allocations from segregated size-class slabs, and forwards larger allocations to malloc.
+	//
+	// Each thread caches freed blocks in a free list per size class, so most allocations and deallocations do not take a lock.
+	// When a thread's cache grows too large, or the thread exits, blocks are moved in batches to a shared depot, from which
+	// other threads refill their caches. Storage may therefore be deallocated on any thread.
+	//
+	// Slabs are never returned to the operating system.
+	struct pool_alloc_traits
+	{
+		// The largest size, in bytes, which is served from a slab rather than forwarded to malloc.
+		static constexpr std::size_t max_small_size = 1024 - default_allocation_alignment;
+
+		[[nodiscard]] static void* allocate(std::size_t const Size)
+		{
+			WDUL_ASSERT(Size != 0);
+			return impl::pool_allocate(Size);
+		}
+
+		[[nodiscard]] static void* allocate_zeroed(std::size_t const Size)
+		{
+			WDUL_ASSERT(Size != 0);
+			return impl::pool_allocate_zeroed(Size);
+		}
+
+		static void deallocate(void* const Ptr) noexcept
+		{
+			if (Ptr)
+			{
+				impl::pool_deallocate(Ptr);
+			}
+		}
+
+		static void deallocate_unchecked(void* const Ptr) noexcept
+		{
+			WDUL_ASSERT(Ptr != nullptr);
+			impl::pool_deallocate(Ptr);
+		}
+
+		[[nodiscard]] static void* reallocate(void* const Ptr, std::size_t const Size)
+		{
+			WDUL_ASSERT(Size != 0);
+			return impl::pool_reallocate(Ptr, Size);
+		}
+
+		[[nodiscard]] static void* reallocate_zeroed(void* const Ptr, std::size_t const Size)
+		{
+			WDUL_ASSERT(Size != 0);
+			if (!Ptr)
+			{
+				return allocate_zeroed(Size);
+			}
+			auto const oldSize = impl::pool_size(Ptr);
+			auto const p = static_cast<std::uint8_t*>(impl::pool_reallocate(Ptr, Size));
+			if (Size > oldSize)
+			{
+				std::memset(p + oldSize, 0, Size - oldSize);
+			}
+			return p;
+		}
+
+		[[nodiscard]] static void* expand(void* const Ptr, std::size_t const Size) noexcept
+		{
+			WDUL_ASSERT(Size != 0);
+			return impl::pool_expand(Ptr, Size);
+		}
+
+		[[nodiscard]] static std::size_t usable_size(void const* const Ptr) noexcept
+		{
+			WDUL_ASSERT(Ptr != nullptr);
+			return impl::pool_size(Ptr);
+		}
+	};
+	using pool_allocator = allocator<pool_alloc_traits>;
+
 	// Returns the size, in bytes, of Count objects of type T.
 	// Throws std::bad_array_new_length if the result of the calculation cannot fit into the unsigned integral type SizeT.
 	template <cv_unqualified T, std::unsigned_integral SizeT = std::size_t>
@@ -332,30 +672,58 @@ namespace wdul
 		return Count * sizeof(T);
 	}
 
-	/// <summary>Manages a dynamically allocated array of bytes. Stores a pointer to that array, and the size of that array.</summary>
+	/// <summary>
+	/// Manages a dynamically allocated array of bytes. Stores a pointer to that array, the size of that array, and the capacity
+	/// of the storage allocated for that array.
+	/// <para>
+	/// When the array grows beyond its capacity, the storage is first resized in place (see <c>allocator::expand</c>), and is only
+	/// moved to new storage if that fails. The capacity grows geometrically, so repeatedly appending to the array runs in
+	/// amortised linear time.
+	/// </para>
+	/// </summary>
 	/// <typeparam name="AllocT">Allocator traits which specify how to allocate and deallocate storage.</typeparam>
-	template <allocate_traits AllocT>
+	/// <typeparam name="Alignment">
+	/// The alignment of the data buffer, in bytes, or zero for the default alignment of <typeparamref name="AllocT"/>.
+	/// Must be zero or a power of two.
+	/// </typeparam>
+	template <allocate_traits AllocT, std::size_t Alignment = 0>
 	class basic_byte_array
 	{
+		static_assert(Alignment == 0 || is_valid_alignment(Alignment), "Alignment must be zero or a power of two");
+
 	public:
 		using allocator = allocator<AllocT>;
 
+		/// <summary>The alignment of the data buffer, in bytes, or zero for the default alignment.</summary>
+		static constexpr std::size_t alignment = Alignment;
+
 		/// <summary>Constructs a <c>basic_byte_array</c> with an empty data buffer.</summary>
 		basic_byte_array() noexcept :
-			mData(nullptr), mSize(0)
+			mData(nullptr), mSize(0), mCapacity(0)
+		{
+		}
+
+		/// <summary>Constructs a <c>basic_byte_array</c> with an uninitialised data buffer of the given size.</summary>
+		/// <param name="Size">The size of the data buffer, in bytes. If zero, the data buffer is empty.</param>
+		explicit basic_byte_array(std::size_t const Size) :
+			mData(Size != 0 ? allocate_storage(Size) : nullptr),
+			mSize(Size),
+			mCapacity(Size)
 		{
 		}
 
 		/// <summary>
 		/// Constructs a <c>basic_byte_array</c> with the given size and data buffer.
 		/// <para>The <c>basic_byte_array</c> will take ownership of the given data buffer. Ensure the data buffer was allocated appropriately.</para>
+		/// <para>If <typeparamref name="Alignment"/> is non-zero, the data buffer must have been allocated with <c>allocator::allocate_aligned</c>.</para>
 		/// </summary>
 		/// <param name="Size">The size of the data buffer pointed to by <paramref name="Data"/>.</param>
 		/// <param name="Data">A pointer to the data buffer (an array of bytes), or <c>nullptr</c>.</param>
 		/// <remarks>If <paramref name="Size"/> is zero, <paramref name="Data"/> must be <c>nullptr</c>, and vise-versa.</remarks>
 		basic_byte_array(std::size_t const Size, _In_reads_opt_(Size) std::uint8_t* const Data, take_ownership_t) noexcept :
 			mData(Data),
-			mSize(Size)
+			mSize(Size),
+			mCapacity(Size)
 		{
 		}
 
@@ -364,12 +732,13 @@ namespace wdul
 		basic_byte_array(basic_byte_array const& Other)
 		{
 			mSize = Other.mSize;
+			mCapacity = Other.mSize;
 			if (mSize == 0)
 			{
 				mData = nullptr;
 				return;
 			}
-			mData = static_cast<std::uint8_t*>(allocator::allocate(Other.mSize));
+			mData = allocate_storage(Other.mSize);
 			std::memcpy(mData, Other.mData, mSize);
 		}
 
@@ -377,13 +746,14 @@ namespace wdul
 		/// <param name="Other">A reference to the object to move data from. The data buffer held by <paramref name="Other"/> will be emptied.</param>
 		basic_byte_array(basic_byte_array&& Other) noexcept :
 			mData(std::exchange(Other.mData, nullptr)),
-			mSize(std::exchange(Other.mSize, 0))
+			mSize(std::exchange(Other.mSize, 0)),
+			mCapacity(std::exchange(Other.mCapacity, 0))
 		{
 		}
 
 		~basic_byte_array()
 		{
-			allocator::deallocate(mData);
+			deallocate_storage(mData);
 		}
 
 		/// <summary>Copies the contents of <paramref name="Other"/> to this object.</summary>
@@ -394,12 +764,13 @@ namespace wdul
 			std::uint8_t* newData = nullptr;
 			if (Other.mSize != 0)
 			{
-				newData = static_cast<std::uint8_t*>(allocator::allocate(Other.mSize));
+				newData = allocate_storage(Other.mSize);
 				std::memcpy(newData, Other.mData, Other.mSize);
 			}
-			allocator::deallocate(mData);
+			deallocate_storage(mData);
 			mData = newData;
 			mSize = Other.mSize;
+			mCapacity = Other.mSize;
 			return *this;
 		}
 
@@ -412,10 +783,10 @@ namespace wdul
 		basic_byte_array& operator=(basic_byte_array&& Other) noexcept
 		{
 			auto const newData = std::exchange(Other.mData, nullptr);
-			allocator::deallocate(mData);
+			deallocate_storage(mData);
 			mData = newData;
-			mSize = Other.mSize;
-			Other.mSize = 0;
+			mSize = std::exchange(Other.mSize, 0);
+			mCapacity = std::exchange(Other.mCapacity, 0);
 			return *this;
 		}
 
@@ -425,6 +796,7 @@ namespace wdul
 		{
 			std::swap(mData, Other.mData);
 			std::swap(mSize, Other.mSize);
+			std::swap(mCapacity, Other.mCapacity);
 		}
 
 		/// <returns>A pointer to the data buffer (an array of bytes).</returns>
@@ -439,20 +811,234 @@ namespace wdul
 			return mSize;
 		}
 
+		/// <returns>The number of bytes the data buffer can hold without reallocating.</returns>
+		[[nodiscard]] auto capacity() const noexcept
+		{
+			return mCapacity;
+		}
+
+		/// <returns><c>true</c> if and only if the size of the data buffer is zero.</returns>
+		[[nodiscard]] bool empty() const noexcept
+		{
+			return mSize == 0;
+		}
+
+		/// <summary>
+		/// Ensures the data buffer can hold at least <paramref name="Capacity"/> bytes without reallocating.
+		/// If <paramref name="Capacity"/> is not greater than the current capacity, the function does nothing.
+		/// </summary>
+		/// <param name="Capacity">The minimum capacity, in bytes.</param>
+		void reserve(std::size_t const Capacity)
+		{
+			if (Capacity > mCapacity)
+			{
+				set_capacity(Capacity);
+			}
+		}
+
+		/// <summary>
+		/// Changes the size of the data buffer. If the size increases, the bytes beyond the old size are uninitialised.
+		/// </summary>
+		/// <param name="Size">The new size of the data buffer, in bytes.</param>
+		void resize(std::size_t const Size)
+		{
+			if (Size > mCapacity)
+			{
+				grow(Size);
+			}
+			mSize = Size;
+		}
+
+		/// <summary>
+		/// Changes the size of the data buffer. If the size increases, the bytes beyond the old size are set to <paramref name="Value"/>.
+		/// </summary>
+		/// <param name="Size">The new size of the data buffer, in bytes.</param>
+		/// <param name="Value">The value to give each new byte.</param>
+		void resize(std::size_t const Size, std::uint8_t const Value)
+		{
+			auto const oldSize = mSize;
+			resize(Size);
+			if (Size > oldSize)
+			{
+				std::memset(mData + oldSize, Value, Size - oldSize);
+			}
+		}
+
+		/// <summary>Appends a copy of the bytes in the range [<paramref name="Data"/>, <paramref name="Data"/> + <paramref name="Size"/>).</summary>
+		/// <param name="Data">Pointer to the bytes to append. May point into this array's data buffer.</param>
+		/// <param name="Size">The number of bytes to append.</param>
+		void append(_In_reads_bytes_(Size) void const* const Data, std::size_t const Size)
+		{
+			if (Size == 0)
+			{
+				return;
+			}
+			auto src = static_cast<std::uint8_t const*>(Data);
+			if (mSize + Size > mCapacity || mSize + Size < mSize)
+			{
+				if (src >= mData && src < mData + mCapacity)
+				{
+					// The source is within this array; it must be found again after the data buffer is reallocated.
+					auto const offset = static_cast<std::size_t>(src - mData);
+					grow(checked_add(mSize, Size));
+					src = mData + offset;
+				}
+				else
+				{
+					grow(checked_add(mSize, Size));
+				}
+			}
+			std::memcpy(mData + mSize, src, Size);
+			mSize += Size;
+		}
+
+		/// <summary>
+		/// Increases the size of the data buffer by <paramref name="Size"/> bytes, leaving the new bytes uninitialised.
+		/// Use this to write directly into the end of the array, for example, as the destination of <c>fread</c>.
+		/// </summary>
+		/// <param name="Size">The number of bytes to append.</param>
+		/// <returns>A pointer to the first appended byte.</returns>
+		[[nodiscard]] std::uint8_t* append_uninitialized(std::size_t const Size)
+		{
+			auto const oldSize = mSize;
+			resize(checked_add(mSize, Size));
+			return mData + oldSize;
+		}
+
+		/// <summary>Sets the size of the data buffer to zero. The capacity is unchanged.</summary>
+		void clear() noexcept
+		{
+			mSize = 0;
+		}
+
+		/// <summary>Reduces the capacity to the size of the data buffer.</summary>
+		void shrink_to_fit()
+		{
+			if (mCapacity == mSize)
+			{
+				return;
+			}
+			if (mSize == 0)
+			{
+				deallocate_storage(std::exchange(mData, nullptr));
+				mCapacity = 0;
+				return;
+			}
+			set_capacity(mSize);
+		}
+
 	private:
+		static std::size_t checked_add(std::size_t const Lhs, std::size_t const Rhs)
+		{
+			if (Lhs > (std::numeric_limits<std::size_t>::max)() - Rhs)
+			{
+				throw std::bad_array_new_length();
+			}
+			return Lhs + Rhs;
+		}
+
+		// Increases the capacity to at least MinCapacity, growing geometrically.
+		void grow(std::size_t const MinCapacity)
+		{
+			auto const geometric = mCapacity + mCapacity / 2;
+			set_capacity((std::max)(MinCapacity, geometric < mCapacity ? MinCapacity : geometric));
+		}
+
+		// Sets the capacity to exactly Capacity, which must be non-zero and not less than the size.
+		// The storage is resized in place if possible, otherwise it is reallocated.
+		void set_capacity(std::size_t const Capacity)
+		{
+			WDUL_ASSERT(Capacity != 0 && Capacity >= mSize);
+			if (!mData)
+			{
+				mData = allocate_storage(Capacity);
+			}
+			else if (!expand_storage(mData, Capacity))
+			{
+				mData = reallocate_storage(mData, Capacity);
+			}
+			mCapacity = Capacity;
+		}
+
+		static std::uint8_t* allocate_storage(std::size_t const Size)
+		{
+			void* p;
+			if constexpr (Alignment != 0)
+			{
+				p = allocator::allocate_aligned(Size, Alignment);
+			}
+			else
+			{
+				p = allocator::allocate(Size);
+			}
+			if (!p)
+			{
+				throw std::bad_alloc();
+			}
+			return static_cast<std::uint8_t*>(p);
+		}
+
+		static void* expand_storage(std::uint8_t* const Data, std::size_t const Size) noexcept
+		{
+			if constexpr (Alignment != 0)
+			{
+				return allocator::expand_aligned(Data, Size, Alignment);
+			}
+			else
+			{
+				return allocator::expand(Data, Size);
+			}
+		}
+
+		static std::uint8_t* reallocate_storage(std::uint8_t* const Data, std::size_t const Size)
+		{
+			void* p;
+			if constexpr (Alignment != 0)
+			{
+				p = allocator::reallocate_aligned(Data, Size, Alignment);
+			}
+			else
+			{
+				p = allocator::reallocate(Data, Size);
+			}
+			if (!p)
+			{
+				throw std::bad_alloc();
+			}
+			return static_cast<std::uint8_t*>(p);
+		}
+
+		static void deallocate_storage(std::uint8_t* const Data) noexcept
+		{
+			if constexpr (Alignment != 0)
+			{
+				allocator::deallocate_aligned(Data, Alignment);
+			}
+			else
+			{
+				allocator::deallocate(Data);
+			}
+		}
+
 		std::uint8_t* mData;
 		std::size_t mSize;
+		std::size_t mCapacity;
 	};
 
 	/// <summary>Swaps the contents of <paramref name="Lhs"/> with that of <paramref name="Rhs"/>.</summary>
 	/// <typeparam name="AllocT">Allocator traits.</typeparam>
+	/// <typeparam name="Alignment">The alignment of the data buffers.</typeparam>
 	/// <param name="Lhs">A reference to the first object.</param>
 	/// <param name="Rhs">A reference to the second object.</param>
-	template <allocate_traits AllocT>
-	inline void swap(basic_byte_array<AllocT>& Lhs, basic_byte_array<AllocT>& Rhs) noexcept
+	template <allocate_traits AllocT, std::size_t Alignment>
+	inline void swap(basic_byte_array<AllocT, Alignment>& Lhs, basic_byte_array<AllocT, Alignment>& Rhs) noexcept
 	{
 		Lhs.swap(Rhs);
 	}
 
 	using byte_array = basic_byte_array<malloc_traits>;
+
+	// A byte_array whose data buffer is aligned to an Alignment-byte boundary, such as a cache line (64) or a page (4096).
+	template <std::size_t Alignment>
+	using aligned_byte_array = basic_byte_array<malloc_traits, Alignment>;
 }
@@ -0,0 +1,110 @@
+// This file is part of the WillDaisey/WDUL (Windows Desktop Utility Library) project.
+// View this project on github: https://github.com/WillDaisey/wdul/
+
+#pragma once
+#include "memory.hpp"
+#include "arena.hpp"
+#include <memory_resource>
+
+namespace wdul
+{
+	/// <summary>
+	/// A <c>std::pmr::memory_resource</c> which allocates storage with <typeparamref name="AllocT"/>, so that standard
+	/// containers using <c>std::pmr::polymorphic_allocator</c> can allocate from any WDUL allocator.
+	/// <para>Over-aligned requests are served by <c>allocator::allocate_aligned</c>.</para>
+	/// </summary>
+	/// <typeparam name="AllocT">Allocator traits used to allocate storage.</typeparam>
+	template <allocate_traits AllocT>
+	class allocator_resource final : public std::pmr::memory_resource
+	{
+	public:
+		using allocator_type = allocator<AllocT>;
+
+	private:
+		void* do_allocate(std::size_t const Bytes, std::size_t const Alignment) override
+		{
+			auto const p = allocator_type::allocate_aligned((std::max)(Bytes, std::size_t(1)), Alignment);
+			if (!p)
+			{
+				throw std::bad_alloc();
+			}
+			return p;
+		}
+
+		void do_deallocate(void* const Ptr, std::size_t, std::size_t const Alignment) override
+		{
+			allocator_type::deallocate_aligned(Ptr, Alignment);
+		}
+
+		bool do_is_equal(std::pmr::memory_resource const& Other) const noexcept override
+		{
+			// Allocator traits have no per-object state, so any instance can deallocate storage allocated by another.
+			return dynamic_cast<allocator_resource const*>(&Other) != nullptr;
+		}
+	};
+
+	// Returns a pointer to a memory resource which allocates storage with AllocT.
+	// The memory resource is never destroyed, so it may be used by objects with static storage duration.
+	template <allocate_traits AllocT>
+	[[nodiscard]] std::pmr::memory_resource* get_allocator_resource() noexcept
+	{
+		static auto const inst = new allocator_resource<AllocT>();
+		return inst;
+	}
+
+	/// <summary>
+	/// A <c>std::pmr::memory_resource</c> which allocates storage from a particular arena. Deallocation only returns storage to
+	/// the arena if the storage is the most recently allocated block; see <c>basic_monotonic_arena::deallocate</c>.
+	/// </summary>
+	/// <typeparam name="ArenaT">The arena type, such as <c>monotonic_arena</c>.</typeparam>
+	template <class ArenaT>
+	class basic_arena_resource final : public std::pmr::memory_resource
+	{
+	public:
+		/// <summary>Constructs a memory resource which allocates from <paramref name="Arena"/>.</summary>
+		/// <param name="Arena">The arena. Must outlive the memory resource, and every object which allocates from it.</param>
+		explicit basic_arena_resource(ArenaT& Arena) noexcept :
+			mArena(Arena)
+		{
+		}
+
+		/// <summary>Returns the arena from which storage is allocated.</summary>
+		[[nodiscard]] ArenaT& arena() const noexcept
+		{
+			return mArena;
+		}
+
+	private:
+		void* do_allocate(std::size_t const Bytes, std::size_t const Alignment) override
+		{
+			if (Alignment <= ArenaT::alignment)
+			{
+				return mArena.allocate((std::max)(Bytes, std::size_t(1)));
+			}
+			if (Bytes > (std::numeric_limits<std::size_t>::max)() - Alignment)
+			{
+				throw std::bad_alloc();
+			}
+			auto const p = reinterpret_cast<std::uintptr_t>(mArena.allocate(Bytes + Alignment - ArenaT::alignment));
+			return reinterpret_cast<void*>((p + Alignment - 1) & ~(std::uintptr_t(Alignment) - 1));
+		}
+
+		void do_deallocate(void* const Ptr, std::size_t, std::size_t const Alignment) override
+		{
+			// Over-aligned blocks may not begin at the pointer returned by the arena, so they are never returned to the arena.
+			if (Alignment <= ArenaT::alignment)
+			{
+				mArena.deallocate(Ptr);
+			}
+		}
+
+		bool do_is_equal(std::pmr::memory_resource const& Other) const noexcept override
+		{
+			return this == &Other;
+		}
+
+		ArenaT& mArena;
+	};
+
+	using arena_resource = basic_arena_resource<monotonic_arena>;
+}
@@ -2,7 +2,13 @@
 // View this project on github: https://github.com/WillDaisey/wdul/
 
 #pragma once
+#include "utility.hpp"
+#include <bit>
 #include <cstdlib>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
 
 namespace wdul
 {
@@ -39,5 +45,294 @@ namespace wdul
 	// its entirety, the range of characters in the buffer which match that of the delimiter are returned.
 	//
 	// Otherwise, an empty range is returned.
+	//
+	// If the delimiter was not found in its entirety, the returned range is the longest substring at the end of the buffer
+	// which matches the start of the delimiter, so that the search can be resumed once more characters are available.
+	//
+	// The buffer is scanned with SSE2 or AVX2 instructions when the processor supports them. Candidate positions are compared
+	// with the whole delimiter, so a delimiter which overlaps itself (such as "aab") can make the search quadratic in the
+	// worst case. Use delimiter_matcher to search a stream in linear time.
 	range<char8_t const> find_delimiter(range<char8_t const> const Buffer, range<char8_t const> const Delim) noexcept;
+
+	/// <summary>
+	/// Searches a stream of characters, which is provided in chunks, for a delimiter. A partial match at the end of one chunk
+	/// is carried over to the next, so the delimiter is found regardless of where the chunk boundaries fall.
+	/// <para>
+	/// The matcher uses the Knuth-Morris-Pratt algorithm: a failure table is computed once for the delimiter, after which each
+	/// character of the stream is examined a bounded number of times, so searching takes time linear in the length of the
+	/// stream. While nothing is matched, the stream is scanned for the first character of the delimiter with find_delimiter.
+	/// </para>
+	/// <para>
+	/// The matcher refers to the delimiter, which must outlive it.
+	/// </para>
+	/// </summary>
+	class delimiter_matcher
+	{
+	public:
+		/// <param name="Delim">The delimiter. Must not be empty.</param>
+		explicit delimiter_matcher(range<char8_t const> const Delim);
+
+		/// <summary>
+		/// Continues the search with the characters in <paramref name="Chunk"/>, which follow the characters of the previous
+		/// chunks in the stream. The characters before the returned pointer are consumed; if the delimiter was found, the match
+		/// is reset, so the search can continue after it with the remaining characters.
+		/// </summary>
+		/// <returns>
+		/// A pointer to the character following the delimiter if the delimiter was completed within <paramref name="Chunk"/>,
+		/// otherwise nullptr. The delimiter may begin in a previous chunk.
+		/// </returns>
+		[[nodiscard]] char8_t const* feed(range<char8_t const> const Chunk) noexcept;
+
+		/// <returns>
+		/// The number of characters at the end of the stream which match the start of the delimiter. Always less than the size of
+		/// the delimiter.
+		/// </returns>
+		[[nodiscard]] std::size_t matched() const noexcept { return mMatched; }
+
+		/// <returns>The size of the delimiter.</returns>
+		[[nodiscard]] std::size_t size() const noexcept { return static_cast<std::size_t>(mDelim.last - mDelim.first); }
+
+		/// <summary>Discards the partial match, so that the next chunk is searched as the start of a new stream.</summary>
+		void reset() noexcept { mMatched = 0; }
+
+	private:
+		static constexpr std::size_t inline_capacity = 16;
+
+		[[nodiscard]] std::uint32_t* failure() noexcept
+		{
+			return size() <= inline_capacity ? mInlineFailure : mHeapFailure.data();
+		}
+
+		range<char8_t const> mDelim;
+		std::size_t mMatched;
+
+		// failure()[i] is the length of the longest proper prefix of the delimiter which is also a suffix of the first i + 1
+		// characters of the delimiter. Delimiters longer than inline_capacity store the table on the heap.
+		std::uint32_t mInlineFailure[inline_capacity];
+		std::vector<std::uint32_t> mHeapFailure;
+	};
+
+	// A set of characters, for use with find_first_of.
+	class char_set
+	{
+	public:
+		constexpr char_set() noexcept :
+			mBits{}
+		{
+		}
+
+		constexpr char_set(std::u8string_view const Chars) noexcept :
+			mBits{}
+		{
+			for (auto const ch : Chars)
+			{
+				insert(ch);
+			}
+		}
+
+		constexpr void insert(char8_t const Ch) noexcept
+		{
+			mBits[Ch >> 6] |= std::uint64_t(1) << (Ch & 63);
+		}
+
+		[[nodiscard]] constexpr bool contains(char8_t const Ch) const noexcept
+		{
+			return (mBits[Ch >> 6] >> (Ch & 63)) & 1;
+		}
+
+		[[nodiscard]] constexpr bool empty() const noexcept
+		{
+			return (mBits[0] | mBits[1] | mBits[2] | mBits[3]) == 0;
+		}
+
+		// Writes up to MaxCount characters of the set to Chars, in ascending order. Returns the number of characters written.
+		constexpr std::size_t copy(char8_t* const Chars, std::size_t const MaxCount) const noexcept
+		{
+			std::size_t count = 0;
+			for (std::size_t i = 0; i != 4; ++i)
+			{
+				for (auto bits = mBits[i]; bits != 0 && count != MaxCount; bits &= bits - 1)
+				{
+					Chars[count++] = static_cast<char8_t>(i * 64 + static_cast<std::size_t>(std::countr_zero(bits)));
+				}
+			}
+			return count;
+		}
+
+	private:
+		std::uint64_t mBits[4];
+	};
+
+	// Returns a pointer to the first character in the buffer specified by the range [Buffer.first, Buffer.last) which is in
+	// Set, or Buffer.last if there is no such character.
+	//
+	// Sets of up to four characters are scanned by comparing against each character with SSE2 or AVX2 instructions. Larger
+	// sets are classified by the high and low four bits of each character with AVX2 instructions, when the processor
+	// supports them.
+	[[nodiscard]] char8_t const* find_first_of(range<char8_t const> const Buffer, char_set const& Set) noexcept;
+
+	// Describes a match found by delimiter_set_matcher. Offsets are relative to the start of the stream.
+	struct delimiter_set_match
+	{
+		// The index of the delimiter which was found.
+		std::size_t delimiter;
+
+		// The offset of the first character of the delimiter.
+		std::uint64_t first;
+
+		// The offset of the character following the delimiter.
+		std::uint64_t last;
+	};
+
+	/// <summary>
+	/// A set of delimiters compiled into an Aho-Corasick automaton, for use with <c>delimiter_set_matcher</c>. The automaton is
+	/// immutable, so it can be built once and shared by any number of matchers and threads.
+	/// <para>
+	/// Each state has a transition for every character, so that the stream is searched with one table lookup per character.
+	/// The table has 256 entries for every prefix of every delimiter, so the set is intended for a few short delimiters, such
+	/// as new lines or record separators.
+	/// </para>
+	/// </summary>
+	class delimiter_set
+	{
+	public:
+		// Returned by functions which report the index of a delimiter, when no delimiter was found.
+		static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+		/// <param name="Delims">The delimiters. Must not be empty, nor contain an empty delimiter.</param>
+		explicit delimiter_set(std::span<std::u8string_view const> const Delims);
+
+		/// <returns>The number of delimiters in the set.</returns>
+		[[nodiscard]] std::size_t size() const noexcept { return mSizes.size(); }
+
+		/// <returns>The size of the delimiter at <paramref name="Index"/>.</returns>
+		[[nodiscard]] std::size_t delimiter_size(std::size_t const Index) const noexcept { return mSizes[Index]; }
+
+		/// <returns>The size of the longest delimiter.</returns>
+		[[nodiscard]] std::size_t max_size() const noexcept { return mMaxSize; }
+
+	private:
+		friend class delimiter_set_matcher;
+
+		static constexpr std::uint32_t no_output = static_cast<std::uint32_t>(-1);
+
+		struct state
+		{
+			// The length of the prefix this state represents.
+			std::uint32_t depth;
+
+			// The depth of the longest suffix of this state's prefix (including the prefix itself) which can be extended by
+			// another character. Any match which is yet to be completed begins at most this many characters before the end of
+			// the stream.
+			std::uint32_t extendable_depth;
+
+			// The index of the longest delimiter which is a suffix of this state's prefix, or no_output.
+			std::uint32_t output;
+		};
+
+		// The state to move to from state S upon character C is mNext[S * 256 + C]. State zero is the initial state.
+		std::vector<std::uint32_t> mNext;
+		std::vector<state> mStates;
+		std::vector<std::size_t> mSizes;
+		std::size_t mMaxSize;
+
+		// The first character of every delimiter. Skipped to with find_first_of while nothing is matched.
+		char_set mFirst;
+	};
+
+	/// <summary>
+	/// Searches a stream of characters, which is provided in chunks, for any of the delimiters in a <c>delimiter_set</c>.
+	/// <para>
+	/// The match which begins first is reported, and of the delimiters which begin there, the longest. For example, with the
+	/// delimiters CR+LF, LF and CR, a CR followed by an LF is a single CR+LF delimiter. A match is therefore only reported once
+	/// no longer delimiter can begin at the same place, which may be after further characters have been searched: the matcher
+	/// then rewinds to the end of the match, and the characters which follow it must be provided again.
+	/// </para>
+	/// <para>
+	/// The matcher refers to the delimiter set, which must outlive it.
+	/// </para>
+	/// </summary>
+	class delimiter_set_matcher
+	{
+	public:
+		explicit delimiter_set_matcher(delimiter_set const& Delims) noexcept :
+			mDelims(&Delims),
+			mPosition(0),
+			mState(0),
+			mHasCandidate(false),
+			mCandidate{}
+		{
+		}
+
+		/// <summary>
+		/// Continues the search with the characters in <paramref name="Chunk"/>, which begin at offset <c>position()</c> of the
+		/// stream.
+		/// <para>
+		/// If a match is found, it is written to <paramref name="Match"/>, and the position of the matcher is set to the end of
+		/// the match, which may be before the end of the characters provided so far, or before the start of
+		/// <paramref name="Chunk"/>. The search continues with the characters from the end of the match.
+		/// </para>
+		/// </summary>
+		/// <returns><c>true</c> if and only if a match was found.</returns>
+		[[nodiscard]] bool feed(range<char8_t const> const Chunk, delimiter_set_match& Match) noexcept;
+
+		/// <summary>
+		/// Ends the stream. A delimiter which was found, but was not reported because a longer delimiter could still have
+		/// begun at the same place, is reported as in <c>feed</c>.
+		/// </summary>
+		/// <returns><c>true</c> if and only if a match was found.</returns>
+		[[nodiscard]] bool finish(delimiter_set_match& Match) noexcept;
+
+		/// <returns>The offset within the stream of the next character to provide.</returns>
+		[[nodiscard]] std::uint64_t position() const noexcept { return mPosition; }
+
+		/// <returns>
+		/// The number of characters at the end of the characters provided so far which may be part of a match that has not been
+		/// reported. Always less than the size of the longest delimiter.
+		/// </returns>
+		[[nodiscard]] std::size_t pending() const noexcept;
+
+		/// <summary>Discards any partial match, and sets the position to zero, so that a new stream can be searched.</summary>
+		void reset() noexcept
+		{
+			mPosition = 0;
+			mState = 0;
+			mHasCandidate = false;
+		}
+
+	private:
+		delimiter_set const* mDelims;
+		std::uint64_t mPosition;
+		std::uint32_t mState;
+
+		// The leftmost, then longest, match found which has not yet been reported.
+		bool mHasCandidate;
+		delimiter_set_match mCandidate;
+	};
+
+	// Returns a delimiter set of the new line sequences CR+LF, LF and CR, at indices 0, 1 and 2, respectively.
+	[[nodiscard]] delimiter_set const& newline_delimiters();
+
+	namespace impl
+	{
+		// Identifies the instructions used by find_delimiter and find_first_of to scan the buffer.
+		enum class find_delimiter_isa : std::uint8_t
+		{
+			scalar,
+			sse2,
+			avx2,
+		};
+
+		// Returns the best instructions supported by the processor. find_delimiter always uses these.
+		[[nodiscard]] find_delimiter_isa find_delimiter_best_isa() noexcept;
+
+		// Same as find_delimiter, except the buffer is scanned with the specified instructions, which must be supported by the
+		// processor. Intended for testing and benchmarking.
+		range<char8_t const> find_delimiter(range<char8_t const> const Buffer, range<char8_t const> const Delim,
+			find_delimiter_isa const Isa) noexcept;
+
+		// Same as find_first_of, except the buffer is scanned with the specified instructions.
+		[[nodiscard]] char8_t const* find_first_of(range<char8_t const> const Buffer, char_set const& Set,
+			find_delimiter_isa const Isa) noexcept;
+	}
 }
@@ -3,6 +3,7 @@
 
 #pragma once
 #include "fs.hpp"
+#include "stream.hpp"
 
 // Keep in mind that RIFF files store data in a little-endian format.
 // Read more information about RIFF files: "https://docs.microsoft.com/en-us/windows/win32/xaudio2/resource-interchange-file-format--riff-"
@@ -58,6 +59,51 @@ namespace wdul
 		std::uint32_t length;
 	};
 
+	// The offset within a RIFF file of the first chunk, which follows the RIFF chunk identifier, file size and file type fields.
+	inline constexpr std::int64_t riff_first_chunk_offset = 12;
+
+	// Describes a chunk read by riff_read_chunk_at.
+	struct riff_chunk_location
+	{
+		// The chunk identifier and the length of the data field.
+		riff_chunk_info info;
+
+		// The offset within the file of the data field. Subchunks, if any, begin at this offset.
+		std::int64_t data_offset;
+
+		// Returns the offset within the file of the chunk which follows this one, after the data field and its padding.
+		[[nodiscard]] std::int64_t next_offset() const noexcept
+		{
+			return data_offset + info.length + (info.length % 2);
+		}
+	};
+
+	// The riff_*_at functions read a RIFF file at explicit offsets with fread_at, so unlike riff_reader, they hold no state and
+	// do not depend on the file pointer. Any number of threads may call them on the same handle at once. The file must have been
+	// opened with read access, and must not be associated with an I/O completion port. If it was opened with
+	// FILE_FLAG_OVERLAPPED, the reads of each thread proceed in parallel; otherwise the system serializes them.
+
+	// Reads the fields which precede the first chunk of a RIFF file, and writes the file type to FileType.
+	// Returns riff_reader_error_code::success, or riff_reader_error_code::bad_format if the file is not a RIFF file.
+	[[nodiscard]] riff_reader_error_code riff_read_header_at(_In_ HANDLE const File, std::uint32_t& FileType);
+
+	// Reads the chunk identifier and chunk length fields of the chunk at Offset.
+	// Returns riff_reader_error_code::success, riff_reader_error_code::end if Offset is at or beyond the end of the file, or
+	// riff_reader_error_code::bad_format if the fields are incomplete.
+	[[nodiscard]] riff_reader_error_code riff_read_chunk_at(_In_ HANDLE const File, std::int64_t const Offset, riff_chunk_location& Chunk);
+
+	// Reads the data field of the specified chunk to Buffer, which must be at least Chunk.info.length bytes in size.
+	// Returns riff_reader_error_code::success, or riff_reader_error_code::bad_format if the data field is incomplete.
+	[[nodiscard]] riff_reader_error_code riff_read_chunk_data_at(_In_ HANDLE const File, riff_chunk_location const& Chunk,
+		_Out_writes_bytes_(Chunk.info.length) void* const Buffer);
+
+	// Reads chunks, excluding subchunks of these chunks, from Offset until a chunk is found with the specified chunk identifier,
+	// or End is reached. To search the subchunks of a chunk, pass the chunk's data_offset and next_offset().
+	// Returns riff_reader_error_code::success, riff_reader_error_code::end if the chunk wasn't found, or
+	// riff_reader_error_code::bad_format if the RIFF file was incorrectly formatted.
+	[[nodiscard]] riff_reader_error_code riff_find_chunk_at(_In_ HANDLE const File, std::int64_t const Offset, std::uint32_t const ChunkId,
+		riff_chunk_location& Chunk, std::int64_t const End = (std::numeric_limits<std::int64_t>::max)());
+
 	class riff_reader
 	{
 	public:
@@ -67,11 +113,13 @@ namespace wdul
 		riff_reader() noexcept = default;
 
 		riff_reader(riff_reader&& Other) noexcept :
-			mFile(std::move(Other.mFile)),
+			mFileSource(std::move(Other.mFileSource)),
+			mSource(std::exchange(Other.mSource, nullptr)),
 			mFileType(Other.mFileType),
 			mChunkInfo(Other.mChunkInfo),
 			mState(std::exchange(Other.mState, riff_reader_state::closed))
 		{
+			fixup(Other);
 		}
 
 		riff_reader& operator=(riff_reader Other) noexcept
@@ -83,13 +131,25 @@ namespace wdul
 		void swap(riff_reader& Other) noexcept
 		{
 			using std::swap;
-			swap(mFile, Other.mFile);
+			mFileSource.swap(Other.mFileSource);
+			swap(mSource, Other.mSource);
 			swap(mFileType, Other.mFileType);
 			swap(mChunkInfo, Other.mChunkInfo);
 			swap(mState, Other.mState);
+			fixup(Other);
+			Other.fixup(*this);
 		}
 
 		[[nodiscard]] riff_reader_error_code open(_In_z_ wchar_t const* const Filename);
+
+		// Reads a RIFF file from a byte_source, such as a memory_source holding a resource, from the source's current position.
+		// Positions returned by file_pointer and passed to reposition are positions within the source. Skipping a chunk seeks
+		// the source if it is seekable, and otherwise reads and discards the chunk; reposition requires a seekable source.
+		// The source must remain valid until the riff_reader is closed.
+		// Returns riff_reader_error_code::success, or riff_reader_error_code::bad_format if the source is not a RIFF file.
+		// If the riff_reader_state is not riff_reader_state::closed, wrong_state is thrown.
+		[[nodiscard]] riff_reader_error_code attach(byte_source& Source);
+
 		void close() noexcept;
 
 
@@ -202,11 +262,32 @@ namespace wdul
 		[[nodiscard]] auto state() const noexcept { return mState; }
 
 	private:
+		[[nodiscard]] riff_reader_error_code read_header();
 		[[nodiscard]] riff_reader_error_code read_chunk_info_unchecked();
-		static void skip_padding(_In_ HANDLE const File, std::uint32_t const ChunkLength);
+		void skip_padding(std::uint32_t const ChunkLength);
 		void skip_data_field_and_padding();
 
-		file_handle mFile;
+		// Reads up to Size bytes, stopping early only at the end of the source. Returns the number of bytes read.
+		std::size_t read(_Out_writes_bytes_to_(Size, return) void* const Buffer, std::size_t const Size);
+
+		// Moves forward Size bytes.
+		void skip(std::uint64_t const Size);
+
+		// Redirects mSource to this reader's file_source if it referred to Other's.
+		void fixup(riff_reader const& Other) noexcept
+		{
+			if (mSource == &Other.mFileSource)
+			{
+				mSource = &mFileSource;
+			}
+		}
+
+		// Reads the file opened by open.
+		file_source mFileSource;
+
+		// The source read from: either mFileSource, or a source passed to attach.
+		byte_source* mSource = nullptr;
+
 		std::uint32_t mFileType;
 		riff_chunk_info mChunkInfo;
 		riff_reader_state mState = riff_reader_state::closed;
@@ -0,0 +1,193 @@
+// This file is part of the WillDaisey/WDUL (Windows Desktop Utility Library) project.
+// View this project on github: https://github.com/WillDaisey/wdul/
+
+#pragma once
+#include "virtual_memory.hpp"
+#include "handle.hpp"
+#include <atomic>
+
+namespace wdul
+{
+	/// <summary>
+	/// A circular buffer of bytes whose storage is mapped twice, back-to-back, in virtual memory. Byte
+	/// <c>data()[capacity() + i]</c> is the same byte as <c>data()[i]</c>, so the readable bytes and the writable space are each
+	/// always contiguous, and never have to be split where the buffer wraps around.
+	/// <para>
+	/// Data is written by writing to <c>write_data()</c> (for example, with <c>fread</c>) and then calling <c>commit</c>. Data is
+	/// read from <c>read_data()</c>, and then released by calling <c>consume</c>. For example, a range of readable bytes can be
+	/// submitted to an XAudio2 source voice directly, and consumed once the voice has finished processing it.
+	/// </para>
+	/// <para>
+	/// One producer thread (which calls <c>write_data</c>, <c>free_space</c> and <c>commit</c>) and one consumer thread (which calls
+	/// <c>read_data</c>, <c>size</c> and <c>consume</c>) may use the buffer concurrently without synchronisation.
+	/// </para>
+	/// </summary>
+	class mirrored_ring_buffer
+	{
+	public:
+		mirrored_ring_buffer(mirrored_ring_buffer const&) = delete;
+		mirrored_ring_buffer& operator=(mirrored_ring_buffer const&) = delete;
+
+		/// <summary>Constructs a buffer which has no storage.</summary>
+		mirrored_ring_buffer() noexcept :
+			mData(nullptr),
+			mCapacity(0),
+			mReadPos(0),
+			mWritePos(0)
+		{
+		}
+
+		/// <summary>
+		/// Constructs a buffer whose capacity is at least <paramref name="MinCapacity"/> bytes. The capacity is rounded up to a
+		/// multiple of the allocation granularity (see <c>allocation_granularity</c>).
+		/// Throws <c>std::bad_alloc</c> if the address space cannot be reserved, or an exception describing the error if the
+		/// storage cannot be mapped.
+		/// </summary>
+		/// <param name="MinCapacity">The minimum capacity of the buffer, in bytes. Must be non-zero.</param>
+		explicit mirrored_ring_buffer(std::size_t const MinCapacity);
+
+		mirrored_ring_buffer(mirrored_ring_buffer&& Other) noexcept :
+			mData(std::exchange(Other.mData, nullptr)),
+			mCapacity(std::exchange(Other.mCapacity, 0)),
+			mMapping(std::move(Other.mMapping)),
+			mReadPos(Other.mReadPos.exchange(0, std::memory_order_relaxed)),
+			mWritePos(Other.mWritePos.exchange(0, std::memory_order_relaxed))
+		{
+		}
+
+		mirrored_ring_buffer& operator=(mirrored_ring_buffer&& Other) noexcept
+		{
+			mirrored_ring_buffer(std::move(Other)).swap(*this);
+			return *this;
+		}
+
+		~mirrored_ring_buffer()
+		{
+			release();
+		}
+
+		/// <summary>Returns the maximum number of bytes the buffer can hold.</summary>
+		[[nodiscard]] std::size_t capacity() const noexcept
+		{
+			return mCapacity;
+		}
+
+		/// <summary>Returns the number of readable bytes.</summary>
+		[[nodiscard]] std::size_t size() const noexcept
+		{
+			return static_cast<std::size_t>(mWritePos.load(std::memory_order_acquire) - mReadPos.load(std::memory_order_acquire));
+		}
+
+		/// <summary>Returns the number of bytes which can be written.</summary>
+		[[nodiscard]] std::size_t free_space() const noexcept
+		{
+			return mCapacity - size();
+		}
+
+		/// <summary>Returns true if there are no readable bytes.</summary>
+		[[nodiscard]] bool empty() const noexcept
+		{
+			return size() == 0;
+		}
+
+		/// <summary>
+		/// Returns a pointer to the first readable byte. The range [<c>read_data()</c>, <c>read_data() + size()</c>) is contiguous.
+		/// </summary>
+		[[nodiscard]] std::uint8_t const* read_data() const noexcept
+		{
+			return mData + offset(mReadPos.load(std::memory_order_relaxed));
+		}
+
+		/// <summary>
+		/// Returns a pointer to the first writable byte. The range [<c>write_data()</c>, <c>write_data() + free_space()</c>) is
+		/// contiguous.
+		/// </summary>
+		[[nodiscard]] std::uint8_t* write_data() const noexcept
+		{
+			return mData + offset(mWritePos.load(std::memory_order_relaxed));
+		}
+
+		/// <summary>
+		/// Makes <paramref name="Size"/> bytes, which have been written to <c>write_data()</c>, readable.
+		/// <paramref name="Size"/> must not be greater than <c>free_space()</c>.
+		/// </summary>
+		void commit(std::size_t const Size) noexcept
+		{
+			WDUL_ASSERT(Size <= free_space());
+			mWritePos.store(mWritePos.load(std::memory_order_relaxed) + Size, std::memory_order_release);
+		}
+
+		/// <summary>
+		/// Releases the first <paramref name="Size"/> readable bytes, so that their storage can be written to.
+		/// <paramref name="Size"/> must not be greater than <c>size()</c>.
+		/// </summary>
+		void consume(std::size_t const Size) noexcept
+		{
+			WDUL_ASSERT(Size <= size());
+			mReadPos.store(mReadPos.load(std::memory_order_relaxed) + Size, std::memory_order_release);
+		}
+
+		/// <summary>
+		/// Copies up to <paramref name="Size"/> bytes from <paramref name="Data"/> to the buffer, and makes them readable.
+		/// Returns the number of bytes written, which is less than <paramref name="Size"/> if the buffer is full.
+		/// </summary>
+		std::size_t write(_In_reads_bytes_(Size) void const* const Data, std::size_t Size) noexcept
+		{
+			Size = (std::min)(Size, free_space());
+			std::memcpy(write_data(), Data, Size);
+			commit(Size);
+			return Size;
+		}
+
+		/// <summary>
+		/// Copies up to <paramref name="Size"/> readable bytes to <paramref name="Data"/>, and consumes them.
+		/// Returns the number of bytes read, which is less than <paramref name="Size"/> if there are not enough readable bytes.
+		/// </summary>
+		std::size_t read(_Out_writes_bytes_to_(Size, return) void* const Data, std::size_t Size) noexcept
+		{
+			Size = (std::min)(Size, size());
+			std::memcpy(Data, read_data(), Size);
+			consume(Size);
+			return Size;
+		}
+
+		/// <summary>Discards every readable byte. Must not be called while another thread is using the buffer.</summary>
+		void clear() noexcept
+		{
+			mReadPos.store(0, std::memory_order_relaxed);
+			mWritePos.store(0, std::memory_order_relaxed);
+		}
+
+		/// <summary>Unmaps the buffer's storage. The buffer has no storage after the call.</summary>
+		void release() noexcept;
+
+		void swap(mirrored_ring_buffer& Other) noexcept
+		{
+			std::swap(mData, Other.mData);
+			std::swap(mCapacity, Other.mCapacity);
+			mMapping.swap(Other.mMapping);
+			mReadPos.store(Other.mReadPos.exchange(mReadPos.load(std::memory_order_relaxed), std::memory_order_relaxed), std::memory_order_relaxed);
+			mWritePos.store(Other.mWritePos.exchange(mWritePos.load(std::memory_order_relaxed), std::memory_order_relaxed), std::memory_order_relaxed);
+		}
+
+	private:
+		[[nodiscard]] std::size_t offset(std::uint64_t const Pos) const noexcept
+		{
+			return static_cast<std::size_t>(Pos % mCapacity);
+		}
+
+		std::uint8_t* mData;
+		std::size_t mCapacity;
+		generic_handle<invalid_handle_type::null> mMapping;
+
+		// Positions are the total number of bytes consumed and committed. They only ever increase, so the number of readable
+		// bytes is always mWritePos - mReadPos.
+		std::atomic<std::uint64_t> mReadPos;
+		std::atomic<std::uint64_t> mWritePos;
+	};
+
+	inline void swap(mirrored_ring_buffer& Lhs, mirrored_ring_buffer& Rhs) noexcept
+	{
+		Lhs.swap(Rhs);
+	}
+}
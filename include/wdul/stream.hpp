@@ -0,0 +1,447 @@
+// This file is part of the WillDaisey/WDUL (Windows Desktop Utility Library) project.
+// View this project on github: https://github.com/WillDaisey/wdul/
+
+#pragma once
+#include "fs.hpp"
+#include "mapped_file.hpp"
+#include "virtual_memory.hpp"
+#include <algorithm>
+#include <span>
+#include <utility>
+
+namespace wdul
+{
+	/// <summary>
+	/// A stream of bytes which is read by pulling. Sources are composed by wrapping one source in another, such as a
+	/// <c>transform_source</c> which decompresses or transcodes the bytes of a <c>file_source</c>. Readers such as
+	/// <c>buffered_file_reader</c>, <c>ini_file_reader</c> and <c>riff_reader</c> can read any source.
+	/// <para>
+	/// A source which holds its bytes in memory, such as a <c>memory_source</c>, lends them with <c>borrow</c>, so that readers
+	/// parse them in place rather than copying them into a buffer of their own.
+	/// </para>
+	/// </summary>
+	class byte_source
+	{
+	public:
+		virtual ~byte_source() = default;
+
+		/// <summary>
+		/// Reads up to <c>Buffer.size()</c> bytes to <paramref name="Buffer"/>. Fewer bytes may be read than requested before the
+		/// end of the stream; for example, a <c>transform_source</c> returns the output of one step of its transform.
+		/// </summary>
+		/// <returns>The number of bytes read. Zero only at the end of the stream, or if <paramref name="Buffer"/> is empty.</returns>
+		virtual std::size_t read(std::span<std::uint8_t> const Buffer) = 0;
+
+		/// <summary>
+		/// Consumes up to <paramref name="MaxSize"/> bytes, and returns them in place, without copying them. The bytes remain
+		/// valid until the next call to a member function of the source. Must only be called if <c>borrowable()</c> returns
+		/// <c>true</c>.
+		/// </summary>
+		/// <returns>The bytes consumed. Empty only at the end of the stream, or if <paramref name="MaxSize"/> is zero.</returns>
+		virtual std::span<std::uint8_t const> borrow(std::size_t const MaxSize);
+
+		/// <returns><c>true</c> if the source holds its bytes in memory, and can lend them with <c>borrow</c>.</returns>
+		[[nodiscard]] virtual bool borrowable() const noexcept { return false; }
+
+		/// <summary>
+		/// Sets the position of the next byte to be read, relative to the start of the stream. Throws
+		/// <c>hresult_not_implemented</c> if the source is not seekable.
+		/// </summary>
+		virtual void seek(std::uint64_t const Position);
+
+		/// <returns><c>true</c> if the source supports <c>seek</c>.</returns>
+		[[nodiscard]] virtual bool seekable() const noexcept { return false; }
+
+		/// <returns>The position of the next byte to be read, relative to the start of the stream.</returns>
+		[[nodiscard]] virtual std::uint64_t position() const noexcept = 0;
+	};
+
+	/// <summary>A destination for a stream of bytes.</summary>
+	class byte_sink
+	{
+	public:
+		virtual ~byte_sink() = default;
+
+		/// <summary>Writes every byte of <paramref name="Bytes"/>. Throws an exception on failure.</summary>
+		virtual void write(std::span<std::uint8_t const> const Bytes) = 0;
+	};
+
+	/// <summary>
+	/// Reads a file with <c>fread_at</c>. The source tracks its own position, so the file pointer is never used, and any number
+	/// of sources may share one handle. If the handle was opened with <c>FILE_FLAG_OVERLAPPED</c>, sources on different threads
+	/// read it in parallel; otherwise the system serializes their reads.
+	/// </summary>
+	class file_source : public byte_source
+	{
+	public:
+		file_source(file_source const&) = delete;
+		file_source& operator=(file_source const&) = delete;
+
+		/// <summary>Constructs a source which has no file.</summary>
+		file_source() noexcept :
+			mHandle(nullptr),
+			mPosition(0)
+		{
+		}
+
+		/// <summary>Constructs a source which takes ownership of <paramref name="File"/>.</summary>
+		/// <param name="File">
+		/// A file opened with read access, with or without <c>FILE_FLAG_OVERLAPPED</c>. Must not be associated with an I/O
+		/// completion port.
+		/// </param>
+		/// <param name="Position">The position of the first byte to read, relative to the start of the file.</param>
+		file_source(file_handle File, std::uint64_t const Position) noexcept :
+			mFile(std::move(File)),
+			mHandle(mFile.get()),
+			mPosition(Position)
+		{
+		}
+
+		file_source(file_source&& Other) noexcept :
+			mFile(std::move(Other.mFile)),
+			mHandle(std::exchange(Other.mHandle, nullptr)),
+			mPosition(std::exchange(Other.mPosition, 0))
+		{
+		}
+
+		file_source& operator=(file_source&& Other) noexcept
+		{
+			file_source(std::move(Other)).swap(*this);
+			return *this;
+		}
+
+		void swap(file_source& Other) noexcept
+		{
+			mFile.swap(Other.mFile);
+			std::swap(mHandle, Other.mHandle);
+			std::swap(mPosition, Other.mPosition);
+		}
+
+		/// <summary>Opens the specified file for reading. If a file is already open, it is closed first.</summary>
+		/// <param name="Filename">Pointer to a null-terminated UTF-16 string which contains the name of the file to open.</param>
+		/// <returns>
+		/// One of the following values:<para/>
+		/// <c>fopen_code::success</c><para/>
+		/// <c>fopen_code::not_found</c><para/>
+		/// <c>fopen_code::access_denied</c><para/>
+		/// <c>fopen_code::in_use</c>
+		/// </returns>
+		[[nodiscard]] fopen_code open(_In_z_ wchar_t const* const Filename);
+
+		/// <summary>Reads a file which the source does not own. If a file is already open, it is closed first.</summary>
+		/// <param name="File">
+		/// A file opened with read access, with or without <c>FILE_FLAG_OVERLAPPED</c>. Must not be associated with an I/O
+		/// completion port, and must remain open until the source is closed.
+		/// </param>
+		/// <param name="Position">The position of the first byte to read, relative to the start of the file.</param>
+		void share(_In_ HANDLE const File, std::uint64_t const Position = 0) noexcept;
+
+		/// <summary>Closes the file, unless it is shared.</summary>
+		void close() noexcept;
+
+		/// <returns><c>true</c> if and only if the source has a file.</returns>
+		[[nodiscard]] bool is_open() const noexcept { return mHandle != nullptr; }
+
+		/// <returns>The file handle, or nullptr if the source has no file.</returns>
+		[[nodiscard]] HANDLE file() const noexcept { return mHandle; }
+
+		std::size_t read(std::span<std::uint8_t> const Buffer) override;
+
+		void seek(std::uint64_t const Position) override { mPosition = Position; }
+		[[nodiscard]] bool seekable() const noexcept override { return true; }
+		[[nodiscard]] std::uint64_t position() const noexcept override { return mPosition; }
+
+	private:
+		// Owns the file, unless it is shared.
+		file_handle mFile;
+
+		// The file read from.
+		HANDLE mHandle;
+
+		std::uint64_t mPosition;
+	};
+
+	/// <summary>Reads bytes which are held in memory, such as a buffer filled by <c>read_bytes</c>, or a resource.</summary>
+	class memory_source : public byte_source
+	{
+	public:
+		/// <summary>Constructs a source which has no bytes.</summary>
+		memory_source() noexcept :
+			mPosition(0)
+		{
+		}
+
+		/// <summary>Constructs a source which reads <paramref name="Bytes"/>, which must remain valid while the source is read.</summary>
+		explicit memory_source(std::span<std::uint8_t const> const Bytes) noexcept :
+			mBytes(Bytes),
+			mPosition(0)
+		{
+		}
+
+		/// <returns>Every byte of the stream.</returns>
+		[[nodiscard]] std::span<std::uint8_t const> bytes() const noexcept { return mBytes; }
+
+		std::size_t read(std::span<std::uint8_t> const Buffer) override;
+
+		std::span<std::uint8_t const> borrow(std::size_t const MaxSize) override
+		{
+			auto const bytes = remaining().first((std::min)(MaxSize, remaining().size()));
+			mPosition += bytes.size();
+			return bytes;
+		}
+
+		[[nodiscard]] bool borrowable() const noexcept override { return true; }
+
+		void seek(std::uint64_t const Position) override
+		{
+			// Positions beyond the end of the stream behave like the end of the stream.
+			mPosition = static_cast<std::size_t>((std::min)(Position, std::uint64_t(mBytes.size())));
+		}
+
+		[[nodiscard]] bool seekable() const noexcept override { return true; }
+		[[nodiscard]] std::uint64_t position() const noexcept override { return mPosition; }
+
+	protected:
+		void reset(std::span<std::uint8_t const> const Bytes) noexcept
+		{
+			mBytes = Bytes;
+			mPosition = 0;
+		}
+
+	private:
+		[[nodiscard]] std::span<std::uint8_t const> remaining() const noexcept { return mBytes.subspan(mPosition); }
+
+		std::span<std::uint8_t const> mBytes;
+		std::size_t mPosition;
+	};
+
+	/// <summary>
+	/// Reads a file through a view of the file mapped into memory, so that readers parse the file's pages in place, and no bytes
+	/// are copied. See <c>mapped_file</c>.
+	/// </summary>
+	class mapped_source : public memory_source
+	{
+	public:
+		mapped_source(mapped_source const&) = delete;
+		mapped_source& operator=(mapped_source const&) = delete;
+
+		/// <summary>Constructs a source which has no view.</summary>
+		mapped_source() noexcept = default;
+
+		/// <summary>Constructs a source which reads, and takes ownership of, <paramref name="View"/>.</summary>
+		explicit mapped_source(file_view View) noexcept :
+			mView(std::move(View))
+		{
+			reset(mView.bytes());
+		}
+
+		/// <summary>Maps the entirety of the specified file. If a view is already mapped, it is unmapped first.</summary>
+		/// <param name="Filename">Pointer to a null-terminated UTF-16 string which contains the name of the file to open.</param>
+		/// <returns>
+		/// One of the following values:<para/>
+		/// <c>fopen_code::success</c><para/>
+		/// <c>fopen_code::not_found</c><para/>
+		/// <c>fopen_code::access_denied</c><para/>
+		/// <c>fopen_code::in_use</c>
+		/// </returns>
+		[[nodiscard]] fopen_code open(_In_z_ wchar_t const* const Filename);
+
+		/// <summary>Unmaps the view.</summary>
+		void close() noexcept
+		{
+			reset({});
+			mView.unmap();
+		}
+
+		/// <returns>The view.</returns>
+		[[nodiscard]] file_view const& view() const noexcept { return mView; }
+
+	private:
+		file_view mView;
+	};
+
+	// The outcome of a step of a byte_transform.
+	struct byte_transform_result
+	{
+		// The number of bytes consumed from the input.
+		std::size_t consumed;
+
+		// The number of bytes written to the output.
+		std::size_t produced;
+	};
+
+	/// <summary>
+	/// Converts one stream of bytes to another in steps, such as a decompressor or a character set converter. Used by
+	/// <c>transform_source</c>.
+	/// </summary>
+	class byte_transform
+	{
+	public:
+		/// <summary>The smallest output buffer a transform is given, in bytes.</summary>
+		static constexpr std::size_t min_output_size = 16;
+
+		virtual ~byte_transform() = default;
+
+		/// <summary>
+		/// Consumes bytes from <paramref name="Input"/>, and writes the bytes they convert to to <paramref name="Output"/>. A
+		/// transform may consume input without producing output, and may hold input or output back until a later step. If a step
+		/// neither consumes nor produces, and <paramref name="Final"/> is false, the transform is given more input. Throws an
+		/// exception if the input is malformed.
+		/// </summary>
+		/// <param name="Input">The next bytes of the input stream. May be empty.</param>
+		/// <param name="Output">The buffer which receives the output. At least <c>min_output_size</c> bytes.</param>
+		/// <param name="Final">
+		/// <c>true</c> if <paramref name="Input"/> holds the last bytes of the input stream. The stream ends once a final step
+		/// neither consumes nor produces.
+		/// </param>
+		virtual byte_transform_result transform(std::span<std::uint8_t const> const Input, std::span<std::uint8_t> const Output,
+			bool const Final) = 0;
+
+		/// <summary>Returns the transform to its initial state, so that it can convert a stream from the start.</summary>
+		virtual void reset() noexcept = 0;
+	};
+
+	/// <summary>
+	/// Converts UTF-16LE to UTF-8, such as to read a .ini file saved as "Unicode" by Notepad with <c>ini_file_reader</c>. A byte
+	/// order mark at the start of the input is removed. Unpaired surrogates, and a trailing odd byte, are converted to U+FFFD.
+	/// </summary>
+	class utf16_to_utf8_transform : public byte_transform
+	{
+	public:
+		byte_transform_result transform(std::span<std::uint8_t const> const Input, std::span<std::uint8_t> const Output,
+			bool const Final) override;
+
+		void reset() noexcept override
+		{
+			mStarted = false;
+		}
+
+	private:
+		// Set once the first code unit, which may be a byte order mark, has been consumed.
+		bool mStarted = false;
+	};
+
+	/// <summary>
+	/// Reads the output of a <c>byte_transform</c> applied to another source. If the other source is borrowable, the transform
+	/// consumes its bytes in place; otherwise they are read into an input buffer. The source is seekable if the other source is:
+	/// seeking backwards restarts the transform from the start of the other source, and seeking forwards discards output.
+	/// </summary>
+	class transform_source : public byte_source
+	{
+	public:
+		/// <summary>The default size of the input buffer, in bytes.</summary>
+		static constexpr std::size_t default_buffer_size = std::size_t(64) << 10;
+
+		transform_source(transform_source const&) = delete;
+		transform_source& operator=(transform_source const&) = delete;
+
+		/// <param name="Upstream">The source of the transform's input. Must outlive the <c>transform_source</c>.</param>
+		/// <param name="Transform">The transform. Must outlive the <c>transform_source</c>.</param>
+		/// <param name="BufferSize">
+		/// The size of the input buffer, in bytes. Must be larger than the largest input the transform holds back.
+		/// </param>
+		transform_source(byte_source& Upstream, byte_transform& Transform, std::size_t const BufferSize = default_buffer_size);
+
+		std::size_t read(std::span<std::uint8_t> const Buffer) override;
+
+		void seek(std::uint64_t const Position) override;
+		[[nodiscard]] bool seekable() const noexcept override { return mUpstream->seekable(); }
+		[[nodiscard]] std::uint64_t position() const noexcept override { return mPosition; }
+
+	private:
+		// Runs the transform until it produces output to Output, or the stream ends. Returns the number of bytes produced.
+		std::size_t step(std::span<std::uint8_t> const Output);
+
+		// Makes more input available to the transform, after the input it has not consumed.
+		void fill();
+
+		byte_source* mUpstream;
+		byte_transform* mTransform;
+
+		// The position within the upstream source of the start of the input stream.
+		std::uint64_t mUpstreamStart;
+
+		// The input not yet consumed is [mInput + mInputCursor, mInput + mInputEnd). mInput points to either the input buffer,
+		// or bytes borrowed from the upstream source.
+		std::uint8_t const* mInput;
+		std::size_t mInputCursor;
+		std::size_t mInputEnd;
+		byte_array mInputBuffer;
+
+		// Holds output which did not fit in a read smaller than byte_transform::min_output_size.
+		std::uint8_t mStage[byte_transform::min_output_size];
+		std::uint8_t mStageCursor;
+		std::uint8_t mStageEnd;
+
+		// Set once the upstream source has reached the end of its stream.
+		bool mUpstreamEnded;
+
+		std::uint64_t mPosition;
+	};
+
+	// Computes the CRC-32 (as used by zip, PNG and Ethernet) of Bytes. To compute the CRC-32 of a stream in pieces, pass the
+	// result for the bytes so far as Crc.
+	[[nodiscard]] std::uint32_t crc32(std::span<std::uint8_t const> const Bytes, std::uint32_t const Crc = 0) noexcept;
+
+	/// <summary>
+	/// Computes the CRC-32 of the bytes read from another source as they pass through, such as to verify a file as it is parsed.
+	/// The source is borrowable if the other source is, in which case the bytes are neither copied nor read twice.
+	/// </summary>
+	class crc32_source : public byte_source
+	{
+	public:
+		/// <param name="Upstream">The source of the bytes. Must outlive the <c>crc32_source</c>.</param>
+		explicit crc32_source(byte_source& Upstream) noexcept :
+			mUpstream(&Upstream),
+			mCrc(0)
+		{
+		}
+
+		/// <returns>The CRC-32 of the bytes read so far.</returns>
+		[[nodiscard]] std::uint32_t crc() const noexcept { return mCrc; }
+
+		std::size_t read(std::span<std::uint8_t> const Buffer) override
+		{
+			auto const bytesRead = mUpstream->read(Buffer);
+			mCrc = crc32(Buffer.first(bytesRead), mCrc);
+			return bytesRead;
+		}
+
+		std::span<std::uint8_t const> borrow(std::size_t const MaxSize) override
+		{
+			auto const bytes = mUpstream->borrow(MaxSize);
+			mCrc = crc32(bytes, mCrc);
+			return bytes;
+		}
+
+		[[nodiscard]] bool borrowable() const noexcept override { return mUpstream->borrowable(); }
+		[[nodiscard]] std::uint64_t position() const noexcept override { return mUpstream->position(); }
+
+	private:
+		byte_source* mUpstream;
+		std::uint32_t mCrc;
+	};
+
+	/// <summary>Appends the bytes written to it to a <c>virtual_buffer</c>.</summary>
+	class memory_sink : public byte_sink
+	{
+	public:
+		/// <param name="Output">The buffer to append to. Must outlive the <c>memory_sink</c>.</param>
+		explicit memory_sink(virtual_buffer& Output) noexcept :
+			mOutput(&Output)
+		{
+		}
+
+		void write(std::span<std::uint8_t const> const Bytes) override
+		{
+			mOutput->append(Bytes.data(), Bytes.size());
+		}
+
+	private:
+		virtual_buffer* mOutput;
+	};
+
+	// Reads Source until the end of its stream, and writes the bytes to Sink. If Source is borrowable, its bytes are written
+	// in place. Returns the number of bytes written.
+	std::uint64_t pump(byte_source& Source, byte_sink& Sink);
+}
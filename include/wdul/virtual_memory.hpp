@@ -0,0 +1,228 @@
+// This file is part of the WillDaisey/WDUL (Windows Desktop Utility Library) project.
+// View this project on github: https://github.com/WillDaisey/wdul/
+
+#pragma once
+#include "memory.hpp"
+#include <utility>
+
+namespace wdul
+{
+	namespace impl
+	{
+		// Rounds Size up to a multiple of Granularity, which must be a power of two.
+		// Returns zero if the result cannot be represented.
+		[[nodiscard]] constexpr std::size_t round_up_size(std::size_t const Size, std::size_t const Granularity) noexcept
+		{
+			WDUL_ASSERT(is_valid_alignment(Granularity));
+			if (Size > (std::numeric_limits<std::size_t>::max)() - (Granularity - 1))
+			{
+				return 0;
+			}
+			return (Size + Granularity - 1) & ~(Granularity - 1);
+		}
+	}
+
+	// Returns the size of a page, in bytes.
+	[[nodiscard]] std::size_t page_size() noexcept;
+
+	// Returns the granularity at which virtual memory can be reserved, in bytes.
+	[[nodiscard]] std::size_t allocation_granularity() noexcept;
+
+	// Returns the size of a large page, in bytes, or zero if the processor does not support large pages.
+	[[nodiscard]] std::size_t large_page_size() noexcept;
+
+	// Attempts to enable the SeLockMemoryPrivilege privilege for the calling process, which is required to allocate large pages.
+	// Returns true if the privilege is enabled. Returns false if the process's token does not hold the privilege.
+	// Throws an exception if the function fails for any other reason.
+	bool enable_large_pages();
+
+	/// <summary>
+	/// Manages a contiguous buffer of bytes whose address range is reserved once, up front. Pages are committed as the buffer
+	/// grows, so the buffer's data pointer never changes and growing the buffer never copies its contents.
+	/// <para>
+	/// Pages are committed geometrically, in multiples of the page size. Newly committed pages are filled with zeroes by the
+	/// system. Pages stay committed when the buffer shrinks, until <c>shrink_to_fit</c> is called.
+	/// </para>
+	/// <para>
+	/// If large pages are requested, the entire reservation is committed immediately, since large pages cannot be committed
+	/// incrementally. If the large page allocation fails (typically because the process does not hold SeLockMemoryPrivilege;
+	/// see <c>enable_large_pages</c>), the buffer falls back to normal pages.
+	/// </para>
+	/// </summary>
+	class virtual_buffer
+	{
+	public:
+		virtual_buffer(virtual_buffer const&) = delete;
+		virtual_buffer& operator=(virtual_buffer const&) = delete;
+
+		/// <summary>Constructs an empty buffer which has no reserved address range.</summary>
+		virtual_buffer() noexcept :
+			mData(nullptr),
+			mSize(0),
+			mCommitted(0),
+			mReserved(0),
+			mLargePages(false)
+		{
+		}
+
+		/// <summary>
+		/// Reserves an address range of at least <paramref name="MaxSize"/> bytes. No pages are committed, unless
+		/// <paramref name="LargePages"/> is true and large pages could be allocated.
+		/// Throws <c>std::bad_alloc</c> if the address range cannot be reserved.
+		/// </summary>
+		/// <param name="MaxSize">The maximum size of the buffer, in bytes. Must be non-zero.</param>
+		/// <param name="LargePages">If true, attempts to allocate the buffer with large pages.</param>
+		explicit virtual_buffer(std::size_t const MaxSize, bool const LargePages = false);
+
+		virtual_buffer(virtual_buffer&& Other) noexcept :
+			mData(std::exchange(Other.mData, nullptr)),
+			mSize(std::exchange(Other.mSize, 0)),
+			mCommitted(std::exchange(Other.mCommitted, 0)),
+			mReserved(std::exchange(Other.mReserved, 0)),
+			mLargePages(std::exchange(Other.mLargePages, false))
+		{
+		}
+
+		virtual_buffer& operator=(virtual_buffer&& Other) noexcept
+		{
+			virtual_buffer(std::move(Other)).swap(*this);
+			return *this;
+		}
+
+		~virtual_buffer()
+		{
+			release();
+		}
+
+		/// <summary>Returns a pointer to the first byte of the buffer, or <c>nullptr</c> if no address range is reserved.</summary>
+		[[nodiscard]] std::uint8_t* data() const noexcept
+		{
+			return mData;
+		}
+
+		/// <summary>Returns the size of the buffer, in bytes.</summary>
+		[[nodiscard]] std::size_t size() const noexcept
+		{
+			return mSize;
+		}
+
+		/// <summary>Returns true if the size of the buffer is zero.</summary>
+		[[nodiscard]] bool empty() const noexcept
+		{
+			return mSize == 0;
+		}
+
+		/// <summary>Returns the number of committed bytes. The buffer can grow to this size without committing more pages.</summary>
+		[[nodiscard]] std::size_t committed() const noexcept
+		{
+			return mCommitted;
+		}
+
+		/// <summary>Returns the size of the reserved address range, in bytes. The buffer cannot grow beyond this size.</summary>
+		[[nodiscard]] std::size_t reserved() const noexcept
+		{
+			return mReserved;
+		}
+
+		/// <summary>Returns true if the buffer is allocated with large pages.</summary>
+		[[nodiscard]] bool large_pages() const noexcept
+		{
+			return mLargePages;
+		}
+
+		/// <summary>
+		/// Commits pages such that at least <paramref name="Size"/> bytes are committed.
+		/// Throws <c>std::bad_alloc</c> if <paramref name="Size"/> is greater than <c>reserved()</c>, or if the pages cannot be
+		/// committed.
+		/// </summary>
+		void reserve(std::size_t const Size)
+		{
+			if (Size > mCommitted)
+			{
+				commit(Size);
+			}
+		}
+
+		/// <summary>
+		/// Resizes the buffer to <paramref name="Size"/> bytes, committing pages if necessary. If the buffer grows, the contents
+		/// of the new bytes are zero if they have not been written to since they were committed, and indeterminate otherwise.
+		/// Throws <c>std::bad_alloc</c> if <paramref name="Size"/> is greater than <c>reserved()</c>, or if the pages cannot be
+		/// committed.
+		/// </summary>
+		void resize(std::size_t const Size)
+		{
+			if (Size > mCommitted)
+			{
+				grow(Size);
+			}
+			mSize = Size;
+		}
+
+		/// <summary>
+		/// Grows the buffer by <paramref name="Size"/> bytes, and returns a pointer to the first new byte. The contents of the new
+		/// bytes are indeterminate.
+		/// </summary>
+		[[nodiscard]] std::uint8_t* append_uninitialized(std::size_t const Size)
+		{
+			if (Size > mReserved - mSize)
+			{
+				throw std::bad_alloc();
+			}
+			auto const oldSize = mSize;
+			resize(oldSize + Size);
+			return mData + oldSize;
+		}
+
+		/// <summary>Appends <paramref name="Size"/> bytes, copied from <paramref name="Data"/>, to the end of the buffer.</summary>
+		void append(_In_reads_bytes_(Size) void const* const Data, std::size_t const Size)
+		{
+			if (Size != 0)
+			{
+				// Growing the buffer never moves it, so Data may point into the buffer.
+				std::memcpy(append_uninitialized(Size), Data, Size);
+			}
+		}
+
+		/// <summary>Sets the size of the buffer to zero. Committed pages remain committed.</summary>
+		void clear() noexcept
+		{
+			mSize = 0;
+		}
+
+		/// <summary>
+		/// Decommits every page which lies entirely beyond the end of the buffer. Does nothing if the buffer is allocated with
+		/// large pages.
+		/// </summary>
+		void shrink_to_fit() noexcept;
+
+		/// <summary>Releases the reserved address range. The buffer becomes empty and has no reserved address range.</summary>
+		void release() noexcept;
+
+		void swap(virtual_buffer& Other) noexcept
+		{
+			std::swap(mData, Other.mData);
+			std::swap(mSize, Other.mSize);
+			std::swap(mCommitted, Other.mCommitted);
+			std::swap(mReserved, Other.mReserved);
+			std::swap(mLargePages, Other.mLargePages);
+		}
+
+	private:
+		// Commits pages geometrically such that at least Size bytes are committed.
+		void grow(std::size_t const Size);
+
+		// Commits pages such that at least Size bytes are committed.
+		void commit(std::size_t const Size);
+
+		std::uint8_t* mData;
+		std::size_t mSize;
+		std::size_t mCommitted;
+		std::size_t mReserved;
+		bool mLargePages;
+	};
+
+	inline void swap(virtual_buffer& Lhs, virtual_buffer& Rhs) noexcept
+	{
+		Lhs.swap(Rhs);
+	}
+}
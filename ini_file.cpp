@@ -124,21 +124,38 @@ namespace wdul
 
 	fopen_code ini_file_reader::open(_In_z_ wchar_t const* const Filename)
 	{
-		return fopen(mFile.reput(), Filename, file_open_mode::open_existing, 0, generic_access::read, file_share_mode::read);
+		mStart = 0;
+		mSectionFp = 0;
+		return mReader.open(Filename, buffer_size);
+	}
+
+	void ini_file_reader::share(_In_ HANDLE const File)
+	{
+		mStart = 0;
+		mSectionFp = 0;
+		mReader.share(File, 0, buffer_size);
+	}
+
+	void ini_file_reader::attach(byte_source& Source)
+	{
+		WDUL_ASSERT(Source.seekable());
+		mReader.attach(Source, buffer_size);
+		mStart = mReader.position();
+		mSectionFp = mStart;
 	}
 
 	void ini_file_reader::close() noexcept
 	{
-		WDUL_DEBUG_RAISE_LAST_ERROR_WHEN(mFile.try_close(), == false);
+		mReader.close();
 	}
 
 	bool ini_file_reader::find_section(std::u8string_view const Section)
 	{
 		if (!is_open()) throw hresult_invalid_state();
 		ini_node_parse parse;
-		fsetpos(mFile.get(), 0);
+		mReader.seek(mStart);
 
-		while (freadline(mFile.get(), mNode, sizeof(mReadBuffer), mReadBuffer))
+		while (mReader.readline(mNode))
 		{
 			ini_parse_node(&parse, mNode);
 			if (parse.type == ini_node_type::section)
@@ -146,7 +163,7 @@ namespace wdul
 				if (std::equal(parse.section.name_first, parse.section.name_end, Section.begin(), Section.end()))
 				{
 					mSection.assign(parse.section.name_first, parse.section.name_end);
-					mSectionFp = fgetpos(mFile.get());
+					mSectionFp = mReader.position();
 					return true;
 				}
 			}
@@ -155,13 +172,14 @@ namespace wdul
 		return false;
 	}
 
-	bool ini_file_reader::find_value(std::u8string& Value, std::u8string_view const Key)
+	template <class StringT>
+	bool ini_file_reader::find_value_x(StringT& Value, std::u8string_view const Key)
 	{
 		if (!is_open()) throw hresult_invalid_state();
 		ini_node_parse parse;
-		fsetpos(mFile.get(), mSectionFp);
+		mReader.seek(mSectionFp);
 
-		while (freadline(mFile.get(), mNode, sizeof(mReadBuffer), mReadBuffer))
+		while (mReader.readline(mNode))
 		{
 			ini_parse_node(&parse, mNode);
 			if (parse.type == ini_node_type::property)
@@ -180,4 +198,14 @@ namespace wdul
 
 		return false;
 	}
+
+	bool ini_file_reader::find_value(std::u8string& Value, std::u8string_view const Key)
+	{
+		return find_value_x(Value, Key);
+	}
+
+	bool ini_file_reader::find_value(std::pmr::u8string& Value, std::u8string_view const Key)
+	{
+		return find_value_x(Value, Key);
+	}
 }
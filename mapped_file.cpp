@@ -0,0 +1,124 @@
+// This file is part of the WillDaisey/WDUL (Windows Desktop Utility Library) project.
+// View this project on github: https://github.com/WillDaisey/wdul/
+
+#include "include/wdul/mapped_file.hpp"
+#include "include/wdul/virtual_memory.hpp"
+#include "include/wdul/error.hpp"
+
+namespace wdul
+{
+	bool file_view::prefetch(std::size_t const Offset, std::size_t const Size) const noexcept
+	{
+		if (Offset >= mSize || Size == 0)
+		{
+			return true;
+		}
+		WIN32_MEMORY_RANGE_ENTRY range;
+		range.VirtualAddress = mData + Offset;
+		range.NumberOfBytes = (std::min)(Size, mSize - Offset);
+		return PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0) != 0;
+	}
+
+	void file_view::unmap() noexcept
+	{
+		if (mBase)
+		{
+			WDUL_DEBUG_RAISE_LAST_ERROR_WHEN(UnmapViewOfFile(mBase), == 0);
+			mBase = nullptr;
+			mData = nullptr;
+			mSize = 0;
+			mOffset = 0;
+		}
+	}
+
+	mapped_file::mapped_file(_In_z_ wchar_t const* const Filename, map_access const Access) :
+		mapped_file()
+	{
+		map(fopen(Filename, file_open_mode::open_existing, FILE_ATTRIBUTE_NORMAL, generic_access::read, file_share_mode::read),
+			Access);
+	}
+
+	[[nodiscard]] fopen_code mapped_file::open(_In_z_ wchar_t const* const Filename, map_access const Access)
+	{
+		close();
+		file_handle f;
+		auto const code = fopen(f.put(), Filename, file_open_mode::open_existing, FILE_ATTRIBUTE_NORMAL, generic_access::read,
+			file_share_mode::read);
+		if (code != fopen_code::success)
+		{
+			return code;
+		}
+		map(std::move(f), Access);
+		return fopen_code::success;
+	}
+
+	void mapped_file::close() noexcept
+	{
+		WDUL_DEBUG_RAISE_LAST_ERROR_WHEN(mMapping.try_close(), == false);
+		WDUL_DEBUG_RAISE_LAST_ERROR_WHEN(mFile.try_close(), == false);
+		mSize = 0;
+		mAccess = map_access::read_only;
+	}
+
+	void mapped_file::map(file_handle File, map_access const Access)
+	{
+		auto const size = static_cast<std::uint64_t>(fgetsize(File.get()));
+
+		// A file mapping object cannot be created for an empty file. Every view of an empty file is empty.
+		generic_handle<invalid_handle_type::null> mapping;
+		if (size != 0)
+		{
+			// A copy-on-write mapping of a file opened for reading is created with PAGE_WRITECOPY; the file is never written.
+			mapping.attach(CreateFileMappingW(File.get(), nullptr, Access == map_access::copy_on_write ? PAGE_WRITECOPY : PAGE_READONLY,
+				0, 0, nullptr));
+			if (!mapping)
+			{
+				throw_last_error();
+			}
+		}
+		mFile = std::move(File);
+		mMapping = std::move(mapping);
+		mSize = size;
+		mAccess = Access;
+	}
+
+	[[nodiscard]] file_view mapped_file::view(std::uint64_t const Offset, std::size_t const Size) const
+	{
+		WDUL_ASSERT(is_open());
+		if (Offset >= mSize || Size == 0)
+		{
+			return file_view();
+		}
+		auto const size = static_cast<std::size_t>((std::min)(static_cast<std::uint64_t>(Size), mSize - Offset));
+
+		// The offset of a view must be a multiple of the allocation granularity, so map from the preceding boundary.
+		auto const delta = static_cast<std::size_t>(Offset % allocation_granularity());
+		auto const base = Offset - delta;
+		if (size > (std::numeric_limits<std::size_t>::max)() - delta)
+		{
+			throw file_too_large();
+		}
+		auto const p = MapViewOfFile(mMapping.get(), mAccess == map_access::copy_on_write ? FILE_MAP_COPY : FILE_MAP_READ,
+			static_cast<DWORD>(base >> 32), static_cast<DWORD>(base), delta + size);
+		if (!p)
+		{
+			throw_last_error();
+		}
+		return file_view(p, static_cast<std::uint8_t*>(p) + delta, size, Offset, mAccess);
+	}
+
+	[[nodiscard]] file_view mapped_file::view() const
+	{
+		if (mSize > (std::numeric_limits<std::size_t>::max)())
+		{
+			throw file_too_large();
+		}
+		return view(0, static_cast<std::size_t>(mSize));
+	}
+
+	[[nodiscard]] file_view map_file(_In_z_ wchar_t const* const Filename, map_access const Access)
+	{
+		// The view keeps the file mapping object alive after the handles are closed.
+		return mapped_file(Filename, Access).view();
+	}
+}
@@ -0,0 +1,437 @@
+// This file is part of the WillDaisey/WDUL (Windows Desktop Utility Library) project.
+// View this project on github: https://github.com/WillDaisey/wdul/
+
+#include "include/wdul/memory.hpp"
+#include "include/wdul/counting_allocator.hpp"
+#include <algorithm>
+#include <array>
+
+namespace wdul::impl
+{
+	// Precedes every block returned by the pool.
+	struct alignas(default_allocation_alignment) pool_header
+	{
+		// Index into pool_class_sizes, or pool_large_class if the block was allocated with malloc.
+		std::uint32_t size_class;
+
+		// The size last requested for the block, excluding the header.
+		std::size_t size;
+	};
+
+	// Overlays the header of a block which is in a free list.
+	struct pool_free_block
+	{
+		// The next block in the same batch, or nullptr.
+		pool_free_block* next;
+
+		// The next batch in the depot. Only valid for the first block of a batch.
+		pool_free_block* next_batch;
+
+		// The number of blocks in the batch. Only valid for the first block of a batch.
+		std::uint32_t count;
+	};
+
+	inline constexpr std::size_t pool_header_size = sizeof(pool_header);
+
+	// Block sizes, including the header.
+	inline constexpr std::uint32_t pool_class_sizes[] = {
+		32, 48, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384, 448, 512, 640, 768, 896, 1024
+	};
+	inline constexpr std::uint32_t pool_class_count = static_cast<std::uint32_t>(std::size(pool_class_sizes));
+	inline constexpr std::uint32_t pool_large_class = 0xFFFFFFFF;
+	inline constexpr std::size_t pool_granularity = 16;
+	inline constexpr std::size_t pool_slab_size = 64 * 1024;
+
+	// The number of blocks moved between a thread cache and the depot at once.
+	// A thread cache holds at most twice this number of blocks per size class.
+	inline constexpr std::uint32_t pool_batch_size = 32;
+
+	static_assert(pool_header_size + pool_alloc_traits::max_small_size == pool_class_sizes[pool_class_count - 1]);
+	static_assert(sizeof(pool_free_block) <= pool_class_sizes[0]);
+
+	// Maps (block size including header + pool_granularity - 1) / pool_granularity to a size class.
+	inline constexpr auto pool_class_lookup = []()
+	{
+		std::array<std::uint8_t, pool_class_sizes[pool_class_count - 1] / pool_granularity + 1> lookup{};
+		std::uint8_t sizeClass = 0;
+		for (std::size_t i = 0; i != lookup.size(); ++i)
+		{
+			while (pool_class_sizes[sizeClass] < i * pool_granularity)
+			{
+				++sizeClass;
+			}
+			lookup[i] = sizeClass;
+		}
+		return lookup;
+	}();
+
+	[[nodiscard]] inline std::uint32_t pool_size_class(std::size_t const Size) noexcept
+	{
+		if (Size > pool_alloc_traits::max_small_size)
+		{
+			return pool_large_class;
+		}
+		return pool_class_lookup[(Size + pool_header_size + pool_granularity - 1) / pool_granularity];
+	}
+
+	[[nodiscard]] inline pool_header* pool_get_header(void const* const Ptr) noexcept
+	{
+		return const_cast<pool_header*>(static_cast<pool_header const*>(Ptr) - 1);
+	}
+
+	struct pool_depot_bin
+	{
+		SRWLOCK lock = SRWLOCK_INIT;
+		pool_free_block* batches = nullptr;
+	};
+
+	// The depot is constant-initialised, so it is usable during static initialisation and is never destroyed.
+	pool_depot_bin pool_depot[pool_class_count];
+
+	// Pushes a chain of batches, linked through next_batch from First to Last, to the depot.
+	void pool_depot_push(std::uint32_t const SizeClass, pool_free_block* const First, pool_free_block* const Last) noexcept
+	{
+		auto& bin = pool_depot[SizeClass];
+		AcquireSRWLockExclusive(&bin.lock);
+		Last->next_batch = bin.batches;
+		bin.batches = First;
+		ReleaseSRWLockExclusive(&bin.lock);
+	}
+
+	void pool_depot_push(std::uint32_t const SizeClass, pool_free_block* const Batch) noexcept
+	{
+		pool_depot_push(SizeClass, Batch, Batch);
+	}
+
+	[[nodiscard]] pool_free_block* pool_depot_pop(std::uint32_t const SizeClass) noexcept
+	{
+		auto& bin = pool_depot[SizeClass];
+		AcquireSRWLockExclusive(&bin.lock);
+		auto const batch = bin.batches;
+		if (batch)
+		{
+			bin.batches = batch->next_batch;
+		}
+		ReleaseSRWLockExclusive(&bin.lock);
+		return batch;
+	}
+
+	class pool_thread_cache
+	{
+	public:
+		~pool_thread_cache()
+		{
+			// The destructor leaves the cache empty but usable, in case another thread-local object deallocates pool storage
+			// after the cache has been destroyed.
+			for (std::uint32_t sizeClass = 0; sizeClass != pool_class_count; ++sizeClass)
+			{
+				while (mBins[sizeClass].count != 0)
+				{
+					flush(sizeClass, (std::min)(mBins[sizeClass].count, pool_batch_size));
+				}
+			}
+		}
+
+		[[nodiscard]] pool_header* pop(std::uint32_t const SizeClass)
+		{
+			auto& bin = mBins[SizeClass];
+			if (!bin.head)
+			{
+				refill(SizeClass);
+			}
+			auto const block = bin.head;
+			bin.head = block->next;
+			--bin.count;
+			return reinterpret_cast<pool_header*>(block);
+		}
+
+		void push(std::uint32_t const SizeClass, pool_header* const Header) noexcept
+		{
+			auto& bin = mBins[SizeClass];
+			auto const block = reinterpret_cast<pool_free_block*>(Header);
+			block->next = bin.head;
+			bin.head = block;
+			if (++bin.count >= 2 * pool_batch_size)
+			{
+				flush(SizeClass, pool_batch_size);
+			}
+		}
+
+	private:
+		struct bin
+		{
+			pool_free_block* head = nullptr;
+			std::uint32_t count = 0;
+		};
+
+		// Moves Count blocks from the front of the free list to the depot.
+		void flush(std::uint32_t const SizeClass, std::uint32_t const Count) noexcept
+		{
+			WDUL_ASSERT(Count != 0 && Count <= mBins[SizeClass].count);
+			auto& bin = mBins[SizeClass];
+			auto const first = bin.head;
+			auto last = first;
+			for (std::uint32_t i = 1; i != Count; ++i)
+			{
+				last = last->next;
+			}
+			bin.head = last->next;
+			bin.count -= Count;
+			last->next = nullptr;
+			first->count = Count;
+			pool_depot_push(SizeClass, first);
+		}
+
+		// Takes a batch from the depot, or failing that, carves a new slab into blocks.
+		void refill(std::uint32_t const SizeClass)
+		{
+			auto& bin = mBins[SizeClass];
+			if (auto const batch = pool_depot_pop(SizeClass))
+			{
+				bin.head = batch;
+				bin.count = batch->count;
+				return;
+			}
+
+			auto const slab = static_cast<std::uint8_t*>(VirtualAlloc(nullptr, pool_slab_size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+			if (!slab)
+			{
+				throw std::bad_alloc();
+			}
+			// Carve the slab into batches. The first batch is kept, and the rest are moved to the depot at once. Keeping the whole
+			// slab would put the cache over its limit, so every later deallocation would flush a batch to the depot.
+			auto const blockSize = pool_class_sizes[SizeClass];
+			auto const blockCount = static_cast<std::uint32_t>(pool_slab_size / blockSize);
+			pool_free_block* firstSpare = nullptr;
+			pool_free_block* lastSpare = nullptr;
+			for (std::uint32_t first = 0; first < blockCount; first += pool_batch_size)
+			{
+				auto const count = (std::min)(blockCount - first, pool_batch_size);
+				auto const batch = reinterpret_cast<pool_free_block*>(slab + static_cast<std::size_t>(first) * blockSize);
+				auto block = batch;
+				for (std::uint32_t i = 1; i != count; ++i)
+				{
+					block = block->next = reinterpret_cast<pool_free_block*>(reinterpret_cast<std::uint8_t*>(block) + blockSize);
+				}
+				block->next = nullptr;
+				batch->count = count;
+				batch->next_batch = nullptr;
+
+				if (first == 0)
+				{
+					bin.head = batch;
+					bin.count = count;
+				}
+				else if (lastSpare)
+				{
+					lastSpare->next_batch = batch;
+					lastSpare = batch;
+				}
+				else
+				{
+					firstSpare = lastSpare = batch;
+				}
+			}
+			if (firstSpare)
+			{
+				pool_depot_push(SizeClass, firstSpare, lastSpare);
+			}
+		}
+
+		bin mBins[pool_class_count];
+	};
+
+	thread_local pool_thread_cache pool_cache;
+
+	[[nodiscard]] void* pool_allocate(std::size_t const Size)
+	{
+		auto const sizeClass = pool_size_class(Size);
+		pool_header* header;
+		if (sizeClass == pool_large_class)
+		{
+			if (Size > (std::numeric_limits<std::size_t>::max)() - pool_header_size)
+			{
+				throw std::bad_alloc();
+			}
+			header = static_cast<pool_header*>(malloc_traits::allocate(pool_header_size + Size));
+		}
+		else
+		{
+			header = pool_cache.pop(sizeClass);
+		}
+		header->size_class = sizeClass;
+		header->size = Size;
+		return header + 1;
+	}
+
+	[[nodiscard]] void* pool_allocate_zeroed(std::size_t const Size)
+	{
+		if (pool_size_class(Size) != pool_large_class)
+		{
+			auto const p = pool_allocate(Size);
+			std::memset(p, 0, Size);
+			return p;
+		}
+		if (Size > (std::numeric_limits<std::size_t>::max)() - pool_header_size)
+		{
+			throw std::bad_alloc();
+		}
+		// Large blocks come from calloc, which can skip zeroing storage that is fresh from the operating system.
+		auto const header = static_cast<pool_header*>(malloc_traits::allocate_zeroed(pool_header_size + Size));
+		header->size_class = pool_large_class;
+		header->size = Size;
+		return header + 1;
+	}
+
+	void pool_deallocate(void* const Ptr) noexcept
+	{
+		WDUL_ASSERT(Ptr != nullptr);
+		auto const header = pool_get_header(Ptr);
+		if (header->size_class == pool_large_class)
+		{
+			malloc_traits::deallocate(header);
+			return;
+		}
+		WDUL_ASSERT(header->size_class < pool_class_count);
+		pool_cache.push(header->size_class, header);
+	}
+
+	[[nodiscard]] void* pool_expand(void* const Ptr, std::size_t const Size) noexcept
+	{
+		if (!Ptr)
+		{
+			return nullptr;
+		}
+		auto const header = pool_get_header(Ptr);
+		auto const capacity = header->size_class == pool_large_class ? header->size : pool_class_sizes[header->size_class] - pool_header_size;
+		if (Size > capacity)
+		{
+			return nullptr;
+		}
+		header->size = Size;
+		return Ptr;
+	}
+
+	[[nodiscard]] void* pool_reallocate(void* const Ptr, std::size_t const Size)
+	{
+		if (!Ptr)
+		{
+			return pool_allocate(Size);
+		}
+		if (pool_expand(Ptr, Size))
+		{
+			return Ptr;
+		}
+
+		auto const header = pool_get_header(Ptr);
+		if (header->size_class == pool_large_class && pool_size_class(Size) == pool_large_class)
+		{
+			if (Size > (std::numeric_limits<std::size_t>::max)() - pool_header_size)
+			{
+				throw std::bad_alloc();
+			}
+			auto const newHeader = static_cast<pool_header*>(malloc_traits::reallocate(header, pool_header_size + Size));
+			newHeader->size = Size;
+			return newHeader + 1;
+		}
+
+		auto const p = pool_allocate(Size);
+		std::memcpy(p, Ptr, (std::min)(header->size, Size));
+		pool_deallocate(Ptr);
+		return p;
+	}
+
+	[[nodiscard]] std::size_t pool_size(void const* const Ptr) noexcept
+	{
+		WDUL_ASSERT(Ptr != nullptr);
+		return pool_get_header(Ptr)->size;
+	}
+
+	[[nodiscard]] allocation_counters& acquire_allocation_counters(allocation_registry& Registry) noexcept
+	{
+		for (auto counters = Registry.head.load(std::memory_order_acquire); counters; counters = counters->next)
+		{
+			bool inUse = false;
+			if (!counters->in_use.load(std::memory_order_relaxed) &&
+				counters->in_use.compare_exchange_strong(inUse, true, std::memory_order_acquire))
+			{
+				return *counters;
+			}
+		}
+
+		auto const counters = new (std::nothrow) allocation_counters();
+		if (!counters)
+		{
+			return Registry.shared_counters;
+		}
+		counters->in_use.store(true, std::memory_order_relaxed);
+		counters->next = Registry.head.load(std::memory_order_relaxed);
+		while (!Registry.head.compare_exchange_weak(counters->next, counters, std::memory_order_release, std::memory_order_relaxed));
+		return *counters;
+	}
+
+	[[nodiscard]] allocation_stats collect_allocation_stats(allocation_registry const& Registry) noexcept
+	{
+		allocation_stats stats{};
+		auto const add = [&stats](allocation_counters const& Counters) noexcept
+		{
+			stats.allocations += Counters.allocations.load(std::memory_order_relaxed);
+			stats.deallocations += Counters.deallocations.load(std::memory_order_relaxed);
+			stats.in_place_reallocations += Counters.in_place_reallocations.load(std::memory_order_relaxed);
+			stats.moving_reallocations += Counters.moving_reallocations.load(std::memory_order_relaxed);
+			stats.total_bytes += Counters.total_bytes.load(std::memory_order_relaxed);
+			for (std::size_t i = 0; i != allocation_histogram_buckets; ++i)
+			{
+				stats.size_histogram[i] += Counters.size_histogram[i].load(std::memory_order_relaxed);
+			}
+		};
+		for (auto counters = Registry.head.load(std::memory_order_acquire); counters; counters = counters->next)
+		{
+			add(*counters);
+		}
+		add(Registry.shared_counters);
+		stats.live_bytes = Registry.live_bytes.load(std::memory_order_relaxed);
+		stats.peak_bytes = Registry.peak_bytes.load(std::memory_order_relaxed);
+		return stats;
+	}
+}
+
+namespace wdul
+{
+	[[nodiscard]] std::string format_allocation_stats(_In_z_ char const* const Name, allocation_stats const& Stats)
+	{
+		std::string str;
+		str.append(Name);
+		str.append(": ");
+		str.append(std::to_string(Stats.allocations));
+		str.append(" allocations, ");
+		str.append(std::to_string(Stats.deallocations));
+		str.append(" deallocations, ");
+		str.append(std::to_string(Stats.in_place_reallocations));
+		str.append(" in-place reallocations, ");
+		str.append(std::to_string(Stats.moving_reallocations));
+		str.append(" moving reallocations, ");
+		str.append(std::to_string(Stats.total_bytes));
+		str.append(" bytes requested, ");
+		str.append(std::to_string(Stats.live_bytes));
+		str.append(" live bytes, ");
+		str.append(std::to_string(Stats.peak_bytes));
+		str.append(" peak bytes; sizes:");
+		for (std::size_t i = 0; i != allocation_histogram_buckets; ++i)
+		{
+			if (Stats.size_histogram[i] == 0)
+			{
+				continue;
+			}
+			str.append(" [");
+			str.append(std::to_string(std::uint64_t(1) << i));
+			if (i == allocation_histogram_buckets - 1)
+			{
+				str.append("+");
+			}
+			str.append("]=");
+			str.append(std::to_string(Stats.size_histogram[i]));
+		}
+		return str;
+	}
+}
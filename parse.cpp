@@ -3,56 +3,549 @@
 
 #include "include/wdul/parse.hpp"
 #include "include/wdul/debug.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+#if defined(_M_IX86) || defined(_M_X64)
+#define WDUL_PARSE_X86 1
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+namespace wdul::impl
+{
+	// Each function below returns the first position P in [First, Last) where P[0] == C0 and, if Pair is true, P[1] == C1.
+	// Returns Last if there is no such position. If Pair is true, Last[0] must be readable.
+
+	template <bool Pair>
+	[[nodiscard]] char8_t const* find_candidate_scalar(char8_t const* First, char8_t const* const Last, char8_t const C0,
+		[[maybe_unused]] char8_t const C1) noexcept
+	{
+		if constexpr (!Pair)
+		{
+			if (First == Last)
+			{
+				// An empty range may be made of null pointers, which memchr does not accept.
+				return Last;
+			}
+			auto const p = std::memchr(First, C0, static_cast<std::size_t>(Last - First));
+			return p ? static_cast<char8_t const*>(p) : Last;
+		}
+		else
+		{
+			for (; First != Last; ++First)
+			{
+				if (First[0] == C0 && First[1] == C1)
+				{
+					return First;
+				}
+			}
+			return Last;
+		}
+	}
+
+#ifdef WDUL_PARSE_X86
+	template <bool Pair>
+	[[nodiscard]] char8_t const* find_candidate_sse2(char8_t const* First, char8_t const* const Last, char8_t const C0,
+		char8_t const C1) noexcept
+	{
+		auto const c0 = _mm_set1_epi8(static_cast<char>(C0));
+		[[maybe_unused]] auto const c1 = _mm_set1_epi8(static_cast<char>(C1));
+		for (; Last - First >= 16; First += 16)
+		{
+			auto eq = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<__m128i const*>(First)), c0);
+			if constexpr (Pair)
+			{
+				eq = _mm_and_si128(eq, _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<__m128i const*>(First + 1)), c1));
+			}
+			if (auto const mask = static_cast<std::uint32_t>(_mm_movemask_epi8(eq)); mask != 0)
+			{
+				return First + std::countr_zero(mask);
+			}
+		}
+		return find_candidate_scalar<Pair>(First, Last, C0, C1);
+	}
+
+	template <bool Pair>
+	[[nodiscard]] char8_t const* find_candidate_avx2(char8_t const* First, char8_t const* const Last, char8_t const C0,
+		char8_t const C1) noexcept
+	{
+		auto const c0 = _mm256_set1_epi8(static_cast<char>(C0));
+		[[maybe_unused]] auto const c1 = _mm256_set1_epi8(static_cast<char>(C1));
+		for (; Last - First >= 32; First += 32)
+		{
+			auto eq = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<__m256i const*>(First)), c0);
+			if constexpr (Pair)
+			{
+				eq = _mm256_and_si256(eq, _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<__m256i const*>(First + 1)), c1));
+			}
+			if (auto const mask = static_cast<std::uint32_t>(_mm256_movemask_epi8(eq)); mask != 0)
+			{
+				return First + std::countr_zero(mask);
+			}
+		}
+		return find_candidate_sse2<Pair>(First, Last, C0, C1);
+	}
+
+	[[nodiscard]] bool cpu_supports_avx2() noexcept
+	{
+		int info[4];
+		__cpuid(info, 0);
+		if (info[0] < 7)
+		{
+			return false;
+		}
+
+		// The processor must support AVX and XSAVE, and the operating system must save the YMM registers on context switches.
+		__cpuid(info, 1);
+		constexpr int osxsave = 1 << 27, avx = 1 << 28;
+		if ((info[2] & (osxsave | avx)) != (osxsave | avx) || (_xgetbv(0) & 6) != 6)
+		{
+			return false;
+		}
+
+		__cpuidex(info, 7, 0);
+		return (info[1] & (1 << 5)) != 0;
+	}
+#endif
+
+	[[nodiscard]] char8_t const* find_first_of_scalar(char8_t const* First, char8_t const* const Last, char_set const& Set) noexcept
+	{
+		for (; First != Last; ++First)
+		{
+			if (Set.contains(*First))
+			{
+				return First;
+			}
+		}
+		return Last;
+	}
+
+#ifdef WDUL_PARSE_X86
+	// Returns the first position P in [First, Last) where *P is any of the four characters of Chars, or Last.
+	[[nodiscard]] char8_t const* find_any4_sse2(char8_t const* First, char8_t const* const Last, char8_t const (&Chars)[4],
+		char_set const& Set) noexcept
+	{
+		auto const c0 = _mm_set1_epi8(static_cast<char>(Chars[0]));
+		auto const c1 = _mm_set1_epi8(static_cast<char>(Chars[1]));
+		auto const c2 = _mm_set1_epi8(static_cast<char>(Chars[2]));
+		auto const c3 = _mm_set1_epi8(static_cast<char>(Chars[3]));
+		for (; Last - First >= 16; First += 16)
+		{
+			auto const v = _mm_loadu_si128(reinterpret_cast<__m128i const*>(First));
+			auto const eq = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, c0), _mm_cmpeq_epi8(v, c1)),
+				_mm_or_si128(_mm_cmpeq_epi8(v, c2), _mm_cmpeq_epi8(v, c3)));
+			if (auto const mask = static_cast<std::uint32_t>(_mm_movemask_epi8(eq)); mask != 0)
+			{
+				return First + std::countr_zero(mask);
+			}
+		}
+		return find_first_of_scalar(First, Last, Set);
+	}
+
+	[[nodiscard]] char8_t const* find_any4_avx2(char8_t const* First, char8_t const* const Last, char8_t const (&Chars)[4],
+		char_set const& Set) noexcept
+	{
+		auto const c0 = _mm256_set1_epi8(static_cast<char>(Chars[0]));
+		auto const c1 = _mm256_set1_epi8(static_cast<char>(Chars[1]));
+		auto const c2 = _mm256_set1_epi8(static_cast<char>(Chars[2]));
+		auto const c3 = _mm256_set1_epi8(static_cast<char>(Chars[3]));
+		for (; Last - First >= 32; First += 32)
+		{
+			auto const v = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(First));
+			auto const eq = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, c0), _mm256_cmpeq_epi8(v, c1)),
+				_mm256_or_si256(_mm256_cmpeq_epi8(v, c2), _mm256_cmpeq_epi8(v, c3)));
+			if (auto const mask = static_cast<std::uint32_t>(_mm256_movemask_epi8(eq)); mask != 0)
+			{
+				return First + std::countr_zero(mask);
+			}
+		}
+		return find_any4_sse2(First, Last, Chars, Set);
+	}
+
+	// Classifies each character by its low and high four bits with two table lookups. Bit (H & 7) of entry L of the low
+	// table is set if the set contains a character with high bits H and low bits L. High bits H and H ^ 8 share a bit, so a
+	// character which passes the classification may not be in the set, and is checked against the set.
+	[[nodiscard]] char8_t const* find_first_of_avx2(char8_t const* First, char8_t const* const Last, char_set const& Set) noexcept
+	{
+		char8_t chars[256];
+		auto const count = Set.copy(chars, 256);
+		alignas(16) std::uint8_t low[16] = {};
+		for (std::size_t i = 0; i != count; ++i)
+		{
+			low[chars[i] & 15] |= static_cast<std::uint8_t>(1 << ((chars[i] >> 4) & 7));
+		}
+		auto const lowTable = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<__m128i const*>(low)));
+		auto const highTable = _mm256_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128,
+			1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+		auto const nibble = _mm256_set1_epi8(0x0F);
+		auto const zero = _mm256_setzero_si256();
+		for (; Last - First >= 32; First += 32)
+		{
+			auto const v = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(First));
+			auto const l = _mm256_shuffle_epi8(lowTable, _mm256_and_si256(v, nibble));
+			auto const h = _mm256_shuffle_epi8(highTable, _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble));
+			auto mask = ~static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_and_si256(l, h), zero)));
+			for (; mask != 0; mask &= mask - 1)
+			{
+				auto const p = First + std::countr_zero(mask);
+				if (Set.contains(*p))
+				{
+					return p;
+				}
+			}
+		}
+		return find_first_of_scalar(First, Last, Set);
+	}
+#endif
+
+	template <bool Pair>
+	[[nodiscard]] char8_t const* find_candidate(char8_t const* const First, char8_t const* const Last, char8_t const C0,
+		char8_t const C1, [[maybe_unused]] find_delimiter_isa const Isa) noexcept
+	{
+#ifdef WDUL_PARSE_X86
+		switch (Isa)
+		{
+		case find_delimiter_isa::avx2: return find_candidate_avx2<Pair>(First, Last, C0, C1);
+		case find_delimiter_isa::sse2: return find_candidate_sse2<Pair>(First, Last, C0, C1);
+		default: break;
+		}
+#endif
+		return find_candidate_scalar<Pair>(First, Last, C0, C1);
+	}
+
+	[[nodiscard]] find_delimiter_isa find_delimiter_best_isa() noexcept
+	{
+#ifdef WDUL_PARSE_X86
+		// SSE2 is supported by every processor Windows runs on.
+		static find_delimiter_isa const isa = cpu_supports_avx2() ? find_delimiter_isa::avx2 : find_delimiter_isa::sse2;
+		return isa;
+#else
+		return find_delimiter_isa::scalar;
+#endif
+	}
+
+	[[nodiscard]] char8_t const* find_first_of(range<char8_t const> const Buffer, char_set const& Set,
+		[[maybe_unused]] find_delimiter_isa const Isa) noexcept
+	{
+		WDUL_ASSERT(Buffer.first <= Buffer.last);
+
+		// Find up to five characters of the set, to determine whether the set is small enough to compare against each character.
+		char8_t chars[5];
+		auto const count = Set.copy(chars, 5);
+
+		if (count == 0)
+		{
+			return Buffer.last;
+		}
+		if (count == 1)
+		{
+			return find_candidate<false>(Buffer.first, Buffer.last, chars[0], 0, Isa);
+		}
+#ifdef WDUL_PARSE_X86
+		if (count <= 4)
+		{
+			// Repeat the first character to make up four characters.
+			char8_t const four[4] = { chars[0], chars[1], count > 2 ? chars[2] : chars[0], count > 3 ? chars[3] : chars[0] };
+			switch (Isa)
+			{
+			case find_delimiter_isa::avx2: return find_any4_avx2(Buffer.first, Buffer.last, four, Set);
+			case find_delimiter_isa::sse2: return find_any4_sse2(Buffer.first, Buffer.last, four, Set);
+			default: break;
+			}
+		}
+		else if (Isa == find_delimiter_isa::avx2)
+		{
+			return find_first_of_avx2(Buffer.first, Buffer.last, Set);
+		}
+#endif
+		return find_first_of_scalar(Buffer.first, Buffer.last, Set);
+	}
+
+	range<char8_t const> find_delimiter(range<char8_t const> const Buffer, range<char8_t const> const Delim,
+		find_delimiter_isa const Isa) noexcept
+	{
+		WDUL_ASSERT(Buffer.first <= Buffer.last);
+		WDUL_ASSERT(Delim.first < Delim.last);
+
+		auto const delimSize = static_cast<std::size_t>(Delim.last - Delim.first);
+		auto const bufferSize = static_cast<std::size_t>(Buffer.last - Buffer.first);
+
+		if (bufferSize >= delimSize)
+		{
+			// The delimiter can only be found in its entirety at positions before candidatesLast. Candidates are positions which
+			// match the first two characters of the delimiter, or the first character of a single character delimiter. The
+			// remaining characters of each candidate are then compared.
+			auto const candidatesLast = Buffer.last - (delimSize - 1);
+			for (auto p = Buffer.first;; ++p)
+			{
+				p = delimSize == 1 ?
+					find_candidate<false>(p, candidatesLast, Delim.first[0], 0, Isa) :
+					find_candidate<true>(p, candidatesLast, Delim.first[0], Delim.first[1], Isa);
+				if (p == candidatesLast)
+				{
+					break;
+				}
+				if (delimSize <= 2 || std::memcmp(p + 2, Delim.first + 2, delimSize - 2) == 0)
+				{
+					// The delimiter was found in its entirety.
+					return { .first = p, .last = p + delimSize };
+				}
+			}
+		}
+
+		// The delimiter was not found in its entirety. Look for the longest substring at the end of the buffer which matches the
+		// start of the delimiter.
+		for (auto n = (std::min)(delimSize - 1, bufferSize); n != 0; --n)
+		{
+			if (std::memcmp(Buffer.last - n, Delim.first, n) == 0)
+			{
+				return { .first = Buffer.last - n, .last = Buffer.last };
+			}
+		}
+
+		return { .first = Buffer.last, .last = Buffer.last };
+	}
+}
 
 namespace wdul
 {
 	range<char8_t const> find_delimiter(range<char8_t const> const Buffer, range<char8_t const> const Delim) noexcept
 	{
-		WDUL_ASSERT(Buffer.first <= Buffer.last);
+		return impl::find_delimiter(Buffer, Delim, impl::find_delimiter_best_isa());
+	}
+
+	[[nodiscard]] char8_t const* find_first_of(range<char8_t const> const Buffer, char_set const& Set) noexcept
+	{
+		return impl::find_first_of(Buffer, Set, impl::find_delimiter_best_isa());
+	}
+
+	delimiter_matcher::delimiter_matcher(range<char8_t const> const Delim) :
+		mDelim(Delim),
+		mMatched(0)
+	{
 		WDUL_ASSERT(Delim.first < Delim.last);
+		leave_uninitialized(mInlineFailure);
+
+		auto const delimSize = size();
+		if (delimSize > inline_capacity)
+		{
+			mHeapFailure.resize(delimSize);
+		}
+
+		auto const d = mDelim.first;
+		auto const fail = failure();
+		fail[0] = 0;
+		std::uint32_t k = 0;
+		for (std::size_t i = 1; i != delimSize; ++i)
+		{
+			while (k != 0 && d[i] != d[k])
+			{
+				k = fail[k - 1];
+			}
+			if (d[i] == d[k])
+			{
+				++k;
+			}
+			fail[i] = k;
+		}
+	}
+
+	[[nodiscard]] char8_t const* delimiter_matcher::feed(range<char8_t const> const Chunk) noexcept
+	{
+		WDUL_ASSERT(Chunk.first <= Chunk.last);
+
+		auto const d = mDelim.first;
+		auto const delimSize = size();
+		auto const fail = failure();
+		for (auto p = Chunk.first; p != Chunk.last; ++p)
+		{
+			if (mMatched == 0)
+			{
+				// Skip to the next occurrence of the first character of the delimiter.
+				p = find_delimiter({ .first = p, .last = Chunk.last }, { .first = d, .last = d + 1 }).first;
+				if (p == Chunk.last)
+				{
+					break;
+				}
+			}
+
+			// Fall back through the failure table until the character extends a match, or nothing is matched.
+			while (mMatched != 0 && *p != d[mMatched])
+			{
+				mMatched = fail[mMatched - 1];
+			}
+			if (*p == d[mMatched] && ++mMatched == delimSize)
+			{
+				// The delimiter was found in its entirety.
+				mMatched = 0;
+				return p + 1;
+			}
+		}
+		return nullptr;
+	}
 
-		auto const delimSize = Delim.last - Delim.first;
+	delimiter_set::delimiter_set(std::span<std::u8string_view const> const Delims) :
+		mMaxSize(0)
+	{
+		WDUL_ASSERT(!Delims.empty());
+
+		// Build a trie of the delimiters. Until the automaton is complete, a transition to state zero means there is none, as
+		// no delimiter leads back to the initial state.
+		mStates.push_back({ .depth = 0, .extendable_depth = 0, .output = no_output });
+		mNext.resize(256);
+		mSizes.reserve(Delims.size());
+		for (std::size_t i = 0; i != Delims.size(); ++i)
+		{
+			auto const delim = Delims[i];
+			WDUL_ASSERT(!delim.empty());
+			mSizes.push_back(delim.size());
+			mMaxSize = (std::max)(mMaxSize, delim.size());
+			mFirst.insert(delim.front());
 
-		/* An empty delimiter is not currently allowed.
-			if (delimSize == 0)
+			std::uint32_t s = 0;
+			for (auto const ch : delim)
 			{
-				// The delimiter was empty.
-				return { Buffer.first, Buffer.first };
+				auto const t = std::size_t(s) * 256 + ch;
+				if (mNext[t] == 0)
+				{
+					mNext[t] = static_cast<std::uint32_t>(mStates.size());
+					mStates.push_back({ .depth = mStates[s].depth + 1, .extendable_depth = 0, .output = no_output });
+					mNext.resize(mNext.size() + 256);
+				}
+				s = mNext[t];
+			}
+
+			// If a delimiter appears more than once, the first is reported.
+			if (mStates[s].output == no_output)
+			{
+				mStates[s].output = static_cast<std::uint32_t>(i);
 			}
-		*/
+		}
 
-		range<char8_t const> match{};
+		// Visit the states in order of depth, computing the failure transition of each (the state of the longest proper suffix
+		// of its prefix), and completing the transitions of each from those of its failure state.
+		std::vector<std::uint32_t> fail(mStates.size(), 0);
+		std::vector<std::uint32_t> queue;
+		queue.reserve(mStates.size());
 
-		for (auto p = Buffer.first; p != Buffer.last; ++p)
+		auto const discover = [&](std::uint32_t const State, std::uint32_t const Fail)
 		{
-			if (*p == Delim.first[match.last - match.first])
+			fail[State] = Fail;
+			auto& state = mStates[State];
+			if (state.output == no_output)
 			{
-				if (*p == *Delim.first)
+				state.output = mStates[Fail].output;
+			}
+			auto const row = mNext.begin() + std::size_t(State) * 256;
+			auto const hasChildren = std::any_of(row, row + 256, [](std::uint32_t const Next) { return Next != 0; });
+			state.extendable_depth = hasChildren ? state.depth : mStates[Fail].extendable_depth;
+			queue.push_back(State);
+		};
+
+		for (std::size_t ch = 0; ch != 256; ++ch)
+		{
+			if (auto const next = mNext[ch]; next != 0)
+			{
+				discover(next, 0);
+			}
+		}
+		for (std::size_t q = 0; q != queue.size(); ++q)
+		{
+			auto const u = queue[q];
+			for (std::size_t ch = 0; ch != 256; ++ch)
+			{
+				auto const t = std::size_t(u) * 256 + ch;
+				auto const failNext = mNext[std::size_t(fail[u]) * 256 + ch];
+				if (auto const next = mNext[t]; next != 0)
 				{
-					// The first character of the delimiter was found.
-					match.first = p;
-					match.last = p + 1;
+					discover(next, failNext);
 				}
 				else
 				{
-					// The next character of the delimiter was found.
-					++match.last;
+					mNext[t] = failNext;
+				}
+			}
+		}
+	}
+
+	[[nodiscard]] bool delimiter_set_matcher::feed(range<char8_t const> const Chunk, delimiter_set_match& Match) noexcept
+	{
+		WDUL_ASSERT(Chunk.first <= Chunk.last);
+
+		auto const next = mDelims->mNext.data();
+		auto const states = mDelims->mStates.data();
+		auto const chunkPosition = mPosition;
+		for (auto p = Chunk.first; p != Chunk.last;)
+		{
+			if (mState == 0 && !mHasCandidate)
+			{
+				// Skip to the next character which can begin a delimiter.
+				p = find_first_of({ .first = p, .last = Chunk.last }, mDelims->mFirst);
+				if (p == Chunk.last)
+				{
+					break;
 				}
-				if (match.last - match.first == delimSize)
+			}
+
+			mState = next[std::size_t(mState) * 256 + *p++];
+			auto const& state = states[mState];
+			auto const end = chunkPosition + static_cast<std::uint64_t>(p - Chunk.first);
+
+			if (state.output != delimiter_set::no_output)
+			{
+				// Prefer the match which begins first, then the longest.
+				auto const first = end - mDelims->mSizes[state.output];
+				if (!mHasCandidate || first <= mCandidate.first)
 				{
-					// The delimiter was found in its entirety.
-					return match;
+					mCandidate = { .delimiter = state.output, .first = first, .last = end };
+					mHasCandidate = true;
 				}
 			}
-			else
+
+			if (mHasCandidate && state.extendable_depth < end - mCandidate.first)
 			{
-				// Character does not match delimiter.
-				match.first = p;
-				match.last = p;
+				// No delimiter which is yet to be completed can begin at or before the candidate.
+				Match = mCandidate;
+				mPosition = Match.last;
+				mState = 0;
+				mHasCandidate = false;
+				return true;
 			}
 		}
 
-		// The delimiter was not found in its entirety.
-		return match;
+		mPosition = chunkPosition + static_cast<std::uint64_t>(Chunk.last - Chunk.first);
+		return false;
+	}
+
+	[[nodiscard]] bool delimiter_set_matcher::finish(delimiter_set_match& Match) noexcept
+	{
+		mState = 0;
+		if (!mHasCandidate)
+		{
+			return false;
+		}
+		Match = mCandidate;
+		mPosition = Match.last;
+		mHasCandidate = false;
+		return true;
+	}
+
+	[[nodiscard]] std::size_t delimiter_set_matcher::pending() const noexcept
+	{
+		std::size_t const alive = mDelims->mStates[mState].depth;
+		if (mHasCandidate)
+		{
+			return (std::max)(alive, static_cast<std::size_t>(mPosition - mCandidate.first));
+		}
+		return alive;
+	}
+
+	[[nodiscard]] delimiter_set const& newline_delimiters()
+	{
+		static std::u8string_view const delims[] = { u8"\r\n", u8"\n", u8"\r" };
+		static delimiter_set const set(delims);
+		return set;
 	}
 }
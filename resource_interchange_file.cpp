@@ -29,29 +29,43 @@ namespace wdul
 			}
 		}
 
-		DWORD buffer, numBytesRead;
-		if (!ReadFile(file.get(), &buffer, 4, &numBytesRead, {})) throw_last_error();
-		if (numBytesRead != 4) return riff_reader_error_code::bad_format;
-		if (buffer != MAKEFOURCC('R', 'I', 'F', 'F')) return riff_reader_error_code::bad_format;
-
-		// Read the file size field. We don't currently use this field.
-		if (!ReadFile(file.get(), &buffer, 4, &numBytesRead, {})) throw_last_error();
-		if (numBytesRead != 4) return riff_reader_error_code::bad_format;
+		mFileSource = file_source(std::move(file), 0);
+		mSource = &mFileSource;
+		return read_header();
+	}
 
-		if (!ReadFile(file.get(), &mFileType, 4, &numBytesRead, {})) throw_last_error();
-		if (numBytesRead != 4) return riff_reader_error_code::bad_format;
+	[[nodiscard]] riff_reader_error_code riff_reader::attach(byte_source& Source)
+	{
+		if (mState != riff_reader_state::closed)
+		{
+			throw hresult_invalid_state();
+		}
 
-		mFile.put_ref() = file.detach();
-		mState = riff_reader_state::chunk_info;
-		return riff_reader_error_code::success;
+		mSource = &Source;
+		return read_header();
 	}
 
 	void riff_reader::close() noexcept
 	{
-		WDUL_DEBUG_RAISE_LAST_ERROR_WHEN(mFile.try_close(), == false);
+		mFileSource.close();
+		mSource = nullptr;
 		mState = riff_reader_state::closed;
 	}
 
+	[[nodiscard]] riff_reader_error_code riff_reader::read_header()
+	{
+		// The RIFF chunk identifier, the file size field (which we don't currently use), and the file type.
+		std::uint32_t header[3];
+		auto closer = finally([&]() { close(); });
+		if (read(header, sizeof(header)) != sizeof(header)) return riff_reader_error_code::bad_format;
+		if (header[0] != MAKEFOURCC('R', 'I', 'F', 'F')) return riff_reader_error_code::bad_format;
+		closer.revoke();
+
+		mFileType = header[2];
+		mState = riff_reader_state::chunk_info;
+		return riff_reader_error_code::success;
+	}
+
 	[[nodiscard]] riff_reader_error_code riff_reader::read_chunk_info()
 	{
 		if (mState != riff_reader_state::chunk_info)
@@ -63,14 +77,11 @@ namespace wdul
 
 	[[nodiscard]] riff_reader_error_code riff_reader::read_chunk_info_unchecked()
 	{
-		DWORD numBytesRead;
-		if (!ReadFile(mFile.get(), &mChunkInfo.id, 4, &numBytesRead, {})) throw_last_error();
-		if (numBytesRead != 4) return riff_reader_error_code::end;
+		if (read(&mChunkInfo.id, 4) != 4) return riff_reader_error_code::end;
 
 		auto unknownifier = finally([&]() { mState = riff_reader_state::unknown; });
 
-		if (!ReadFile(mFile.get(), &mChunkInfo.length, 4, &numBytesRead, {})) throw_last_error();
-		if (numBytesRead != 4) return riff_reader_error_code::bad_format;
+		if (read(&mChunkInfo.length, 4) != 4) return riff_reader_error_code::bad_format;
 
 		unknownifier.revoke();
 
@@ -85,12 +96,10 @@ namespace wdul
 			throw hresult_invalid_state();
 		}
 
-		DWORD numBytesRead;
-		if (!ReadFile(mFile.get(), Buffer, mChunkInfo.length, &numBytesRead, {})) throw_last_error();
-		if (numBytesRead != mChunkInfo.length) return riff_reader_error_code::bad_format;
+		if (read(Buffer, mChunkInfo.length) != mChunkInfo.length) return riff_reader_error_code::bad_format;
 
 		auto unknownifier = finally([&]() { mState = riff_reader_state::unknown; });
-		skip_padding(mFile.get(), mChunkInfo.length);
+		skip_padding(mChunkInfo.length);
 		unknownifier.revoke();
 
 		mState = riff_reader_state::chunk_info;
@@ -163,12 +172,7 @@ namespace wdul
 	void riff_reader::reposition(std::int64_t const FilePtr, riff_chunk_info const& ChunkInfo, riff_reader_state const State)
 	{
 		if (mState == riff_reader_state::closed) throw hresult_invalid_state();
-		LARGE_INTEGER distance;
-		distance.QuadPart = FilePtr;
-		if (!SetFilePointerEx(mFile.get(), distance, {}, FILE_BEGIN))
-		{
-			throw_last_error();
-		}
+		mSource->seek(static_cast<std::uint64_t>(FilePtr));
 		mChunkInfo = ChunkInfo;
 		mState = State;
 	}
@@ -176,19 +180,15 @@ namespace wdul
 	[[nodiscard]] std::int64_t riff_reader::file_pointer() const
 	{
 		if (mState == riff_reader_state::closed) throw hresult_invalid_state();
-		LARGE_INTEGER fp;
-		if (!SetFilePointerEx(mFile.get(), {}, &fp, FILE_CURRENT)) throw_last_error();
-		return fp.QuadPart;
+		return static_cast<std::int64_t>(mSource->position());
 	}
 
-	void riff_reader::skip_padding(_In_ HANDLE const File, std::uint32_t const ChunkLength)
+	void riff_reader::skip_padding(std::uint32_t const ChunkLength)
 	{
 		if ((ChunkLength % 2) == 1)
 		{
 			// If the chunk length is odd, then a pad byte is added to the end of the chunk data.
-			LARGE_INTEGER distance;
-			distance.QuadPart = 1;
-			if (!SetFilePointerEx(File, distance, NULL, FILE_CURRENT)) throw_last_error();
+			skip(1);
 		}
 	}
 
@@ -202,10 +202,103 @@ namespace wdul
 			padding = true;
 		}
 
-		LARGE_INTEGER distance;
-		distance.QuadPart = static_cast<std::int64_t>(mChunkInfo.length) + padding;
-		if (!SetFilePointerEx(mFile.get(), distance, NULL, FILE_CURRENT)) throw_last_error();
+		skip(static_cast<std::uint64_t>(mChunkInfo.length) + padding);
 
 		mState = riff_reader_state::chunk_info;
 	}
+
+	std::size_t riff_reader::read(_Out_writes_bytes_to_(Size, return) void* const Buffer, std::size_t const Size)
+	{
+		auto const out = static_cast<std::uint8_t*>(Buffer);
+		std::size_t total = 0;
+		while (total != Size)
+		{
+			auto const bytesRead = mSource->read({ out + total, Size - total });
+			if (bytesRead == 0)
+			{
+				break;
+			}
+			total += bytesRead;
+		}
+		return total;
+	}
+
+	void riff_reader::skip(std::uint64_t const Size)
+	{
+		if (mSource->seekable())
+		{
+			// Like the file pointer, the position may move beyond the end of the stream, in which case the next read reaches the end.
+			mSource->seek(mSource->position() + Size);
+			return;
+		}
+
+		std::uint8_t discard[4096];
+		auto remaining = Size;
+		while (remaining != 0)
+		{
+			auto const bytesRead = mSource->read({ discard, static_cast<std::size_t>((std::min)(remaining, std::uint64_t(sizeof(discard)))) });
+			if (bytesRead == 0)
+			{
+				break;
+			}
+			remaining -= bytesRead;
+		}
+	}
+
+	[[nodiscard]] riff_reader_error_code riff_read_header_at(_In_ HANDLE const File, std::uint32_t& FileType)
+	{
+		// The RIFF chunk identifier, the file size field (which we don't currently use), and the file type.
+		std::uint32_t header[3];
+		if (fread_at(File, 0, sizeof(header), header, get_thread_io_event()) != sizeof(header)) return riff_reader_error_code::bad_format;
+		if (header[0] != MAKEFOURCC('R', 'I', 'F', 'F')) return riff_reader_error_code::bad_format;
+		FileType = header[2];
+		return riff_reader_error_code::success;
+	}
+
+	[[nodiscard]] riff_reader_error_code riff_read_chunk_at(_In_ HANDLE const File, std::int64_t const Offset, riff_chunk_location& Chunk)
+	{
+		WDUL_ASSERT(Offset >= 0);
+
+		// The chunk identifier and chunk length fields are read together.
+		std::uint32_t fields[2];
+		auto const bytesRead = fread_at(File, static_cast<std::uint64_t>(Offset), sizeof(fields), fields, get_thread_io_event());
+		if (bytesRead == 0) return riff_reader_error_code::end;
+		if (bytesRead != sizeof(fields)) return riff_reader_error_code::bad_format;
+		Chunk.info.id = fields[0];
+		Chunk.info.length = fields[1];
+		Chunk.data_offset = Offset + sizeof(fields);
+		return riff_reader_error_code::success;
+	}
+
+	[[nodiscard]] riff_reader_error_code riff_read_chunk_data_at(_In_ HANDLE const File, riff_chunk_location const& Chunk,
+		_Out_writes_bytes_(Chunk.info.length) void* const Buffer)
+	{
+		if (Chunk.info.length == 0) return riff_reader_error_code::success;
+		auto const bytesRead = fread_at(File, static_cast<std::uint64_t>(Chunk.data_offset), Chunk.info.length, Buffer,
+			get_thread_io_event());
+		if (bytesRead != Chunk.info.length) return riff_reader_error_code::bad_format;
+		return riff_reader_error_code::success;
+	}
+
+	[[nodiscard]] riff_reader_error_code riff_find_chunk_at(_In_ HANDLE const File, std::int64_t const Offset, std::uint32_t const ChunkId,
+		riff_chunk_location& Chunk, std::int64_t const End)
+	{
+		auto offset = Offset;
+		while (offset < End)
+		{
+			riff_chunk_location chunk;
+			auto const code = riff_read_chunk_at(File, offset, chunk);
+			if (code != riff_reader_error_code::success)
+			{
+				return code;
+			}
+			if (chunk.info.id == ChunkId)
+			{
+				Chunk = chunk;
+				return riff_reader_error_code::success;
+			}
+			offset = chunk.next_offset();
+		}
+		return riff_reader_error_code::end;
+	}
 }
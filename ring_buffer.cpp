@@ -0,0 +1,73 @@
+// This file is part of the WillDaisey/WDUL (Windows Desktop Utility Library) project.
+// View this project on github: https://github.com/WillDaisey/wdul/
+
+#include "include/wdul/ring_buffer.hpp"
+#include "include/wdul/error.hpp"
+
+namespace wdul
+{
+	mirrored_ring_buffer::mirrored_ring_buffer(std::size_t const MinCapacity) :
+		mirrored_ring_buffer()
+	{
+		WDUL_ASSERT(MinCapacity != 0);
+
+		// Each view of a file mapping must start on a multiple of the allocation granularity.
+		auto const capacity = impl::round_up_size(MinCapacity, allocation_granularity());
+		if (capacity == 0 || capacity > (std::numeric_limits<std::size_t>::max)() / 2)
+		{
+			throw std::bad_alloc();
+		}
+
+		auto const capacity64 = static_cast<std::uint64_t>(capacity);
+		mMapping.attach(CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, static_cast<DWORD>(capacity64 >> 32),
+			static_cast<DWORD>(capacity64), nullptr));
+		if (!mMapping)
+		{
+			throw_last_error();
+		}
+
+		// Find an address range large enough for both views by reserving it, then release it and map the views in its place.
+		// Another thread may allocate memory in the range before both views are mapped, in which case try again.
+		constexpr int maxAttempts = 16;
+		for (int attempt = 0; attempt != maxAttempts; ++attempt)
+		{
+			auto const base = static_cast<std::uint8_t*>(VirtualAlloc(nullptr, 2 * capacity, MEM_RESERVE, PAGE_NOACCESS));
+			if (!base)
+			{
+				throw std::bad_alloc();
+			}
+			WDUL_DEBUG_RAISE_LAST_ERROR_WHEN(VirtualFree(base, 0, MEM_RELEASE), == 0);
+
+			if (!MapViewOfFileEx(mMapping.get(), FILE_MAP_ALL_ACCESS, 0, 0, capacity, base))
+			{
+				continue;
+			}
+			if (!MapViewOfFileEx(mMapping.get(), FILE_MAP_ALL_ACCESS, 0, 0, capacity, base + capacity))
+			{
+				WDUL_DEBUG_RAISE_LAST_ERROR_WHEN(UnmapViewOfFile(base), == 0);
+				continue;
+			}
+			mData = base;
+			mCapacity = capacity;
+			return;
+		}
+		throw_last_error("failed to map mirrored ring buffer");
+	}
+
+	void mirrored_ring_buffer::release() noexcept
+	{
+		if (mData)
+		{
+			WDUL_DEBUG_RAISE_LAST_ERROR_WHEN(UnmapViewOfFile(mData + mCapacity), == 0);
+			WDUL_DEBUG_RAISE_LAST_ERROR_WHEN(UnmapViewOfFile(mData), == 0);
+			mData = nullptr;
+			mCapacity = 0;
+		}
+		if (mMapping)
+		{
+			WDUL_DEBUG_RAISE_LAST_ERROR_WHEN(mMapping.try_close(), == false);
+		}
+		mReadPos.store(0, std::memory_order_relaxed);
+		mWritePos.store(0, std::memory_order_relaxed);
+	}
+}
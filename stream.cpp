@@ -0,0 +1,418 @@
+// This file is part of the WillDaisey/WDUL (Windows Desktop Utility Library) project.
+// View this project on github: https://github.com/WillDaisey/wdul/
+
+#include "include/wdul/stream.hpp"
+#include "include/wdul/error.hpp"
+#include <array>
+#include <cstring>
+#include <limits>
+
+namespace wdul
+{
+	std::span<std::uint8_t const> byte_source::borrow(std::size_t)
+	{
+		WDUL_ASSERT_MSG(false, "the source is not borrowable");
+		throw hresult_not_implemented();
+	}
+
+	void byte_source::seek(std::uint64_t)
+	{
+		throw hresult_not_implemented();
+	}
+
+	[[nodiscard]] fopen_code file_source::open(_In_z_ wchar_t const* const Filename)
+	{
+		close();
+		auto const code = fopen(mFile.put(), Filename, file_open_mode::open_existing, FILE_FLAG_SEQUENTIAL_SCAN, generic_access::read,
+			file_share_mode::read);
+		if (code == fopen_code::success)
+		{
+			mHandle = mFile.get();
+		}
+		return code;
+	}
+
+	void file_source::share(_In_ HANDLE const File, std::uint64_t const Position) noexcept
+	{
+		WDUL_ASSERT(File != nullptr && File != INVALID_HANDLE_VALUE);
+		close();
+		mHandle = File;
+		mPosition = Position;
+	}
+
+	void file_source::close() noexcept
+	{
+		WDUL_DEBUG_RAISE_LAST_ERROR_WHEN(mFile.try_close(), == false);
+		mHandle = nullptr;
+		mPosition = 0;
+	}
+
+	std::size_t file_source::read(std::span<std::uint8_t> const Buffer)
+	{
+		WDUL_ASSERT(is_open());
+		if (Buffer.empty())
+		{
+			return 0;
+		}
+		auto const bytesRead = fread_at(mHandle, mPosition, static_cast<std::uint32_t>((std::min)(Buffer.size(), std::size_t(0xFFFFFFFF))),
+			Buffer.data(), get_thread_io_event());
+		mPosition += bytesRead;
+		return bytesRead;
+	}
+
+	std::size_t memory_source::read(std::span<std::uint8_t> const Buffer)
+	{
+		auto const bytes = borrow(Buffer.size());
+		if (!bytes.empty())
+		{
+			std::memcpy(Buffer.data(), bytes.data(), bytes.size());
+		}
+		return bytes.size();
+	}
+
+	[[nodiscard]] fopen_code mapped_source::open(_In_z_ wchar_t const* const Filename)
+	{
+		close();
+		mapped_file file;
+		auto const code = file.open(Filename);
+		if (code == fopen_code::success)
+		{
+			// The view remains valid after the file is closed.
+			mView = file.view();
+			reset(mView.bytes());
+		}
+		return code;
+	}
+
+	byte_transform_result utf16_to_utf8_transform::transform(std::span<std::uint8_t const> const Input,
+		std::span<std::uint8_t> const Output, bool const Final)
+	{
+		auto in = Input.data();
+		auto const inEnd = in + Input.size();
+		auto out = Output.data();
+		auto const outEnd = out + Output.size();
+
+		auto const unit = [](std::uint8_t const* const P) noexcept
+		{
+			return static_cast<std::uint32_t>(P[0] | (P[1] << 8));
+		};
+
+		if (!mStarted)
+		{
+			if (inEnd - in < 2 && !Final)
+			{
+				return { 0, 0 };
+			}
+			mStarted = true;
+			if (inEnd - in >= 2 && unit(in) == 0xFEFF)
+			{
+				in += 2;
+			}
+		}
+
+		while (in != inEnd)
+		{
+			std::uint32_t codePoint;
+			std::size_t unitsSize;
+			if (inEnd - in < 2)
+			{
+				if (!Final)
+				{
+					break;
+				}
+				codePoint = 0xFFFD;
+				unitsSize = 1;
+			}
+			else
+			{
+				codePoint = unit(in);
+				unitsSize = 2;
+				if (codePoint >= 0xD800 && codePoint <= 0xDBFF)
+				{
+					if (inEnd - in < 4)
+					{
+						if (!Final)
+						{
+							// The low surrogate is in the next step's input.
+							break;
+						}
+						codePoint = 0xFFFD;
+					}
+					else if (auto const low = unit(in + 2); low >= 0xDC00 && low <= 0xDFFF)
+					{
+						codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+						unitsSize = 4;
+					}
+					else
+					{
+						codePoint = 0xFFFD;
+					}
+				}
+				else if (codePoint >= 0xDC00 && codePoint <= 0xDFFF)
+				{
+					codePoint = 0xFFFD;
+				}
+			}
+
+			auto const outSize = codePoint < 0x80 ? 1 : codePoint < 0x800 ? 2 : codePoint < 0x10000 ? 3 : 4;
+			if (outEnd - out < outSize)
+			{
+				break;
+			}
+			switch (outSize)
+			{
+			case 1:
+				*out++ = static_cast<std::uint8_t>(codePoint);
+				break;
+
+			case 2:
+				*out++ = static_cast<std::uint8_t>(0xC0 | (codePoint >> 6));
+				*out++ = static_cast<std::uint8_t>(0x80 | (codePoint & 0x3F));
+				break;
+
+			case 3:
+				*out++ = static_cast<std::uint8_t>(0xE0 | (codePoint >> 12));
+				*out++ = static_cast<std::uint8_t>(0x80 | ((codePoint >> 6) & 0x3F));
+				*out++ = static_cast<std::uint8_t>(0x80 | (codePoint & 0x3F));
+				break;
+
+			default:
+				*out++ = static_cast<std::uint8_t>(0xF0 | (codePoint >> 18));
+				*out++ = static_cast<std::uint8_t>(0x80 | ((codePoint >> 12) & 0x3F));
+				*out++ = static_cast<std::uint8_t>(0x80 | ((codePoint >> 6) & 0x3F));
+				*out++ = static_cast<std::uint8_t>(0x80 | (codePoint & 0x3F));
+				break;
+			}
+			in += unitsSize;
+		}
+
+		return { static_cast<std::size_t>(in - Input.data()), static_cast<std::size_t>(out - Output.data()) };
+	}
+
+	transform_source::transform_source(byte_source& Upstream, byte_transform& Transform, std::size_t const BufferSize) :
+		mUpstream(&Upstream),
+		mTransform(&Transform),
+		mUpstreamStart(Upstream.position()),
+		mInput(nullptr),
+		mInputCursor(0),
+		mInputEnd(0),
+		mStageCursor(0),
+		mStageEnd(0),
+		mUpstreamEnded(false),
+		mPosition(0)
+	{
+		WDUL_ASSERT(BufferSize != 0);
+		if (!Upstream.borrowable())
+		{
+			mInputBuffer = byte_array(BufferSize);
+			mInput = mInputBuffer.data();
+		}
+		else
+		{
+			// The buffer is only needed to join input held back by the transform to the next bytes borrowed from the upstream
+			// source, so it is allocated when first needed.
+			mInputBuffer.reserve(BufferSize);
+		}
+	}
+
+	std::size_t transform_source::read(std::span<std::uint8_t> const Buffer)
+	{
+		if (Buffer.empty())
+		{
+			return 0;
+		}
+
+		if (mStageCursor == mStageEnd && Buffer.size() < byte_transform::min_output_size)
+		{
+			mStageCursor = 0;
+			mStageEnd = static_cast<std::uint8_t>(step(mStage));
+		}
+		if (mStageCursor != mStageEnd)
+		{
+			auto const count = (std::min)(Buffer.size(), std::size_t(mStageEnd - mStageCursor));
+			std::memcpy(Buffer.data(), mStage + mStageCursor, count);
+			mStageCursor += static_cast<std::uint8_t>(count);
+			mPosition += count;
+			return count;
+		}
+
+		auto const produced = step(Buffer);
+		mPosition += produced;
+		return produced;
+	}
+
+	std::size_t transform_source::step(std::span<std::uint8_t> const Output)
+	{
+		for (;;)
+		{
+			auto const result = mTransform->transform({ mInput + mInputCursor, mInputEnd - mInputCursor }, Output, mUpstreamEnded);
+			mInputCursor += result.consumed;
+			if (result.produced != 0)
+			{
+				return result.produced;
+			}
+			if (result.consumed == 0)
+			{
+				if (mUpstreamEnded)
+				{
+					return 0;
+				}
+				fill();
+			}
+		}
+	}
+
+	void transform_source::seek(std::uint64_t const Position)
+	{
+		if (Position < mPosition)
+		{
+			// The transform cannot run backwards, so it starts over.
+			mUpstream->seek(mUpstreamStart);
+			mTransform->reset();
+			mInputCursor = 0;
+			mInputEnd = 0;
+			mStageCursor = 0;
+			mStageEnd = 0;
+			mUpstreamEnded = false;
+			mPosition = 0;
+		}
+
+		std::uint8_t discard[4096];
+		while (mPosition < Position)
+		{
+			auto const size = static_cast<std::size_t>((std::min)(Position - mPosition, std::uint64_t(sizeof(discard))));
+			if (read({ discard, size }) == 0)
+			{
+				// Positions beyond the end of the stream behave like the end of the stream.
+				mPosition = Position;
+				break;
+			}
+		}
+	}
+
+	void transform_source::fill()
+	{
+		auto const held = mInputEnd - mInputCursor;
+		if (held == 0 && mUpstream->borrowable())
+		{
+			auto const bytes = mUpstream->borrow(mInputBuffer.capacity());
+			mInput = bytes.data();
+			mInputCursor = 0;
+			mInputEnd = bytes.size();
+			if (bytes.empty())
+			{
+				mUpstreamEnded = true;
+			}
+			return;
+		}
+
+		// The input held back by the transform is moved to the start of the input buffer, followed by the next bytes of the
+		// upstream source, so that the transform sees them contiguously.
+		if (mInputBuffer.empty())
+		{
+			mInputBuffer.resize(mInputBuffer.capacity());
+		}
+		WDUL_ASSERT_MSG(held < mInputBuffer.size(), "the transform held back more input than fits in the input buffer");
+		if (held != 0 && mInput + mInputCursor != mInputBuffer.data())
+		{
+			std::memmove(mInputBuffer.data(), mInput + mInputCursor, held);
+		}
+		mInput = mInputBuffer.data();
+		mInputCursor = 0;
+		mInputEnd = held;
+
+		auto const bytesRead = mUpstream->read({ mInputBuffer.data() + held, mInputBuffer.size() - held });
+		mInputEnd += bytesRead;
+		if (bytesRead == 0)
+		{
+			mUpstreamEnded = true;
+		}
+	}
+
+	namespace impl
+	{
+		// The tables of the slicing-by-8 algorithm. Table 0 is the conventional byte-wise table for the reflected polynomial
+		// 0xEDB88320; table k gives the effect of a byte followed by k zero bytes.
+		consteval std::array<std::array<std::uint32_t, 256>, 8> make_crc32_tables() noexcept
+		{
+			std::array<std::array<std::uint32_t, 256>, 8> tables{};
+			for (std::uint32_t i = 0; i != 256; ++i)
+			{
+				auto crc = i;
+				for (int bit = 0; bit != 8; ++bit)
+				{
+					crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1)));
+				}
+				tables[0][i] = crc;
+			}
+			for (std::uint32_t i = 0; i != 256; ++i)
+			{
+				for (std::size_t k = 1; k != 8; ++k)
+				{
+					tables[k][i] = (tables[k - 1][i] >> 8) ^ tables[0][tables[k - 1][i] & 0xFF];
+				}
+			}
+			return tables;
+		}
+
+		inline constexpr auto crc32_tables = make_crc32_tables();
+	}
+
+	[[nodiscard]] std::uint32_t crc32(std::span<std::uint8_t const> const Bytes, std::uint32_t const Crc) noexcept
+	{
+		auto const& t = impl::crc32_tables;
+		auto crc = ~Crc;
+		auto p = Bytes.data();
+		auto size = Bytes.size();
+
+		// Eight bytes are folded into the CRC per iteration, with independent table lookups.
+		while (size >= 8)
+		{
+			std::uint32_t lo, hi;
+			std::memcpy(&lo, p, 4);
+			std::memcpy(&hi, p + 4, 4);
+			lo ^= crc;
+			crc = t[7][lo & 0xFF] ^ t[6][(lo >> 8) & 0xFF] ^ t[5][(lo >> 16) & 0xFF] ^ t[4][lo >> 24] ^
+				t[3][hi & 0xFF] ^ t[2][(hi >> 8) & 0xFF] ^ t[1][(hi >> 16) & 0xFF] ^ t[0][hi >> 24];
+			p += 8;
+			size -= 8;
+		}
+		while (size != 0)
+		{
+			crc = (crc >> 8) ^ t[0][(crc ^ *p) & 0xFF];
+			++p;
+			--size;
+		}
+		return ~crc;
+	}
+
+	std::uint64_t pump(byte_source& Source, byte_sink& Sink)
+	{
+		std::uint64_t total = 0;
+		if (Source.borrowable())
+		{
+			while (true)
+			{
+				auto const bytes = Source.borrow((std::numeric_limits<std::size_t>::max)());
+				if (bytes.empty())
+				{
+					return total;
+				}
+				Sink.write(bytes);
+				total += bytes.size();
+			}
+		}
+
+		byte_array buffer(std::size_t(64) << 10);
+		while (true)
+		{
+			auto const bytesRead = Source.read({ buffer.data(), buffer.size() });
+			if (bytesRead == 0)
+			{
+				return total;
+			}
+			Sink.write({ buffer.data(), bytesRead });
+			total += bytesRead;
+		}
+	}
+}
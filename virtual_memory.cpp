@@ -0,0 +1,142 @@
+// This file is part of the WillDaisey/WDUL (Windows Desktop Utility Library) project.
+// View this project on github: https://github.com/WillDaisey/wdul/
+
+#include "include/wdul/virtual_memory.hpp"
+#include "include/wdul/handle.hpp"
+#include "include/wdul/error.hpp"
+#include <algorithm>
+
+namespace wdul::impl
+{
+	[[nodiscard]] SYSTEM_INFO const& system_info() noexcept
+	{
+		static SYSTEM_INFO const inst = []()
+		{
+			SYSTEM_INFO info;
+			GetSystemInfo(&info);
+			return info;
+		}();
+		return inst;
+	}
+}
+
+namespace wdul
+{
+	[[nodiscard]] std::size_t page_size() noexcept
+	{
+		return impl::system_info().dwPageSize;
+	}
+
+	[[nodiscard]] std::size_t allocation_granularity() noexcept
+	{
+		return impl::system_info().dwAllocationGranularity;
+	}
+
+	[[nodiscard]] std::size_t large_page_size() noexcept
+	{
+		static std::size_t const inst = GetLargePageMinimum();
+		return inst;
+	}
+
+	bool enable_large_pages()
+	{
+		generic_handle<invalid_handle_type::null> token;
+		check_bool(OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, token.put()));
+
+		TOKEN_PRIVILEGES privileges;
+		privileges.PrivilegeCount = 1;
+		privileges.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+		check_bool(LookupPrivilegeValueW(nullptr, SE_LOCK_MEMORY_NAME, &privileges.Privileges[0].Luid));
+
+		// AdjustTokenPrivileges succeeds even if the token does not hold the privilege, in which case the last-error code is set
+		// to ERROR_NOT_ALL_ASSIGNED.
+		check_bool(AdjustTokenPrivileges(token.get(), FALSE, &privileges, 0, nullptr, nullptr));
+		return GetLastError() != ERROR_NOT_ALL_ASSIGNED;
+	}
+
+	virtual_buffer::virtual_buffer(std::size_t const MaxSize, bool const LargePages) :
+		virtual_buffer()
+	{
+		WDUL_ASSERT(MaxSize != 0);
+
+		if (LargePages && large_page_size() != 0)
+		{
+			auto const size = impl::round_up_size(MaxSize, large_page_size());
+			if (size != 0)
+			{
+				mData = static_cast<std::uint8_t*>(VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE));
+				if (mData)
+				{
+					mCommitted = size;
+					mReserved = size;
+					mLargePages = true;
+					return;
+				}
+			}
+		}
+
+		auto const size = impl::round_up_size(MaxSize, allocation_granularity());
+		if (size == 0)
+		{
+			throw std::bad_alloc();
+		}
+		mData = static_cast<std::uint8_t*>(VirtualAlloc(nullptr, size, MEM_RESERVE, PAGE_NOACCESS));
+		if (!mData)
+		{
+			throw std::bad_alloc();
+		}
+		mReserved = size;
+	}
+
+	void virtual_buffer::shrink_to_fit() noexcept
+	{
+		if (mLargePages)
+		{
+			return;
+		}
+		auto const keep = impl::round_up_size(mSize, page_size());
+		if (keep < mCommitted)
+		{
+			WDUL_DEBUG_RAISE_LAST_ERROR_WHEN(VirtualFree(mData + keep, mCommitted - keep, MEM_DECOMMIT), == 0);
+			mCommitted = keep;
+		}
+	}
+
+	void virtual_buffer::release() noexcept
+	{
+		if (mData)
+		{
+			WDUL_DEBUG_RAISE_LAST_ERROR_WHEN(VirtualFree(mData, 0, MEM_RELEASE), == 0);
+			mData = nullptr;
+			mSize = 0;
+			mCommitted = 0;
+			mReserved = 0;
+			mLargePages = false;
+		}
+	}
+
+	void virtual_buffer::grow(std::size_t const Size)
+	{
+		if (Size > mReserved)
+		{
+			throw std::bad_alloc();
+		}
+		commit((std::max)(Size, mCommitted + (std::min)(mCommitted / 2, mReserved - mCommitted)));
+	}
+
+	void virtual_buffer::commit(std::size_t const Size)
+	{
+		if (Size > mReserved)
+		{
+			throw std::bad_alloc();
+		}
+		// The reserved size is a multiple of the allocation granularity, which is a multiple of the page size, so rounding up
+		// cannot exceed it.
+		auto const newCommitted = impl::round_up_size(Size, page_size());
+		if (!VirtualAlloc(mData + mCommitted, newCommitted - mCommitted, MEM_COMMIT, PAGE_READWRITE))
+		{
+			throw std::bad_alloc();
+		}
+		mCommitted = newCommitted;
+	}
+}